@@ -0,0 +1,344 @@
+/**
+ * Microbenchmarks for path parsing, formatting and resolution, and macro
+ * benchmarks of bulk operations on generated directory trees.
+ *
+ * Usage: bvestl-fs-bench [--filter <substring>] [--min-time <ms>] [--repetitions <n>] [--output <file.json>]
+ *
+ * Results are written as JSON, to stdout unless --output is given, with the
+ * median and fastest time per operation over the repetitions and the number of
+ * allocations per operation.
+ */
+
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/instrumentation.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/resolver.hpp"
+#include "bvestl/fs/walk.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace bvestl::fs;
+
+namespace {
+	struct settings {
+		const char* filter = nullptr;
+		double min_time_ms = 200.0;
+		size_t repetitions = 5;
+		const char* output = nullptr;
+	};
+
+	struct result {
+		std::string name;
+		std::uint64_t iterations;
+		double median_ns;
+		double min_ns;
+		double allocations;
+	};
+
+	using clock_type = std::chrono::steady_clock;
+
+	// Keeps the optimizer from discarding benchmarked work
+	std::atomic<size_t> sink{0};
+
+	class suite {
+	  public:
+		suite(settings const& s, counting_allocator& counter) : m_settings(s), m_counter(counter) {}
+
+		bool wanted(std::string const& name) const { return m_settings.filter == nullptr || name.find(m_settings.filter) != std::string::npos; }
+
+		/**
+		 * Times \p body, calibrating the iteration count so a repetition lasts
+		 * about min_time. For cheap operations.
+		 */
+		template <class Body>
+		void micro(std::string const& name, Body&& body) {
+			if (!wanted(name))
+				return;
+			std::uint64_t iterations = 1;
+			for (;;) {
+				double const elapsed = run(body, iterations);
+				if (elapsed >= m_settings.min_time_ms * 1e6 / 10 || iterations >= (std::uint64_t(1) << 30))
+					break;
+				iterations *= 10;
+			}
+			iterations = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(iterations * 10 * (m_settings.min_time_ms / 1000.0)));
+			measure(name, iterations, [&] { return run(body, iterations); });
+		}
+
+		/**
+		 * Times one call of \p body per repetition, with \p setup and \p teardown
+		 * outside the measurement. For bulk filesystem work.
+		 */
+		template <class Setup, class Body, class Teardown>
+		void macro(std::string const& name, Setup&& setup, Body&& body, Teardown&& teardown) {
+			if (!wanted(name))
+				return;
+			measure(name, 1, [&] {
+				setup();
+				double const elapsed = run(body, 1);
+				teardown();
+				return elapsed;
+			});
+		}
+
+		std::vector<result> const& results() const { return m_results; }
+
+	  private:
+		// Only allocations made by the timed calls are counted
+		template <class Body>
+		double run(Body& body, std::uint64_t const iterations) {
+			std::uint64_t const allocations = m_counter.counters().allocations;
+			auto const start = clock_type::now();
+			for (std::uint64_t i = 0; i < iterations; ++i)
+				body();
+			double const elapsed = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+			m_allocations += m_counter.counters().allocations - allocations;
+			return elapsed;
+		}
+
+		template <class Repetition>
+		void measure(std::string const& name, std::uint64_t const iterations, Repetition&& repetition) {
+			std::vector<double> times;
+			m_allocations = 0;
+			for (size_t r = 0; r < m_settings.repetitions; ++r)
+				times.push_back(repetition() / static_cast<double>(iterations));
+			double const allocations = static_cast<double>(m_allocations);
+			std::sort(times.begin(), times.end());
+			double const total = static_cast<double>(iterations) * static_cast<double>(m_settings.repetitions);
+			m_results.push_back(result{name, iterations, times[times.size() / 2], times.front(), allocations / total});
+			std::fprintf(stderr, "%-40s %12.1f ns/op %8.2f allocs/op\n", name.c_str(), times[times.size() / 2],
+			             allocations / total);
+		}
+
+		settings const& m_settings;
+		counting_allocator& m_counter;
+		std::vector<result> m_results;
+		std::uint64_t m_allocations = 0;
+	};
+
+	// "c0/c1/.../c<depth-1>/file.ext" in the requested flavour
+	std::string make_path(size_t const depth, bool const windows) {
+		std::string text = windows ? "C:\\" : "/";
+		for (size_t i = 0; i < depth; ++i) {
+			text += "component";
+			text += std::to_string(i);
+			text += windows ? '\\' : '/';
+		}
+		text += "file.ext";
+		return text;
+	}
+
+	std::string temporary_root() {
+#if defined(EA_PLATFORM_WINDOWS)
+		const char* base = std::getenv("TEMP");
+		if (base == nullptr)
+			base = ".";
+		char const separator = '\\';
+#else
+		const char* base = std::getenv("TMPDIR");
+		if (base == nullptr)
+			base = "/tmp";
+		char const separator = '/';
+#endif
+		auto const stamp = static_cast<unsigned long long>(clock_type::now().time_since_epoch().count());
+		return std::string(base) + separator + "bvestl-fs-bench-" + std::to_string(stamp);
+	}
+
+	// Every directory of a tree \p fanout wide and \p depth deep, each holding \p files files
+	void tree_layout(std::string const& root, size_t const fanout, size_t const depth, std::vector<std::string>& directories) {
+		directories.push_back(root);
+		if (depth == 0)
+			return;
+		for (size_t i = 0; i < fanout; ++i)
+			tree_layout(root + "/d" + std::to_string(i), fanout, depth - 1, directories);
+	}
+
+	void make_files(std::vector<std::string> const& directories, size_t const files) {
+		std::error_code ec;
+		for (std::string const& directory : directories) {
+			for (size_t i = 0; i < files; ++i) {
+				std::string const name = directory + "/f" + std::to_string(i) + ".dat";
+				open_file(path(name.c_str()), open_flags::write | open_flags::create, ec);
+			}
+		}
+	}
+
+	void path_benchmarks(suite& s) {
+		for (size_t const depth : {1, 4, 16}) {
+			for (bool const windows : {false, true}) {
+				std::string const flavour = windows ? "windows" : "posix";
+				std::string const suffix = "/" + flavour + "/depth=" + std::to_string(depth);
+				std::string const text = make_path(depth, windows);
+				internal::string const string(text.c_str(), get_global_allocator());
+				path_type const type = windows ? path_type::windows_path : path_type::posix_path;
+
+				s.micro("parse" + suffix, [&] {
+					path p;
+					p.set(string, type);
+					sink.fetch_add(p.length(), std::memory_order_relaxed);
+				});
+
+				path parsed;
+				parsed.set(string, type);
+				s.micro("format" + suffix, [&] { sink.fetch_add(parsed.str(type).size(), std::memory_order_relaxed); });
+			}
+
+			path const base(make_path(depth, false).c_str());
+			path const relative("objects/trees/oak.b3d");
+			std::string const suffix = "/depth=" + std::to_string(depth);
+			s.micro("join" + suffix, [&] { sink.fetch_add((base / relative).length(), std::memory_order_relaxed); });
+			s.micro("parent_path" + suffix, [&] { sink.fetch_add(base.parent_path().length(), std::memory_order_relaxed); });
+			s.micro("filename" + suffix, [&] { sink.fetch_add(base.filename().size(), std::memory_order_relaxed); });
+			s.micro("extension" + suffix, [&] { sink.fetch_add(base.extension().size(), std::memory_order_relaxed); });
+
+			path const dotted = base / path("../objects/./trees/../oak.b3d");
+			path const target = base.parent_path() / relative;
+			s.micro("lexically_normal" + suffix, [&] { sink.fetch_add(dotted.lexically_normal().length(), std::memory_order_relaxed); });
+			s.micro("lexically_relative" + suffix,
+			        [&] { sink.fetch_add(target.lexically_relative(base).length(), std::memory_order_relaxed); });
+
+			// Same length and depth as base, differing in the last component only
+			path const sibling = base.parent_path() / path("file.exu");
+			path const copy = base;
+			s.micro("equal/hit" + suffix, [&] { sink.fetch_add(base == copy ? 1 : 0, std::memory_order_relaxed); });
+			s.micro("equal/miss" + suffix, [&] { sink.fetch_add(base == sibling ? 1 : 0, std::memory_order_relaxed); });
+			s.micro("compare" + suffix, [&] { sink.fetch_add(static_cast<size_t>(base.compare(sibling)), std::memory_order_relaxed); });
+		}
+
+		// A constant prefix joined onto a runtime name, parsed on every join versus at compile time
+		static constexpr static_path prefix("assets/objects/trees");
+		path const name("oak.b3d");
+		s.micro("join/parsed_prefix", [&] { sink.fetch_add((path("assets/objects/trees") / name).length(), std::memory_order_relaxed); });
+		s.micro("join/static_prefix", [&] { sink.fetch_add((prefix / name).length(), std::memory_order_relaxed); });
+	}
+
+	void resolve_benchmarks(suite& s, std::string const& scratch) {
+		for (size_t const roots : {1, 8, 64}) {
+			// The file only exists under the last search path, so every root is probed
+			std::string const base = scratch + "/resolve" + std::to_string(roots);
+			resolver r;
+			std::error_code ec;
+			for (size_t i = 0; i < roots; ++i) {
+				std::string const root = base + "/root" + std::to_string(i);
+				create_directory_recursive(path(root.c_str()), ec);
+				r.append(path(root.c_str()));
+			}
+			std::string const target = base + "/root" + std::to_string(roots - 1) + "/assets/model.b3d";
+			create_directory_recursive(path(target.c_str()).parent_path(), ec);
+			open_file(path(target.c_str()), open_flags::write | open_flags::create, ec);
+			r.reopen_roots();
+
+			path const hit("assets/model.b3d");
+			path const miss("assets/missing.b3d");
+			std::string const suffix = "/roots=" + std::to_string(roots);
+			s.micro("resolve/hit" + suffix, [&] { sink.fetch_add(r.resolve(hit).length(), std::memory_order_relaxed); });
+			s.micro("resolve/miss" + suffix, [&] { sink.fetch_add(r.resolve(miss).length(), std::memory_order_relaxed); });
+		}
+	}
+
+	void tree_benchmarks(suite& s, std::string const& scratch) {
+		struct shape {
+			size_t fanout;
+			size_t depth;
+			size_t files;
+		};
+		for (shape const t : {shape{4, 3, 8}, shape{8, 4, 4}}) {
+			std::string const root = scratch + "/tree";
+			std::vector<std::string> directories;
+			tree_layout(root, t.fanout, t.depth, directories);
+			std::string const suffix = "/fanout=" + std::to_string(t.fanout) + ",depth=" + std::to_string(t.depth) + ",files=" +
+			                           std::to_string(t.files);
+			auto const clear = [&] { remove_directory_recursive(path(root.c_str())); };
+			auto const build = [&] {
+				std::error_code ec;
+				for (std::string const& directory : directories)
+					create_directory_recursive(path(directory.c_str()), ec);
+				make_files(directories, t.files);
+			};
+
+			s.macro(
+			    "create_directory_recursive" + suffix, clear,
+			    [&] {
+				    std::error_code ec;
+				    for (std::string const& directory : directories)
+					    create_directory_recursive(path(directory.c_str()), ec);
+			    },
+			    clear);
+
+			for (size_t const threads : {size_t(1), size_t(0)}) {
+				walk_options options;
+				options.threads = threads;
+				s.macro("walk/threads=" + std::string(threads == 0 ? "all" : "1") + suffix, build,
+				        [&] { sink.fetch_add(parallel_walk(path(root.c_str()), [](const directory_entry&, size_t) {}, options).entries); }, clear);
+			}
+
+			s.macro("remove_directory_recursive" + suffix, build, clear, [] {});
+		}
+	}
+
+	void write_json(FILE* const out, std::vector<result> const& results) {
+		std::fprintf(out, "{\n  \"library\": \"bvestl-fs\",\n  \"instrumentation\": %s,\n  \"benchmarks\": [\n",
+		             INSTRUMENTATION_ENABLED ? "true" : "false");
+		for (size_t i = 0; i < results.size(); ++i) {
+			result const& r = results[i];
+			std::fprintf(out,
+			             "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"allocations_per_op\": %.3f}%s\n",
+			             r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.median_ns, r.min_ns, r.allocations,
+			             i + 1 < results.size() ? "," : "");
+		}
+		std::fprintf(out, "  ]\n}\n");
+	}
+} // namespace
+
+int main(int const argc, char** const argv) {
+	settings s;
+	for (int i = 1; i < argc; ++i) {
+		bool const has_value = i + 1 < argc;
+		if (std::strcmp(argv[i], "--filter") == 0 && has_value)
+			s.filter = argv[++i];
+		else if (std::strcmp(argv[i], "--min-time") == 0 && has_value)
+			s.min_time_ms = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value)
+			s.repetitions = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--output") == 0 && has_value)
+			s.output = argv[++i];
+		else {
+			std::fprintf(stderr, "usage: %s [--filter <substring>] [--min-time <ms>] [--repetitions <n>] [--output <file.json>]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	// Everything defaulted to the global allocator is counted
+	counting_allocator counter(get_global_allocator());
+	set_global_allocator(&counter);
+
+	std::string const scratch = temporary_root();
+	std::error_code ec;
+	if (!create_directory_recursive(path(scratch.c_str()), ec)) {
+		std::fprintf(stderr, "can't create %s: %s\n", scratch.c_str(), ec.message().c_str());
+		return 1;
+	}
+
+	suite benchmarks(s, counter);
+	path_benchmarks(benchmarks);
+	resolve_benchmarks(benchmarks, scratch);
+	tree_benchmarks(benchmarks, scratch);
+	remove_directory_recursive(path(scratch.c_str()));
+
+	FILE* out = stdout;
+	if (s.output != nullptr && (out = std::fopen(s.output, "w")) == nullptr) {
+		std::fprintf(stderr, "can't write %s\n", s.output);
+		return 1;
+	}
+	write_json(out, benchmarks.results());
+	if (out != stdout)
+		std::fclose(out);
+	return 0;
+}
@@ -10,5 +10,32 @@ namespace bvestl::fs {
 #	define BVESTL_FS_GET_GLOBAL_ALLOC = get_global_allocator()
 #endif
 	BVESTL_FS_EXPORT void set_global_allocator(const bvestl::polyalloc::allocator_handle& handle);
+	/**
+	 * The allocator of the innermost scoped_allocator on this thread, or else the
+	 * global one. Lock-free; only set_global_allocator() takes a lock.
+	 */
 	BVESTL_FS_EXPORT bvestl::polyalloc::allocator_handle get_global_allocator();
+
+	/**
+	 * \brief Routes get_global_allocator() on the current thread to \p handle while in scope
+	 *
+	 * Scopes nest and must be destroyed in reverse order of construction, on the
+	 * thread that created them. Only the defaults are affected: anything that was
+	 * handed an allocator keeps using it.
+	 */
+	class BVESTL_FS_EXPORT scoped_allocator {
+	  public:
+		explicit scoped_allocator(const bvestl::polyalloc::allocator_handle& handle);
+		scoped_allocator(scoped_allocator const&) = delete;
+		scoped_allocator(scoped_allocator&&) = delete;
+		scoped_allocator& operator=(scoped_allocator const&) = delete;
+		scoped_allocator& operator=(scoped_allocator&&) = delete;
+		~scoped_allocator();
+
+	  private:
+		friend bvestl::polyalloc::allocator_handle get_global_allocator();
+
+		bvestl::polyalloc::allocator_handle m_handle;
+		const scoped_allocator* m_previous;
+	};
 } // namespace bvestl::fs
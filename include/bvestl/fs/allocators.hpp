@@ -0,0 +1,158 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace bvestl::fs {
+	namespace internal {
+		struct thread_cache_table;
+	}
+
+	/**
+	 * \brief Bump allocator over blocks taken from an upstream allocator
+	 *
+	 * deallocate() only gives back the most recent allocation; everything else is
+	 * reclaimed at once by reset(), which rewinds to the first block in O(1) and
+	 * keeps every block for reuse. Meant for a pass whose temporaries all die
+	 * together, typically installed with scoped_allocator. Not thread-safe.
+	 */
+	class BVESTL_FS_EXPORT monotonic_arena final : public bvestl::polyalloc::allocator {
+	  public:
+		explicit monotonic_arena(size_t block_size = 64 * 1024,
+		                         bvestl::polyalloc::allocator_handle upstream BVESTL_FS_GET_GLOBAL_ALLOC);
+		// Serves from \p buffer first, which the arena never frees
+		monotonic_arena(void* buffer,
+		                size_t size,
+		                size_t block_size = 64 * 1024,
+		                bvestl::polyalloc::allocator_handle upstream BVESTL_FS_GET_GLOBAL_ALLOC);
+		monotonic_arena(monotonic_arena const&) = delete;
+		monotonic_arena(monotonic_arena&&) = delete;
+		monotonic_arena& operator=(monotonic_arena const&) = delete;
+		monotonic_arena& operator=(monotonic_arena&&) = delete;
+		~monotonic_arena() override;
+
+		void* allocate(size_t n, int flags = 0) override;
+		void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0) override;
+		void deallocate(void* p, size_t n) override;
+
+		// Forget every allocation, keeping the blocks
+		void reset();
+		// Forget every allocation and return the blocks upstream
+		void release();
+		// Bytes handed out since the last reset
+		size_t used() const { return m_used; }
+
+	  private:
+		struct block;
+
+		bool grow(size_t n, size_t alignment);
+
+		bvestl::polyalloc::allocator_handle m_upstream;
+		size_t m_block_size;
+		// Chain of blocks; m_current is the one being bumped and those after it are free for reuse
+		block* m_first = nullptr;
+		block* m_current = nullptr;
+		char* m_initial = nullptr;
+		size_t m_initial_size = 0;
+		char* m_position = nullptr;
+		char* m_end = nullptr;
+		char* m_last = nullptr;
+		size_t m_used = 0;
+	};
+
+	/**
+	 * \brief Free lists per power-of-two size class, 16 to 256 bytes
+	 *
+	 * Fits path components and other small strings: freed blocks are reused
+	 * without going back upstream, and chunks are only returned when the pool
+	 * dies. Larger requests go straight upstream. An alignment up to the size
+	 * class is honoured; small requests aligned beyond MAX_CLASS, or with an
+	 * offset the blocks can't satisfy, are served upstream and go back there
+	 * when freed. Not thread-safe; see thread_cache_allocator.
+	 */
+	class BVESTL_FS_EXPORT pool_allocator final : public bvestl::polyalloc::allocator {
+	  public:
+		static constexpr size_t MIN_CLASS = 16;
+		static constexpr size_t MAX_CLASS = 256;
+		static constexpr size_t CLASS_COUNT = 5;
+
+		explicit pool_allocator(size_t chunk_size = 16 * 1024, bvestl::polyalloc::allocator_handle upstream BVESTL_FS_GET_GLOBAL_ALLOC);
+		pool_allocator(pool_allocator const&) = delete;
+		pool_allocator(pool_allocator&&) = delete;
+		pool_allocator& operator=(pool_allocator const&) = delete;
+		pool_allocator& operator=(pool_allocator&&) = delete;
+		~pool_allocator() override;
+
+		void* allocate(size_t n, int flags = 0) override;
+		void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0) override;
+		void deallocate(void* p, size_t n) override;
+
+	  private:
+		struct chunk;
+
+		void* refill(size_t size_class);
+		void* allocate_foreign(size_t n, size_t alignment, size_t offset, int flags);
+		// Whether \p p came from allocate_foreign(), forgetting it if so
+		bool release_foreign(void* p);
+
+		bvestl::polyalloc::allocator_handle m_upstream;
+		size_t m_chunk_size;
+		chunk* m_chunks = nullptr;
+		// Heads of the free lists, threaded through the free blocks themselves
+		void* m_free[CLASS_COUNT] = {};
+		// Live blocks from allocate_foreign(), which must not join the free lists
+		void** m_foreign = nullptr;
+		size_t m_foreign_count = 0;
+		size_t m_foreign_capacity = 0;
+	};
+
+	/**
+	 * \brief Per-thread caches of small blocks in front of another allocator
+	 *
+	 * Each thread keeps up to \c blocks_per_class freed blocks of each size class
+	 * (as pool_allocator) and reuses them without touching the upstream allocator
+	 * or any shared state. A block may be freed by a different thread than the one
+	 * that allocated it. Caches of exited threads are adopted by new ones.
+	 * Requests larger than MAX_CLASS go straight upstream. Small ones aligned
+	 * beyond alignof(std::max_align_t), or at an offset, are taken from upstream
+	 * at their full class size and cached when freed if their alignment allows.
+	 *
+	 * Threads must be done with the allocator before it is destroyed.
+	 */
+	class BVESTL_FS_EXPORT thread_cache_allocator final : public bvestl::polyalloc::allocator {
+	  public:
+		static constexpr size_t MIN_CLASS = pool_allocator::MIN_CLASS;
+		static constexpr size_t MAX_CLASS = pool_allocator::MAX_CLASS;
+		static constexpr size_t CLASS_COUNT = pool_allocator::CLASS_COUNT;
+
+		explicit thread_cache_allocator(size_t blocks_per_class = 64,
+		                                bvestl::polyalloc::allocator_handle upstream BVESTL_FS_GET_GLOBAL_ALLOC);
+		thread_cache_allocator(thread_cache_allocator const&) = delete;
+		thread_cache_allocator(thread_cache_allocator&&) = delete;
+		thread_cache_allocator& operator=(thread_cache_allocator const&) = delete;
+		thread_cache_allocator& operator=(thread_cache_allocator&&) = delete;
+		~thread_cache_allocator() override;
+
+		void* allocate(size_t n, int flags = 0) override;
+		void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0) override;
+		void deallocate(void* p, size_t n) override;
+
+	  private:
+		friend struct internal::thread_cache_table;
+		struct cache;
+
+		cache& local();
+
+		bvestl::polyalloc::allocator_handle m_upstream;
+		size_t m_limit;
+		// Distinguishes this instance from any earlier one at the same address
+		std::uint64_t m_id;
+		// Every cache ever created for this allocator, pushed lock-free
+		std::atomic<cache*> m_caches{nullptr};
+		// Registry of live instances, consulted when a thread exits
+		thread_cache_allocator* m_next_instance = nullptr;
+	};
+} // namespace bvestl::fs
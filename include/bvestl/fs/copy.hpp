@@ -0,0 +1,82 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace bvestl::fs {
+	// What to do when the destination already exists. A symlink there is replaced, never written through.
+	enum class copy_existing : std::uint8_t {
+		fail,      // Report errc::file_exists
+		skip,      // Leave it alone and succeed
+		overwrite, // Replace it
+		update,    // Replace it only if the source was modified more recently
+	};
+
+	struct copy_options {
+		copy_existing existing = copy_existing::fail;
+		// Give the copy the source's access and modification times (always done on Windows)
+		bool preserve_times = false;
+		// Give the copy the source's permission bits instead of the defaults
+		bool preserve_permissions = true;
+		// Share the data blocks with a reflink (FICLONE) where the filesystem can, making the copy nearly free
+		bool allow_reflink = true;
+		// Bytes per read/write when the kernel can't copy by itself
+		size_t buffer_size = 128 * 1024;
+		// Workers for copy_directory_recursive(), including the calling thread. 0 uses one per hardware thread.
+		size_t threads = 1;
+	};
+
+	struct copy_result {
+		explicit copy_result(bvestl::polyalloc::allocator_handle const handle) : failed_path(handle) {}
+
+		// First error, after which copying stopped
+		std::error_code error;
+		// Where that error happened
+		path failed_path;
+		std::uint64_t files = 0;
+		std::uint64_t directories = 0;
+		std::uint64_t bytes = 0;
+	};
+
+	/**
+	 * \brief Copies a regular file, letting the kernel move the data where it can
+	 *
+	 * On Linux this tries, in order, a FICLONE reflink, copy_file_range(),
+	 * sendfile() and finally a read/write loop through a buffer from \p handle.
+	 * Apple uses fcopyfile() and Windows CopyFileExW(). A destination that
+	 * fails half way is removed.
+	 */
+	BVESTL_FS_EXPORT bool copy_file(path_view from,
+	                                path_view to,
+	                                std::error_code& ec,
+	                                copy_options const& options = copy_options(),
+	                                bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+
+	/**
+	 * \brief Copies a directory tree into \p to, creating it if needed
+	 *
+	 * Runs on parallel_walk(). Symlinks are recreated rather than followed;
+	 * sockets, fifos and devices are skipped. options.existing applies per file.
+	 */
+	BVESTL_FS_EXPORT copy_result copy_directory_recursive(path_view from,
+	                                                      path_view to,
+	                                                      copy_options const& options = copy_options(),
+	                                                      bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+
+	/**
+	 * \brief Renames a file or directory, copying then removing it when that crosses devices
+	 *
+	 * options.existing decides what happens to an existing destination. The
+	 * cross-device fallback always preserves times and permissions.
+	 */
+	BVESTL_FS_EXPORT bool move_file(path_view from,
+	                                path_view to,
+	                                std::error_code& ec,
+	                                copy_options const& options = copy_options(),
+	                                bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+} // namespace bvestl::fs
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/directory_iterator.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include "bvestl/fs/status.hpp"
+#include <cstddef>
+#include <system_error>
+
+namespace bvestl::fs {
+	/**
+	 * \brief An open directory that relative paths are resolved against
+	 *
+	 * Holds an O_PATH descriptor on Linux (O_DIRECTORY elsewhere on POSIX), and
+	 * every operation goes through the *at() family, so the kernel only walks
+	 * the components below the directory rather than the whole path. The
+	 * directory can even be renamed while the handle is open.
+	 *
+	 * The members mirror the free functions of the same name and take paths
+	 * relative to the directory; an empty path names the directory itself.
+	 * On Windows the handle keeps the directory's path and joins onto it.
+	 */
+	class BVESTL_FS_EXPORT directory_handle {
+	  public:
+		explicit directory_handle(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		directory_handle(path_view p, std::error_code& ec, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		directory_handle(directory_handle const&) = delete;
+		directory_handle(directory_handle&& other) noexcept;
+		directory_handle& operator=(directory_handle const&) = delete;
+		directory_handle& operator=(directory_handle&& other) noexcept;
+		~directory_handle();
+
+		bool is_open() const;
+		explicit operator bool() const { return is_open(); }
+		void close();
+		// Another handle on the same directory
+		directory_handle duplicate(std::error_code& ec) const;
+
+#if defined(EA_PLATFORM_WINDOWS)
+		const path& native() const { return m_path; }
+#else
+		int native() const { return m_fd; }
+#endif
+
+		// Subdirectory of this one
+		directory_handle open_directory(path_view relative, std::error_code& ec) const;
+
+		file_status status(path_view relative, std::error_code& ec, status_mask mask = status_mask::all) const;
+		file_status symlink_status(path_view relative, std::error_code& ec, status_mask mask = status_mask::all) const;
+		bool exists(path_view relative) const;
+
+		// New files are created with permissions 0666 before the umask
+		file_handle open_file(path_view relative, open_flags flags, std::error_code& ec) const;
+		bool create_directory(path_view relative, std::error_code& ec) const;
+		bool remove_file(path_view relative, std::error_code& ec) const;
+		bool resize_file(path_view relative, size_t target_length, std::error_code& ec) const;
+
+		directory_iterator iterate(std::error_code& ec, directory_options const& options = directory_options()) const;
+
+	  private:
+		bvestl::polyalloc::allocator_handle m_handle;
+#if defined(EA_PLATFORM_WINDOWS)
+		path m_path;
+		bool m_open = false;
+#else
+		int m_fd = -1;
+#endif
+	};
+} // namespace bvestl::fs
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/mapped_file.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include "bvestl/fs/status.hpp"
+#include <EASTL/string_view.h>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace bvestl::fs {
+	struct index_options {
+		// Roots scanned at once, including on the calling thread. 0 uses one per hardware thread.
+		size_t threads = 0;
+		// Descend into symlinks to directories. Off by default: there is no protection against cycles.
+		bool follow_symlinks = false;
+		// Leave out directories that can't be read instead of failing
+		bool skip_permission_denied = true;
+	};
+
+	/**
+	 * \brief Snapshot of the file trees below an ordered list of roots
+	 *
+	 * Maps every relative path found below any root to the first root that has
+	 * it, in a single hash table, so finding which root provides a name is one
+	 * probe with no system call. The table lives in one flat buffer in the same
+	 * format it is saved in, so a saved index is used straight out of a read-only
+	 * mapping.
+	 *
+	 * The index doesn't follow later changes to the trees; build it again.
+	 */
+	class BVESTL_FS_EXPORT directory_index {
+	  public:
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		explicit directory_index(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		directory_index(directory_index const&) = delete;
+		directory_index(directory_index&& other) noexcept;
+		directory_index& operator=(directory_index const&) = delete;
+		directory_index& operator=(directory_index&& other) noexcept;
+		~directory_index();
+
+		bool empty() const { return m_header == nullptr; }
+		size_t root_count() const;
+		// Text of a root, as it was given to build_directory_index()
+		eastl::string_view root(size_t index) const;
+		// Number of distinct relative paths
+		size_t size() const;
+
+		/**
+		 * Index of the first root below which \p relative exists, or npos. \p type,
+		 * if given, receives what it is. Separators may be repeated or, for Windows
+		 * paths, backslashes; see indexable() for what can't be looked up.
+		 */
+		size_t find(path_view relative, file_type* type = nullptr) const;
+		// False for absolute or empty paths and those with "." or ".." components, which the index has no answer for
+		static bool indexable(path_view relative);
+
+		// Writes the index so load_directory_index() can map it
+		bool save(path_view file, std::error_code& ec) const;
+
+	  private:
+		friend BVESTL_FS_EXPORT directory_index build_directory_index(const path* roots,
+		                                                               size_t count,
+		                                                               std::error_code& ec,
+		                                                               index_options const& options,
+		                                                               bvestl::polyalloc::allocator_handle handle);
+		friend BVESTL_FS_EXPORT directory_index load_directory_index(path_view file,
+		                                                              std::error_code& ec,
+		                                                              bvestl::polyalloc::allocator_handle handle);
+
+		struct header;
+
+		void release();
+
+		bvestl::polyalloc::allocator_handle m_handle;
+		// Either built here and owned, or mapped from a file
+		char* m_owned = nullptr;
+		size_t m_owned_size = 0;
+		mapped_file m_mapping;
+		const header* m_header = nullptr;
+	};
+
+	// Scans \p count roots, in parallel, into an index in which earlier roots win
+	BVESTL_FS_EXPORT directory_index build_directory_index(const path* roots,
+	                                                       size_t count,
+	                                                       std::error_code& ec,
+	                                                       index_options const& options = index_options(),
+	                                                       bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	/**
+	 * Maps an index written by directory_index::save(). A file that isn't one, or
+	 * whose lookups could read outside it or never end, fails with errc::bad_message;
+	 * a missing or unreadable one fails with the error from opening it. Either way
+	 * the index returned is empty.
+	 */
+	BVESTL_FS_EXPORT directory_index load_directory_index(path_view file,
+	                                                      std::error_code& ec,
+	                                                      bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+} // namespace bvestl::fs
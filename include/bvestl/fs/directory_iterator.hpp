@@ -0,0 +1,184 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include "bvestl/fs/status.hpp"
+#include <EASTL/string_view.h>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <system_error>
+
+namespace bvestl::fs {
+	class directory_handle;
+	namespace internal {
+		struct entry_access;
+	}
+
+	struct directory_options {
+		// Bytes of directory entries fetched from the OS per batch
+		size_t buffer_size = 32 * 1024;
+		// Descend into symlinks to directories (recursive iteration only), but never back into one being listed
+		bool follow_symlinks = false;
+		// Skip directories that can't be opened for lack of permission instead of failing
+		bool skip_permission_denied = false;
+		// Deepest level descended into; entries of the root itself are at depth 0 (recursive iteration only)
+		size_t max_depth = static_cast<size_t>(-1);
+	};
+
+	/**
+	 * \brief A single entry yielded by directory iteration
+	 *
+	 * Everything here views the iterator's buffers and is only valid until the
+	 * iterator advances.
+	 */
+	class BVESTL_FS_EXPORT directory_entry {
+	  public:
+		// Name of the entry inside its directory
+		eastl::string_view name() const { return m_name; }
+		// Path of the entry relative to the iteration root
+		path_view relative_path() const { return m_relative_path; }
+		// Type as reported by the directory listing itself. file_type::unknown when the filesystem doesn't say.
+		file_type type() const { return m_type; }
+		std::uint64_t inode() const { return m_inode; }
+		size_t depth() const { return m_depth; }
+#if !defined(EA_PLATFORM_WINDOWS)
+		// Descriptor of the open directory containing the entry, for *at() calls
+		int directory_fd() const { return m_directory_fd; }
+#endif
+
+		// Query the entry relative to its open directory, without walking the full path again
+		file_status status(std::error_code& ec, status_mask mask = status_mask::all) const;
+		file_status symlink_status(std::error_code& ec, status_mask mask = status_mask::all) const;
+
+	  private:
+		friend class directory_iterator;
+		friend struct internal::entry_access;
+
+		eastl::string_view m_name;
+		path_view m_relative_path;
+		file_type m_type = file_type::none;
+		std::uint64_t m_inode = 0;
+		size_t m_depth = 0;
+#if defined(EA_PLATFORM_WINDOWS)
+		const path* m_root = nullptr;
+#else
+		int m_directory_fd = -1;
+#endif
+	};
+
+	/**
+	 * \brief Streams the entries of a directory
+	 *
+	 * Entries are read from the OS in large batches (getdents64 on Linux) into a
+	 * buffer that is reused for the whole iteration, and carry the type reported
+	 * by the listing so telling files from directories needs no extra syscall.
+	 * "." and ".." are skipped.
+	 *
+	 * \code
+	 * std::error_code ec;
+	 * for (directory_entry const& entry : directory_iterator(root, ec)) { ... }
+	 * \endcode
+	 */
+	class BVESTL_FS_EXPORT directory_iterator {
+	  public:
+		class iterator {
+		  public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = directory_entry;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const directory_entry*;
+			using reference = const directory_entry&;
+
+			iterator() = default;
+
+			reference operator*() const { return m_owner->entry(); }
+			pointer operator->() const { return &m_owner->entry(); }
+
+			iterator& operator++() {
+				if (!m_owner->next())
+					m_owner = nullptr;
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const { return m_owner == other.m_owner; }
+			bool operator!=(const iterator& other) const { return m_owner != other.m_owner; }
+
+		  private:
+			friend class directory_iterator;
+
+			explicit iterator(directory_iterator* const owner) : m_owner(owner) {}
+
+			directory_iterator* m_owner = nullptr;
+		};
+
+		directory_iterator(path_view root,
+		                   std::error_code& ec,
+		                   directory_options const& options = directory_options(),
+		                   bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		// Iterates an already open directory; relative paths are relative to it
+		directory_iterator(directory_handle const& directory,
+		                   std::error_code& ec,
+		                   directory_options const& options = directory_options(),
+		                   bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		directory_iterator(directory_iterator const&) = delete;
+		directory_iterator(directory_iterator&& other) noexcept;
+		directory_iterator& operator=(directory_iterator const&) = delete;
+		directory_iterator& operator=(directory_iterator&& other) noexcept;
+		~directory_iterator();
+
+		// Single pass: begin() fetches the first entry the first time it is called
+		iterator begin();
+		iterator end() { return iterator(); }
+
+		// Advance to the next entry. Returns false at the end or on error.
+		bool next();
+		const directory_entry& entry() const { return m_entry; }
+		// Error that stopped the iteration, if any
+		const std::error_code& error() const { return m_error; }
+
+	  protected:
+		directory_iterator(directory_handle const* directory,
+		                   path_view root,
+		                   std::error_code& ec,
+		                   directory_options const& options,
+		                   bool recursive,
+		                   bvestl::polyalloc::allocator_handle handle);
+
+		struct state;
+
+		state* m_state;
+		bvestl::polyalloc::allocator_handle m_handle;
+		directory_entry m_entry;
+		std::error_code m_error;
+		bool m_started;
+	};
+
+	/**
+	 * \brief Streams the entries of a directory tree, depth first
+	 *
+	 * Subdirectories are opened relative to their parent's descriptor, and each
+	 * depth reuses one batch buffer, so the walk allocates once per level.
+	 * Directories are yielded before their contents.
+	 */
+	class BVESTL_FS_EXPORT recursive_directory_iterator : public directory_iterator {
+	  public:
+		recursive_directory_iterator(path_view root,
+		                             std::error_code& ec,
+		                             directory_options const& options = directory_options(),
+		                             bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		recursive_directory_iterator(directory_handle const& directory,
+		                             std::error_code& ec,
+		                             directory_options const& options = directory_options(),
+		                             bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+
+		// Depth of the current entry
+		size_t depth() const { return m_entry.depth(); }
+		// Don't descend into the current entry
+		void disable_recursion_pending();
+		// Skip the rest of the current entry's directory
+		void pop();
+	};
+} // namespace bvestl::fs
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <EABase/config/eaplatform.h>
+#include <cinttypes>
+#include <system_error>
+
+namespace bvestl::fs {
+	enum class open_flags : std::uint8_t {
+		none = 0,
+		read = 1u << 0,
+		write = 1u << 1,
+		create = 1u << 2,    // Create the file if it doesn't exist
+		exclusive = 1u << 3, // With create, fail if it already exists
+		truncate = 1u << 4,
+		append = 1u << 5,
+		// Bypass the page cache: O_DIRECT, FILE_FLAG_NO_BUFFERING. Transfers must then be block aligned.
+		direct = 1u << 6,
+		read_write = read | write,
+	};
+
+	constexpr open_flags operator|(open_flags const lhs, open_flags const rhs) {
+		return static_cast<open_flags>(static_cast<std::uint8_t>(lhs) | static_cast<std::uint8_t>(rhs));
+	}
+	constexpr open_flags operator&(open_flags const lhs, open_flags const rhs) {
+		return static_cast<open_flags>(static_cast<std::uint8_t>(lhs) & static_cast<std::uint8_t>(rhs));
+	}
+	constexpr bool any(open_flags const flags) {
+		return flags != open_flags::none;
+	}
+
+	/**
+	 * \brief Owns an open OS file: a descriptor on POSIX, a HANDLE on Windows
+	 */
+	class BVESTL_FS_EXPORT file_handle {
+	  public:
+#if defined(EA_PLATFORM_WINDOWS)
+		using native_type = void*;
+		// Failed CreateFileW calls return INVALID_HANDLE_VALUE, which must not be wrapped
+		static constexpr native_type INVALID = nullptr;
+#else
+		using native_type = int;
+		static constexpr native_type INVALID = -1;
+#endif
+
+		file_handle() = default;
+		explicit file_handle(native_type const native) : m_native(native) {}
+		file_handle(file_handle const&) = delete;
+		file_handle(file_handle&& other) noexcept : m_native(other.release()) {}
+		file_handle& operator=(file_handle const&) = delete;
+		file_handle& operator=(file_handle&& other) noexcept {
+			if (this != &other) {
+				close();
+				m_native = other.release();
+			}
+			return *this;
+		}
+		~file_handle() { close(); }
+
+		bool is_open() const { return m_native != INVALID; }
+		explicit operator bool() const { return is_open(); }
+		native_type native() const { return m_native; }
+
+		// Gives up ownership without closing
+		native_type release() {
+			native_type const native = m_native;
+			m_native = INVALID;
+			return native;
+		}
+		void close();
+
+	  private:
+		native_type m_native = INVALID;
+	};
+
+	// Opens p, returning a closed handle and setting \p ec on failure. New files get permissions 0666 before the umask.
+	BVESTL_FS_EXPORT file_handle open_file(path_view p,
+	                                       open_flags flags,
+	                                       std::error_code& ec,
+	                                       bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+} // namespace bvestl::fs
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <EASTL/span.h>
+#include <EASTL/string_view.h>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace bvestl::fs {
+	struct stream_options {
+		// Bytes buffered between the caller and the OS
+		size_t buffer_size = 64 * 1024;
+		/**
+		 * Bypass the page cache (open_flags::direct). Buffers are then block aligned and
+		 * all I/O is done in whole blocks. Only meaningful for files opened by the stream.
+		 */
+		bool direct = false;
+	};
+
+	/**
+	 * \brief Buffered sequential reads straight from a file descriptor
+	 *
+	 * The buffer comes from the stream's allocator. read_exact() and read_line()
+	 * return views into it, valid until the next read; the buffer grows when a
+	 * single record doesn't fit.
+	 */
+	class BVESTL_FS_EXPORT file_reader {
+	  public:
+		file_reader(path_view p,
+		            std::error_code& ec,
+		            stream_options const& options = stream_options(),
+		            bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		// Reads from an already open file, taking ownership of it
+		file_reader(file_handle&& file,
+		            std::error_code& ec,
+		            stream_options const& options = stream_options(),
+		            bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		file_reader(file_reader const&) = delete;
+		file_reader(file_reader&& other) noexcept;
+		file_reader& operator=(file_reader const&) = delete;
+		file_reader& operator=(file_reader&& other) noexcept;
+		~file_reader();
+
+		bool is_open() const { return m_file.is_open(); }
+		explicit operator bool() const { return is_open(); }
+		// Nothing buffered and nothing left in the file
+		bool eof() const { return m_eof && m_begin == m_end; }
+
+		// Copies up to \p size bytes out. Returns how many, 0 at the end of the file or on error.
+		size_t read(void* out, size_t size, std::error_code& ec);
+		// Exactly \p size bytes. Returns false at the end of the file (ec cleared), or with io_error if fewer bytes remain.
+		bool read_exact(size_t size, eastl::span<const std::byte>& out, std::error_code& ec);
+		// The next line without its "\n" or "\r\n". The last line needs no terminator. Returns false at the end or on error.
+		bool read_line(eastl::string_view& line, std::error_code& ec);
+
+		void close();
+
+	  private:
+		// Reads more of the file behind the buffered bytes. Returns false at the end or on error.
+		bool refill(std::error_code& ec);
+		bool grow(size_t capacity, std::error_code& ec);
+
+		file_handle m_file;
+		bvestl::polyalloc::allocator_handle m_handle;
+		char* m_buffer = nullptr;
+		size_t m_capacity = 0;
+		size_t m_begin = 0;
+		size_t m_end = 0;
+		bool m_eof = false;
+		bool m_direct = false;
+	};
+
+	/**
+	 * \brief Buffered sequential writes straight to a file descriptor
+	 *
+	 * Small writes are gathered in a buffer from the stream's allocator. A write
+	 * that doesn't fit goes out together with the buffered bytes in a single
+	 * writev(), without copying it first. The destructor flushes but can't
+	 * report errors; call close() to see them.
+	 */
+	class BVESTL_FS_EXPORT file_writer {
+	  public:
+		file_writer(path_view p,
+		            std::error_code& ec,
+		            open_flags flags = open_flags::write | open_flags::create | open_flags::truncate,
+		            stream_options const& options = stream_options(),
+		            bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		// Writes to an already open file, taking ownership of it
+		file_writer(file_handle&& file,
+		            std::error_code& ec,
+		            stream_options const& options = stream_options(),
+		            bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		file_writer(file_writer const&) = delete;
+		file_writer(file_writer&& other) noexcept;
+		file_writer& operator=(file_writer const&) = delete;
+		file_writer& operator=(file_writer&& other) noexcept;
+		~file_writer();
+
+		bool is_open() const { return m_file.is_open(); }
+		explicit operator bool() const { return is_open(); }
+		// Bytes accepted so far, buffered or not
+		std::uint64_t size() const { return m_written + m_used; }
+
+		bool write(const void* data, size_t size, std::error_code& ec);
+		bool write(eastl::string_view const text, std::error_code& ec) { return write(text.data(), text.size(), ec); }
+		bool put(char c, std::error_code& ec);
+
+		/**
+		 * \brief Hands everything buffered to the OS
+		 *
+		 * With direct I/O only whole blocks can go out, so a trailing partial
+		 * block stays buffered until close().
+		 */
+		bool flush(std::error_code& ec);
+		// Flushes and closes, reporting any error
+		bool close(std::error_code& ec);
+
+	  private:
+		file_handle m_file;
+		bvestl::polyalloc::allocator_handle m_handle;
+		char* m_buffer = nullptr;
+		size_t m_capacity = 0;
+		size_t m_used = 0;
+		std::uint64_t m_written = 0;
+		bool m_direct = false;
+	};
+} // namespace bvestl::fs
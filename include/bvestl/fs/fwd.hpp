@@ -11,5 +11,6 @@
 
 namespace bvestl::fs {
 	class path;
+	class path_view;
 	class resolver;
 } // namespace bvestl::fs
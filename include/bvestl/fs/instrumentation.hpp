@@ -0,0 +1,111 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace bvestl::fs {
+	/**
+	 * Whether the library was built with BVESTL_FS_INSTRUMENTATION. When it wasn't,
+	 * no operation is counted and snapshots are always zero.
+	 */
+#if defined(BVESTL_FS_INSTRUMENTATION)
+	constexpr bool INSTRUMENTATION_ENABLED = true;
+#else
+	constexpr bool INSTRUMENTATION_ENABLED = false;
+#endif
+
+	// Filesystem operations counted by the instrumentation, one per kind of system call
+	enum class fs_op : std::uint8_t {
+		stat,
+		open,
+		open_directory,
+		read_directory,
+		mkdir,
+		unlink,
+		rmdir,
+		rename,
+		copy,
+		count,
+	};
+
+	BVESTL_FS_EXPORT const char* to_string(fs_op op);
+
+	struct op_counters {
+		// Bucket 0 counts calls under 1us, bucket i those in [2^(i-1), 2^i) us; the last one everything slower
+		static const size_t LATENCY_BUCKETS = 24;
+
+		std::uint64_t calls = 0;
+		std::uint64_t failures = 0;
+		std::uint64_t total_ns = 0;
+		std::uint64_t max_ns = 0;
+		std::uint64_t latency[LATENCY_BUCKETS] = {};
+	};
+
+	struct instrumentation_snapshot {
+		op_counters ops[static_cast<size_t>(fs_op::count)];
+
+		op_counters const& operator[](fs_op const op) const { return ops[static_cast<size_t>(op)]; }
+	};
+
+	// Process wide counters so far. Each counter is read atomically, but not all of them at the same instant.
+	BVESTL_FS_EXPORT instrumentation_snapshot capture_instrumentation();
+	BVESTL_FS_EXPORT void reset_instrumentation();
+
+	struct allocation_counters {
+		std::uint64_t allocations = 0;
+		std::uint64_t deallocations = 0;
+		std::uint64_t bytes_allocated = 0;
+		std::uint64_t bytes_live = 0;
+		std::uint64_t peak_bytes_live = 0;
+	};
+
+	/**
+	 * \brief Forwards to another allocator, counting what goes through
+	 *
+	 * Independent of BVESTL_FS_INSTRUMENTATION: it costs nothing unless used.
+	 * Install it with set_global_allocator() or scoped_allocator to measure what
+	 * a call allocates, optionally with a trace callback that sees every
+	 * allocation and deallocation. Thread-safe.
+	 */
+	class BVESTL_FS_EXPORT counting_allocator final : public bvestl::polyalloc::allocator {
+	  public:
+		// Called after each allocation (\p allocated true) and before each deallocation
+		using trace_function = void (*)(void* context, void* p, size_t n, bool allocated);
+
+		explicit counting_allocator(bvestl::polyalloc::allocator_handle upstream BVESTL_FS_GET_GLOBAL_ALLOC);
+		counting_allocator(counting_allocator const&) = delete;
+		counting_allocator(counting_allocator&&) = delete;
+		counting_allocator& operator=(counting_allocator const&) = delete;
+		counting_allocator& operator=(counting_allocator&&) = delete;
+		~counting_allocator() override = default;
+
+		void* allocate(size_t n, int flags = 0) override;
+		void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0) override;
+		void deallocate(void* p, size_t n) override;
+
+		// Set before the allocator is shared between threads
+		void set_trace(void* context, trace_function trace) {
+			m_trace_context = context;
+			m_trace = trace;
+		}
+
+		allocation_counters counters() const;
+		// Zeroes everything but the live bytes, which keep being tracked
+		void reset();
+
+	  private:
+		void allocated(void* p, size_t n);
+
+		bvestl::polyalloc::allocator_handle m_upstream;
+		void* m_trace_context = nullptr;
+		trace_function m_trace = nullptr;
+		std::atomic<std::uint64_t> m_allocations{0};
+		std::atomic<std::uint64_t> m_deallocations{0};
+		std::atomic<std::uint64_t> m_bytes_allocated{0};
+		std::atomic<std::uint64_t> m_bytes_live{0};
+		std::atomic<std::uint64_t> m_peak_bytes_live{0};
+	};
+} // namespace bvestl::fs
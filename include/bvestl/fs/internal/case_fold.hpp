@@ -0,0 +1,19 @@
+#pragma once
+
+#include <EASTL/string_view.h>
+#include <cstdint>
+
+namespace bvestl::fs::internal {
+	/**
+	 * Simple (one to one) Unicode case folding of \p c, covering the Latin, Greek,
+	 * Cyrillic and Armenian scripts and fullwidth Latin. Other code points fold to
+	 * themselves.
+	 */
+	char32_t fold_case(char32_t c);
+
+	// Hash of \p name shared by every spelling of it that differs only in case. Malformed UTF-8 is hashed byte by byte.
+	std::uint64_t folded_hash(eastl::string_view name);
+
+	// Whether \p a and \p b are the same name ignoring case
+	bool folded_equal(eastl::string_view a, eastl::string_view b);
+} // namespace bvestl::fs::internal
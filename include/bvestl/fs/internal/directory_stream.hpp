@@ -0,0 +1,74 @@
+#pragma once
+
+#include "bvestl/fs/status.hpp"
+#include <EABase/config/eaplatform.h>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace bvestl::fs::internal {
+	struct raw_directory_entry {
+		// Null-terminated
+		const char* name;
+		size_t length;
+		file_type type;
+		std::uint64_t inode;
+	};
+
+	/**
+	 * \brief One open directory, read in batches into a caller provided buffer
+	 *
+	 * The buffer must stay dedicated to the stream while it is open and be at
+	 * least MIN_BUFFER_SIZE bytes. Closing is explicit so streams can be kept
+	 * in plain containers.
+	 */
+	class directory_stream {
+	  public:
+		static const size_t MIN_BUFFER_SIZE = 4096;
+
+#if defined(EA_PLATFORM_WINDOWS)
+		// Opens the native "<directory>\*" search \p pattern
+		bool open(const wchar_t* pattern, char* buffer, size_t buffer_size, std::error_code& ec);
+#else
+		// Opens \p name relative to the directory \p parent_fd (AT_FDCWD for the working directory)
+		bool open(int parent_fd, const char* name, bool follow_symlinks, char* buffer, size_t buffer_size, std::error_code& ec);
+		int fd() const { return m_fd; }
+#endif
+		bool is_open() const;
+		void close();
+
+		// Fetches the next entry, "." and ".." included. Returns false at the end or on error.
+		bool read(raw_directory_entry& out, std::error_code& ec);
+
+	  private:
+		char* m_buffer = nullptr;
+		size_t m_capacity = 0;
+#if defined(EA_PLATFORM_WINDOWS)
+		void* m_find = nullptr;
+		// FindFirstFileExW already returns the first entry
+		bool m_has_pending = false;
+#else
+		int m_fd = -1;
+#	if defined(EA_PLATFORM_LINUX)
+		size_t m_position = 0;
+		size_t m_end = 0;
+#	else
+		void* m_dir = nullptr;
+#	endif
+#endif
+	};
+
+	// Opening failed because we may not read it
+	inline bool is_permission_error(std::error_code const& ec) {
+		return ec == std::errc::permission_denied || ec == std::errc::operation_not_permitted;
+	}
+
+	// Opening failed because the entry vanished or was swapped for something that isn't a directory
+	inline bool is_vanished_error(std::error_code const& ec) {
+		return ec == std::errc::no_such_file_or_directory || ec == std::errc::not_a_directory || ec == std::errc::too_many_symbolic_link_levels;
+	}
+
+	inline bool is_dot_or_dot_dot(const char* const name) {
+		return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+	}
+} // namespace bvestl::fs::internal
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "bvestl/fs/instrumentation.hpp"
+#include <cstdint>
+
+/**
+ * Bracket a system call to count it:
+ *
+ * \code
+ * BVESTL_FS_OP_BEGIN(mkdir);
+ * int const result = mkdir(name, mode);
+ * BVESTL_FS_OP_END(mkdir, result != 0);
+ * \endcode
+ *
+ * Without BVESTL_FS_INSTRUMENTATION both expand to nothing and the failure
+ * expression isn't evaluated.
+ */
+#if defined(BVESTL_FS_INSTRUMENTATION)
+#	define BVESTL_FS_OP_BEGIN(op) std::uint64_t const bvestl_fs_op_start_##op = ::bvestl::fs::internal::op_clock()
+#	define BVESTL_FS_OP_END(op, failed) ::bvestl::fs::internal::record_op(::bvestl::fs::fs_op::op, bvestl_fs_op_start_##op, (failed))
+#else
+#	define BVESTL_FS_OP_BEGIN(op) ((void) 0)
+#	define BVESTL_FS_OP_END(op, failed) ((void) 0)
+#endif
+
+namespace bvestl::fs::internal {
+	// Monotonic nanoseconds
+	std::uint64_t op_clock();
+	void record_op(fs_op op, std::uint64_t start, bool failed);
+} // namespace bvestl::fs::internal
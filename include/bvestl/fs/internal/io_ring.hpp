@@ -0,0 +1,74 @@
+#pragma once
+
+#include <EABase/config/eaplatform.h>
+
+#if defined(EA_PLATFORM_LINUX) && defined(__has_include)
+#	if __has_include(<linux/io_uring.h>)
+#		include <linux/io_uring.h>
+// Opening, statx and plain reads all arrived in 5.6, along with this flag
+#		if defined(IORING_FEAT_RW_CUR_POS)
+#			define BVESTL_FS_HAS_IO_URING 1
+#		endif
+#	endif
+#endif
+
+#if defined(BVESTL_FS_HAS_IO_URING)
+#	include <cstdint>
+#	include <system_error>
+
+namespace bvestl::fs::internal {
+	/**
+	 * \brief Minimal io_uring instance driven through the raw system calls
+	 *
+	 * Single threaded: one thread queues entries, submits and reaps.
+	 */
+	class io_ring {
+	  public:
+		io_ring() = default;
+		io_ring(io_ring const&) = delete;
+		io_ring& operator=(io_ring const&) = delete;
+		~io_ring();
+
+		// Fails when the kernel, or a seccomp filter in front of it, doesn't allow io_uring
+		bool init(unsigned entries, std::error_code& ec);
+		// Whether the kernel implements an IORING_OP_*
+		bool supports(std::uint8_t opcode) const;
+
+		// A zeroed entry to fill in, queued until the next submit(). nullptr when the queue is full.
+		io_uring_sqe* next_sqe();
+		// Submits queued entries and waits until at least \p wait_for completions are ready
+		bool submit(unsigned wait_for, std::error_code& ec);
+		// Waits until at least \p wait_for completions are ready, without submitting anything queued
+		bool wait(unsigned wait_for, std::error_code& ec);
+		// Copies out the oldest unreaped completion
+		bool pop(io_uring_cqe& out);
+		// Entries the kernel has taken whose completions haven't been popped yet
+		unsigned in_flight() const { return m_submitted - m_completed; }
+
+	  private:
+		int m_fd = -1;
+		unsigned m_sq_entries = 0;
+		unsigned m_sq_tail = 0;
+		unsigned m_submitted = 0;
+		unsigned m_completed = 0;
+
+		void* m_sq_ring = nullptr;
+		size_t m_sq_ring_size = 0;
+		void* m_cq_ring = nullptr;
+		size_t m_cq_ring_size = 0;
+		io_uring_sqe* m_sqes = nullptr;
+		size_t m_sqes_size = 0;
+
+		unsigned* m_sq_head = nullptr;
+		unsigned* m_sq_tail_shared = nullptr;
+		unsigned* m_sq_mask = nullptr;
+		unsigned* m_sq_array = nullptr;
+		unsigned* m_cq_head = nullptr;
+		unsigned* m_cq_tail = nullptr;
+		unsigned* m_cq_mask = nullptr;
+		io_uring_cqe* m_cqes = nullptr;
+
+		std::uint8_t m_supported[256] = {};
+	};
+} // namespace bvestl::fs::internal
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace bvestl::fs::internal {
+	/**
+	 * Byte oriented LZ77 block codec used for compressed pack entries: a token
+	 * holding literal and match lengths, the literals, then a 16 bit offset
+	 * back into the block. Fast to decode and needs no state across blocks.
+	 */
+
+	// Largest lz_compress() output for \p size bytes of input
+	constexpr size_t lz_bound(size_t const size) {
+		return size + size / 255 + 16;
+	}
+
+	// Compresses \p size bytes into \p out, which holds \p capacity bytes. Returns the compressed size, 0 if it doesn't fit.
+	size_t lz_compress(const std::byte* in, size_t size, std::byte* out, size_t capacity);
+
+	// Decompresses a block that must expand to exactly \p out_size bytes. False if it is malformed.
+	bool lz_decompress(const std::byte* in, size_t in_size, std::byte* out, size_t out_size);
+} // namespace bvestl::fs::internal
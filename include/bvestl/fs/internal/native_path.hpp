@@ -0,0 +1,27 @@
+#pragma once
+
+#include "bvestl/fs/internal/small_vector.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <bvestl/polyalloc/polyalloc.hpp>
+
+namespace bvestl::fs::internal {
+	/**
+	 * \brief Null-terminated native rendering of a path_view, ready to be handed to the OS
+	 *
+	 * Views of a whole path reuse the path's cached native string. Anything else
+	 * is rendered into the inline buffer, only touching the allocator when it
+	 * doesn't fit.
+	 */
+	class native_path {
+	  public:
+		native_path(path_view path, bvestl::polyalloc::allocator_handle handle);
+		native_path(native_path const&) = delete;
+		native_path& operator=(native_path const&) = delete;
+
+		const native_char* c_str() const { return m_c_str; }
+
+	  private:
+		small_vector<native_char, 256> m_buffer;
+		const native_char* m_c_str;
+	};
+} // namespace bvestl::fs::internal
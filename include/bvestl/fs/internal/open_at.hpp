@@ -0,0 +1,13 @@
+#pragma once
+
+#include "bvestl/fs/file_handle.hpp"
+
+namespace bvestl::fs::internal {
+#if !defined(EA_PLATFORM_WINDOWS)
+	// open_file() of \p name relative to the directory \p dirfd (or AT_FDCWD)
+	file_handle open_at(int dirfd, const char* name, open_flags flags, std::error_code& ec);
+#else
+	// open_file() of a native path
+	file_handle open_native(const wchar_t* native, open_flags flags, std::error_code& ec);
+#endif
+} // namespace bvestl::fs::internal
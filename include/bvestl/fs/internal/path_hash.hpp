@@ -0,0 +1,29 @@
+#pragma once
+
+#include <EASTL/string_view.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace bvestl::fs::internal {
+	/**
+	 * FNV-1a over a path's components, each followed by a separator, so the
+	 * hash of a path extends to its children one component at a time and
+	 * separator runs or styles don't change it.
+	 */
+	constexpr std::uint64_t PATH_HASH_OFFSET = 14695981039346656037ull;
+	constexpr std::uint64_t PATH_HASH_PRIME = 1099511628211ull;
+
+	constexpr std::uint64_t hash_component(std::uint64_t hash, eastl::string_view const name) {
+		for (size_t i = 0; i < name.size(); ++i)
+			hash = (hash ^ static_cast<unsigned char>(name[i])) * PATH_HASH_PRIME;
+		return (hash ^ '/') * PATH_HASH_PRIME;
+	}
+
+	// hash_component() over each of \p components, such as a path_view, kept at 64 bits for hashes stored in files
+	template <class Components>
+	constexpr std::uint64_t hash_components(Components const& components, std::uint64_t hash = PATH_HASH_OFFSET) {
+		for (eastl::string_view const component : components)
+			hash = hash_component(hash, component);
+		return hash;
+	}
+} // namespace bvestl::fs::internal
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace bvestl::fs::internal {
+	/**
+	 * First '/' in [first, last), or also '\\' when \p windows, or last if there
+	 * is none. Scans 16 bytes at a time with SSE2 on x86-64 and NEON on ARM64,
+	 * which both always have them, and a byte at a time elsewhere.
+	 */
+	const char* find_separator(const char* first, const char* last, bool windows);
+} // namespace bvestl::fs::internal
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <EASTL/type_traits.h>
+#include <bvestl/polyalloc/polyalloc.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace bvestl::fs::internal {
+	/**
+	 * \brief Vector of trivially copyable values with N elements of inline storage
+	 *
+	 * Storage only comes from the allocator once the inline capacity is exceeded,
+	 * so short sequences never allocate. Copies keep the allocator of the source.
+	 */
+	template <class T, std::size_t N>
+	class small_vector {
+		static_assert(std::is_trivially_copyable<T>::value, "small_vector only holds trivially copyable types");
+
+	  public:
+		using value_type = T;
+		using iterator = T*;
+		using const_iterator = T const*;
+
+		explicit small_vector(bvestl::polyalloc::allocator_handle const handle) : m_data(m_inline), m_alloc(handle) {}
+
+		small_vector(small_vector const& other) : m_data(m_inline), m_alloc(other.m_alloc) { assign(other.m_data, other.m_size); }
+		small_vector(small_vector const& other, bvestl::polyalloc::allocator_handle const handle) : m_data(m_inline), m_alloc(handle) {
+			assign(other.m_data, other.m_size);
+		}
+		small_vector(small_vector&& other) noexcept : m_data(m_inline), m_alloc(other.m_alloc) { steal(other); }
+
+		small_vector& operator=(small_vector const& other) {
+			if (this != &other)
+				assign(other.m_data, other.m_size);
+			return *this;
+		}
+		small_vector& operator=(small_vector&& other) noexcept {
+			if (this != &other) {
+				release();
+				m_alloc = other.m_alloc;
+				steal(other);
+			}
+			return *this;
+		}
+
+		~small_vector() { release(); }
+
+		bvestl::polyalloc::allocator_handle get_allocator() const { return m_alloc; }
+
+		bool empty() const { return m_size == 0; }
+		std::size_t size() const { return m_size; }
+		std::size_t capacity() const { return m_capacity; }
+		bool is_inline() const { return m_data == m_inline; }
+
+		T* data() { return m_data; }
+		T const* data() const { return m_data; }
+		T& operator[](std::size_t const index) { return m_data[index]; }
+		T const& operator[](std::size_t const index) const { return m_data[index]; }
+		T& back() { return m_data[m_size - 1]; }
+		T const& back() const { return m_data[m_size - 1]; }
+
+		iterator begin() { return m_data; }
+		iterator end() { return m_data + m_size; }
+		const_iterator begin() const { return m_data; }
+		const_iterator end() const { return m_data + m_size; }
+
+		void clear() { m_size = 0; }
+		void pop_back() { --m_size; }
+
+		void reserve(std::size_t const count) {
+			if (count <= m_capacity)
+				return;
+			std::size_t new_capacity = m_capacity * 2;
+			if (new_capacity < count)
+				new_capacity = count;
+			auto* const storage = static_cast<T*>(m_alloc.allocate(new_capacity * sizeof(T), alignof(T), 0));
+			if (m_size != 0)
+				std::memcpy(storage, m_data, m_size * sizeof(T));
+			release();
+			m_data = storage;
+			m_capacity = new_capacity;
+		}
+
+		void resize(std::size_t const count) {
+			reserve(count);
+			m_size = count;
+		}
+
+		void push_back(T const& value) {
+			reserve(m_size + 1);
+			m_data[m_size++] = value;
+		}
+
+		void append(T const* const values, std::size_t const count) {
+			reserve(m_size + count);
+			if (count != 0)
+				std::memcpy(m_data + m_size, values, count * sizeof(T));
+			m_size += count;
+		}
+
+		void assign(T const* const values, std::size_t const count) {
+			m_size = 0;
+			append(values, count);
+		}
+
+	  private:
+		void release() {
+			if (!is_inline())
+				m_alloc.deallocate(m_data, m_capacity * sizeof(T));
+			m_data = m_inline;
+			m_capacity = N;
+		}
+
+		void steal(small_vector& other) {
+			if (other.is_inline()) {
+				assign(other.m_data, other.m_size);
+			}
+			else {
+				m_data = other.m_data;
+				m_size = other.m_size;
+				m_capacity = other.m_capacity;
+				other.m_data = other.m_inline;
+				other.m_capacity = N;
+			}
+			other.m_size = 0;
+		}
+
+		T* m_data;
+		std::size_t m_size = 0;
+		std::size_t m_capacity = N;
+		bvestl::polyalloc::allocator_handle m_alloc;
+		T m_inline[N];
+	};
+} // namespace bvestl::fs::internal
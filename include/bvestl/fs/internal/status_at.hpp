@@ -0,0 +1,10 @@
+#pragma once
+
+#include "bvestl/fs/status.hpp"
+
+namespace bvestl::fs::internal {
+#if !defined(EA_PLATFORM_WINDOWS)
+	// status() of \p name relative to the directory \p dirfd (or AT_FDCWD)
+	file_status status_at(int dirfd, const char* name, bool follow, status_mask mask, std::error_code& ec);
+#endif
+} // namespace bvestl::fs::internal
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <EASTL/span.h>
+#include <EASTL/type_traits.h>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace bvestl::fs {
+	namespace internal {
+		struct load_access;
+	}
+
+	enum class load_backend : std::uint8_t {
+		automatic, // io_uring where the kernel allows it, threads otherwise
+		io_uring,  // Fails with function_not_supported where unavailable
+		threads,
+	};
+
+	struct load_options {
+		// Files being opened or read at the same time
+		size_t queue_depth = 64;
+		// Workers for the thread backend, 0 for one per hardware thread
+		size_t threads = 0;
+		load_backend backend = load_backend::automatic;
+		// Allocate one extra byte past the contents and set it to zero, for text parsers
+		bool null_terminate = false;
+	};
+
+	/**
+	 * \brief Contents of one file of a batch, in a buffer from the batch's allocator
+	 *
+	 * Owns the buffer and frees it on destruction unless it is moved out or released.
+	 */
+	class BVESTL_FS_EXPORT loaded_file {
+	  public:
+		explicit loaded_file(bvestl::polyalloc::allocator_handle const handle) : m_handle(handle) {}
+		loaded_file(loaded_file const&) = delete;
+		loaded_file(loaded_file&& other) noexcept;
+		loaded_file& operator=(loaded_file const&) = delete;
+		loaded_file& operator=(loaded_file&& other) noexcept;
+		~loaded_file();
+
+		// Position of the file in the batch
+		size_t index() const { return m_index; }
+		const std::error_code& error() const { return m_error; }
+
+		std::byte* data() { return m_data; }
+		const std::byte* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		eastl::span<const std::byte> bytes() const { return eastl::span<const std::byte>(m_data, m_size); }
+
+		// Bytes actually allocated, what deallocate() wants after release()
+		size_t capacity() const { return m_capacity; }
+		bvestl::polyalloc::allocator_handle get_allocator() const { return m_handle; }
+		// Hands the buffer over to the caller, who must deallocate(data, capacity()) it
+		std::byte* release();
+
+	  private:
+		friend struct internal::load_access;
+
+		bvestl::polyalloc::allocator_handle m_handle;
+		size_t m_index = 0;
+		std::error_code m_error;
+		std::byte* m_data = nullptr;
+		size_t m_size = 0;
+		size_t m_capacity = 0;
+	};
+
+	struct load_result {
+		// The engine itself failed; files not yet delivered never will be
+		std::error_code error;
+		std::uint64_t loaded = 0;
+		std::uint64_t failed = 0;
+		// Backend that actually did the work
+		load_backend backend = load_backend::automatic;
+	};
+
+	/**
+	 * \brief Type-erased completion callback for load_files()
+	 *
+	 * done is called once per file, failed or not, and may move the file out to keep its buffer.
+	 */
+	struct load_callbacks {
+		void* context = nullptr;
+		void (*done)(void* context, loaded_file& file) = nullptr;
+	};
+
+	/**
+	 * \brief Reads a batch of whole files, keeping many requests in flight
+	 *
+	 * With io_uring, the open and statx of up to queue_depth files are submitted
+	 * together, then their reads, so a batch of small files costs a handful of
+	 * system calls and keeps the device busy rather than paying one round-trip
+	 * per file. Callbacks then run on the calling thread. Elsewhere a pool of
+	 * threads does blocking reads, and callbacks run concurrently on the
+	 * workers. Either way, files complete in no particular order.
+	 *
+	 * Buffers come from \p handle. The thread backend serializes its calls, so
+	 * the allocator doesn't need to be thread safe.
+	 */
+	BVESTL_FS_EXPORT load_result load_files(const path_view* paths,
+	                                        size_t count,
+	                                        load_callbacks const& callbacks,
+	                                        load_options const& options = load_options(),
+	                                        bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+
+	// load_files() with any callable taking a loaded_file&
+	template <class Callback, class = eastl::enable_if_t<!eastl::is_same_v<eastl::decay_t<Callback>, load_callbacks>>>
+	load_result load_files(const path_view* const paths,
+	                       size_t const count,
+	                       Callback&& callback,
+	                       load_options const& options = load_options(),
+	                       bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) {
+		using callback_type = eastl::remove_reference_t<Callback>;
+
+		load_callbacks callbacks;
+		callbacks.context = const_cast<void*>(static_cast<const void*>(&callback));
+		callbacks.done = [](void* const context, loaded_file& file) { (*static_cast<callback_type*>(context))(file); };
+		return load_files(paths, count, callbacks, options, handle);
+	}
+} // namespace bvestl::fs
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <EASTL/span.h>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace bvestl::fs {
+	enum class map_mode : std::uint8_t {
+		read_only,
+		// Writes go straight to the file through the page cache
+		read_write,
+	};
+
+	// How the mapping is about to be accessed, madvise() on POSIX
+	enum class access_hint : std::uint8_t {
+		normal,
+		sequential, // Read ahead aggressively, drop pages soon after they were read
+		random,     // Don't read ahead
+		willneed,   // Start reading the range in now
+		dontneed,   // The range won't be needed again soon
+	};
+
+	struct map_options {
+		map_mode mode = map_mode::read_only;
+		// Create the file if it doesn't exist (read_write only)
+		bool create = false;
+		// Fault every page in while mapping (MAP_POPULATE on Linux, a willneed hint elsewhere)
+		bool populate = false;
+		// Ask for transparent huge pages where the kernel supports them for this file. Only a hint.
+		bool huge_pages = false;
+		access_hint hint = access_hint::normal;
+	};
+
+	/**
+	 * \brief A file mapped into memory
+	 *
+	 * Reads are served zero-copy out of the page cache, so large files cost no
+	 * heap and no copy. Empty files open fine and have no data. Read-write
+	 * mappings can grow or shrink the file with resize().
+	 */
+	class BVESTL_FS_EXPORT mapped_file {
+	  public:
+		mapped_file() = default;
+		mapped_file(path_view p,
+		            std::error_code& ec,
+		            map_options const& options = map_options(),
+		            bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		// Maps an already open file, taking ownership of it. It must be opened for reading, and writing too for read_write.
+		mapped_file(file_handle&& file, std::error_code& ec, map_options const& options = map_options());
+		mapped_file(mapped_file const&) = delete;
+		mapped_file(mapped_file&& other) noexcept;
+		mapped_file& operator=(mapped_file const&) = delete;
+		mapped_file& operator=(mapped_file&& other) noexcept;
+		~mapped_file();
+
+		bool is_open() const { return m_file.is_open(); }
+		explicit operator bool() const { return is_open(); }
+		map_mode mode() const { return m_options.mode; }
+
+		const std::byte* data() const { return static_cast<const std::byte*>(m_address); }
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		eastl::span<const std::byte> bytes() const { return eastl::span<const std::byte>(data(), m_size); }
+		// Empty for read-only mappings
+		eastl::span<std::byte> writable_bytes() {
+			if (m_options.mode != map_mode::read_write)
+				return eastl::span<std::byte>();
+			return eastl::span<std::byte>(static_cast<std::byte*>(m_address), m_size);
+		}
+
+		// Hints how [offset, offset + length) is about to be accessed. Best effort, errors are ignored.
+		void advise(access_hint hint, size_t offset = 0, size_t length = static_cast<size_t>(-1)) const;
+
+		/**
+		 * \brief Changes the size of the file and the mapping along with it
+		 *
+		 * Read-write mappings only. The mapping may move, so pointers into it
+		 * are invalidated. New bytes read as zero.
+		 */
+		bool resize(size_t new_size, std::error_code& ec);
+		// Writes dirty pages back to the file, waiting for completion unless \p async
+		bool flush(std::error_code& ec, bool async = false);
+
+		void close();
+
+	  private:
+		// Maps m_file in full, closing it on failure
+		void attach(std::error_code& ec);
+		bool map(std::error_code& ec);
+		void unmap();
+
+		file_handle m_file;
+		void* m_address = nullptr;
+		size_t m_size = 0;
+#if defined(EA_PLATFORM_WINDOWS)
+		void* m_mapping = nullptr;
+#endif
+		map_options m_options;
+	};
+} // namespace bvestl::fs
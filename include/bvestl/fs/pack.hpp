@@ -0,0 +1,186 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/mapped_file.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include "bvestl/fs/internal/string.hpp"
+#include "bvestl/fs/internal/vector.hpp"
+#include <EASTL/span.h>
+#include <EASTL/string_view.h>
+#include <EASTL/utility.h>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace bvestl::fs {
+	enum class pack_compression : std::uint8_t {
+		none, // Stored as is, and served straight out of the mapping
+		lz,   // Split in blocks compressed one by one; a block that doesn't shrink is stored as is
+	};
+
+	/**
+	 * \brief Contents of one file, wherever it came from
+	 *
+	 * Either a view of a mapping, a mapped loose file or a stored pack entry,
+	 * or a buffer of its own holding a decompressed entry. Views of a pack are
+	 * only valid as long as the pack is.
+	 */
+	class BVESTL_FS_EXPORT file_contents {
+	  public:
+		explicit file_contents(bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) : m_handle(handle) {}
+		// Contents of a mapped file
+		explicit file_contents(mapped_file&& file, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		file_contents(file_contents const&) = delete;
+		file_contents(file_contents&& other) noexcept;
+		file_contents& operator=(file_contents const&) = delete;
+		file_contents& operator=(file_contents&& other) noexcept;
+		~file_contents();
+
+		bool is_open() const { return m_open; }
+		explicit operator bool() const { return is_open(); }
+		// Whether the bytes belong to a mapping rather than a buffer of their own
+		bool is_mapped() const { return m_owned == nullptr; }
+
+		const std::byte* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		eastl::span<const std::byte> bytes() const { return eastl::span<const std::byte>(m_data, m_size); }
+
+	  private:
+		friend class mapped_pack;
+
+		bvestl::polyalloc::allocator_handle m_handle;
+		mapped_file m_mapping;
+		std::byte* m_owned = nullptr;
+		const std::byte* m_data = nullptr;
+		size_t m_size = 0;
+		bool m_open = false;
+	};
+
+	// A file stored in a pack
+	struct pack_entry {
+		// Components joined by '/'
+		eastl::string_view name;
+		// Uncompressed size
+		std::uint64_t size = 0;
+		// Bytes it takes up in the pack
+		std::uint64_t stored_size = 0;
+		pack_compression compression = pack_compression::none;
+	};
+
+	/**
+	 * \brief Read-only archive of many files, mapped into memory
+	 *
+	 * A pack starts with its index: a hash table for finding a name in one
+	 * probe, over entries sorted by name so the contents of a directory are
+	 * one contiguous range. File data follows at 64 bit offsets. Directories
+	 * aren't stored; they exist as long as something is below them.
+	 *
+	 * Stored entries are served zero-copy out of the mapping; compressed ones
+	 * are decompressed into a buffer from the pack's allocator when opened.
+	 */
+	class BVESTL_FS_EXPORT mapped_pack {
+	  public:
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		explicit mapped_pack(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		// Maps a pack written by pack_builder, checking that it is well formed (errc::bad_message if not)
+		mapped_pack(path_view file, std::error_code& ec, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		mapped_pack(mapped_pack const&) = delete;
+		mapped_pack(mapped_pack&& other) noexcept;
+		mapped_pack& operator=(mapped_pack const&) = delete;
+		mapped_pack& operator=(mapped_pack&& other) noexcept;
+		~mapped_pack() = default;
+
+		bool is_open() const { return m_header != nullptr; }
+		explicit operator bool() const { return is_open(); }
+		// Where the pack was mapped from
+		const path& file() const { return m_file; }
+
+		// Number of entries
+		size_t size() const;
+		pack_entry entry(size_t index) const;
+
+		/**
+		 * Index of the file named \p relative, or npos. Separators may be repeated or,
+		 * for Windows paths, backslashes. Absolute paths and "." or ".." components
+		 * never match.
+		 */
+		size_t find(path_view relative) const;
+		// Whether anything is stored below \p relative. The empty path is the top of the pack.
+		bool is_directory(path_view relative) const;
+		bool exists(path_view const relative) const { return find(relative) != npos || is_directory(relative); }
+		// Range of the entries below \p relative, in name order
+		eastl::pair<size_t, size_t> entries_below(path_view relative) const;
+
+		// Bytes of a pack_compression::none entry, straight from the mapping; empty for compressed ones
+		eastl::span<const std::byte> data(size_t index) const;
+		// Contents of an entry, decompressed if need be
+		file_contents open(size_t index, std::error_code& ec) const;
+
+	  private:
+		friend class pack_builder;
+
+		struct header;
+
+		bvestl::polyalloc::allocator_handle m_handle;
+		path m_file;
+		mapped_file m_mapping;
+		const header* m_header = nullptr;
+	};
+
+	struct pack_options {
+		// Uncompressed bytes per compressed block, at most 64 KiB
+		std::uint32_t block_size = 64 * 1024;
+	};
+
+	/**
+	 * \brief Collects files and writes them out as a pack for mapped_pack
+	 *
+	 * Data added from memory is copied; files are only read, one at a time,
+	 * when the pack is written.
+	 */
+	class BVESTL_FS_EXPORT pack_builder {
+	  public:
+		explicit pack_builder(pack_options const& options = pack_options(), bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+
+		// Number of entries added
+		size_t size() const { return m_items.size(); }
+
+		// Adds a copy of \p data as \p name. Names must be relative, without "." or ".." components, and unique.
+		bool add(path_view name,
+		         eastl::span<const std::byte> data,
+		         std::error_code& ec,
+		         pack_compression compression = pack_compression::none);
+		// Adds the file \p source as \p name
+		bool add_file(path_view name, path_view source, std::error_code& ec, pack_compression compression = pack_compression::none);
+		// Adds every file below \p source, named by its path relative to \p source below \p prefix
+		bool add_directory(path_view source,
+		                   std::error_code& ec,
+		                   pack_compression compression = pack_compression::none,
+		                   path_view prefix = path_view());
+
+		/**
+		 * Writes the pack to \p destination. Fails with errc::file_exists if a name was
+		 * added twice, and errc::not_a_directory if a file is also the directory of another.
+		 */
+		bool write(path_view destination, std::error_code& ec) const;
+
+	  private:
+		struct item {
+			// Components joined by '/'
+			internal::string name;
+			// Where the data comes from when source is empty
+			internal::vector<std::byte> data;
+			path source;
+			pack_compression compression;
+		};
+
+		bool add_item(path_view name, std::error_code& ec, item&& it);
+
+		pack_options m_options;
+		bvestl::polyalloc::allocator_handle m_handle;
+		internal::vector<item> m_items;
+	};
+} // namespace bvestl::fs
@@ -12,12 +12,20 @@
 #include "bvestl/fs/allocation.hpp"
 #include "bvestl/fs/api.hpp"
 #include "bvestl/fs/fwd.hpp"
+#include "bvestl/fs/internal/path_hash.hpp"
+#include "bvestl/fs/internal/small_vector.hpp"
 #include "bvestl/fs/internal/string.hpp"
 #include "bvestl/fs/internal/vector.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include "bvestl/fs/static_path.hpp"
 #include <EABase/config/eaplatform.h>
+#include <EASTL/functional.h>
 #include <EASTL/optional.h>
 #include <cinttypes>
+#include <cstring>
+#include <functional>
 #include <iosfwd>
+#include <system_error>
 
 namespace bvestl::fs {
 	/**
@@ -26,50 +34,61 @@ namespace bvestl::fs {
 	 * This class is just a temporary workaround to avoid the heavy boost
 	 * dependency until boost::filesystem is integrated into the standard template
 	 * library at some point in the future.
+	 *
+	 * The whole path is kept in a single null-terminated buffer in POSIX form,
+	 * alongside a table of (offset, length) pairs locating every component in it.
+	 * Both have inline storage, so typical paths never touch the allocator and
+	 * filename/extension/parent queries are slices of the buffer. A hash of the
+	 * components is kept up to date as they are added, so paths can key hash
+	 * tables as they are.
 	 */
 	class BVESTL_FS_EXPORT path {
 	  public:
-		enum class path_type : std::uint8_t {
-			windows_path = 0,
-			posix_path = 1,
-#if defined(EA_PLATFORM_WINDOWS)
-			native_path = windows_path
-#else
-			native_path = posix_path
-#endif
-		};
+		using path_type = ::bvestl::fs::path_type;
 
 		// Constructors
 		explicit path(bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) :
-		    m_path(handle), m_type(path_type::native_path), m_absolute(false) {}
+		    m_text(handle), m_components(handle), m_type(path_type::native_path), m_absolute(false) {
+			m_text.push_back('\0');
+		}
 
 		path(const path& path) = default;
-		path(path&& path) = default;
+		// Moving leaves \p path an empty path
+		path(path&& path) noexcept;
 		path& operator=(const path& path) = default;
-		path& operator=(path&& path) = default;
+		path& operator=(path&& path) noexcept;
 
 		explicit path(const char* string, bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) :
-		    m_path(handle), m_type(path_type::native_path), m_absolute(false) {
-			set(internal::string(string, handle), path_type::native_path, handle);
+		    m_text(handle), m_components(handle), m_type(path_type::native_path), m_absolute(false) {
+			assign(string, std::strlen(string), path_type::native_path);
+		}
+		explicit path(path_view const view, bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) :
+		    m_text(handle), m_components(handle), m_type(view.type()), m_absolute(false) {
+			assign(view.text().data(), view.text().size(), view.type());
 		}
 		explicit path(const internal::string& string, bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) :
-		    m_path(handle), m_type(path_type::native_path), m_absolute(false) {
+		    m_text(handle), m_components(handle), m_type(path_type::native_path), m_absolute(false) {
 			set(string, path_type::native_path, handle);
 		}
+		// Copies an already parsed path, such as a static_path, without parsing it again
+		explicit path(path_literal const& literal, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		template <size_t N>
+		explicit path(static_path<N> const& literal, bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) :
+		    path(static_cast<path_literal>(literal), handle) {}
 
 		// Windows Constructors impl
 #if defined(EA_PLATFORM_WINDOWS)
 		path(const wchar_t* wstring, bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) :
-		    m_path(handle), m_type(path_type::native_path), m_absolute(false) {
+		    m_text(handle), m_components(handle), m_type(path_type::native_path), m_absolute(false) {
 			set(internal::wstring(wstring, handle), handle);
 		}
 		path(const internal::wstring& wstring, bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) :
-		    m_path(handle), m_type(path_type::native_path), m_absolute(false) {
+		    m_text(handle), m_components(handle), m_type(path_type::native_path), m_absolute(false) {
 			set(wstring, handle);
 		}
 
 		path& operator=(const internal::wstring& str) {
-			set(str, m_path.get_allocator());
+			set(str, m_text.get_allocator());
 			return *this;
 		}
 #endif
@@ -98,8 +117,24 @@ namespace bvestl::fs {
 		internal::wstring wstr(path_type type, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC) const;
 #endif
 
-		bool empty() const { return m_path.empty(); }
-		size_t length() const { return m_path.size(); }
+		// Views the stored text, which parses back into the same components
+		operator path_view() const { return path_view(eastl::string_view(m_text.data(), text_length()), m_type, this); }
+
+		/**
+		 * \brief Null-terminated native representation, for handing to the OS
+		 *
+		 * On POSIX this is the path's own buffer. On Windows the wide string is built
+		 * on first use and cached until the path is modified, so it is not safe to
+		 * call concurrently on the same path there.
+		 */
+#if defined(EA_PLATFORM_WINDOWS)
+		const native_char* native_c_str() const;
+#else
+		const native_char* native_c_str() const { return m_text.data(); }
+#endif
+
+		bool empty() const { return m_components.empty(); }
+		size_t length() const { return m_components.size(); }
 		internal::string filename(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC) const;
 		internal::string extension(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC) const;
 
@@ -113,12 +148,40 @@ namespace bvestl::fs {
 		path make_absolute(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC) const;
 		path parent_path(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC) const;
 
-		// Comparison Operators
-		bool operator==(const path& p) const { return p.m_path == m_path; }
-		bool operator!=(const path& p) const { return p.m_path != m_path; }
+		/**
+		 * \brief This path with "." components dropped and ".." folded into the component before it
+		 *
+		 * Purely textual: symbolic links are not followed and the filesystem is never
+		 * touched. Leading ".." components of a relative path are kept, and ones that
+		 * would climb above the root of an absolute path are dropped. A path that
+		 * folds away completely becomes ".".
+		 */
+		path lexically_normal(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC) const;
+		/**
+		 * \brief The relative path leading from \p base to this path, without touching the filesystem
+		 *
+		 * Empty if there is none, such as when only one of the two is absolute or they
+		 * are on different drives. "." and ".." in the part of \p base past the common
+		 * prefix are accounted for, but normalize both first if they can appear earlier.
+		 */
+		path lexically_relative(const path& base, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC) const;
+
+		// Hash of the component sequence, the same as path_view::hash() of this path. Equal paths hash equally.
+		size_t hash() const { return static_cast<size_t>(m_hash); }
+
+		// Comparison Operators. Like equality, ordering only looks at the components, one at a time.
+		bool operator==(const path& p) const;
+		bool operator!=(const path& p) const { return !(*this == p); }
+		int compare(const path& p) const;
+		bool operator<(const path& p) const { return compare(p) < 0; }
+		bool operator>(const path& p) const { return compare(p) > 0; }
+		bool operator<=(const path& p) const { return compare(p) <= 0; }
+		bool operator>=(const path& p) const { return compare(p) >= 0; }
 
-		// Modification Operators
+		// Modification Operators. Joining a path_literal, such as a static_path, copies its components as they are.
 		path operator/(const path& other) const;
+		path operator/(path_literal const& other) const;
+		friend BVESTL_FS_EXPORT path operator/(path_literal const& lhs, const path& rhs);
 
 		// Friend
 		friend BVESTL_FS_EXPORT std::ostream& operator<<(std::ostream&, const path&);
@@ -129,24 +192,106 @@ namespace bvestl::fs {
 		static const size_t MAX_PATH_WINDOWS_LEGACY = 260;
 
 	  protected:
-		static internal::vector<internal::string> tokenize(const internal::string& string,
-		                                                   const internal::string& deliminator,
-		                                                   bvestl::polyalloc::allocator_handle handle);
+		using component = internal::path_component;
 
-		internal::vector<internal::string> m_path;
+		static const size_t INLINE_TEXT = 128;
+		static const size_t INLINE_COMPONENTS = 8;
+
+		void assign(const char* str, size_t length, path_type type);
+		path_literal literal() const {
+			return path_literal{m_text.data(), text_length(), m_components.data(), m_components.size(), m_hash, m_type, m_absolute};
+		}
+		// \p lhs followed by the components of \p rhs, in a path from \p handle
+		static path join(path_literal const& lhs, path_literal const& rhs, bvestl::polyalloc::allocator_handle handle);
+		void push_component(const char* str, size_t length);
+		// Empties a moved-from path, whose buffer lost its terminator along with the text
+		void reset_moved();
+		// Number of characters in front of the first component ('/' for absolute POSIX paths)
+		size_t prefix_length() const { return m_absolute && m_type == path_type::posix_path ? 1 : 0; }
+		// Length of the text without the null terminator
+		size_t text_length() const { return m_text.size() - 1; }
+		const char* component_data(size_t const index) const { return m_text.data() + m_components[index].offset; }
+		eastl::string_view component_name(size_t const index) const {
+			return eastl::string_view(component_data(index), m_components[index].length);
+		}
+
+		internal::small_vector<char, INLINE_TEXT> m_text;
+		internal::small_vector<component, INLINE_COMPONENTS> m_components;
+		std::uint64_t m_hash = internal::PATH_HASH_OFFSET;
 		path_type m_type;
 		bool m_absolute;
+#if defined(EA_PLATFORM_WINDOWS)
+		mutable eastl::optional<internal::wstring> m_native;
+#endif
+	};
+
+	struct remove_options {
+		// Workers deleting sibling subtrees concurrently, including the calling thread. 0 uses one per hardware thread.
+		size_t threads = 1;
+	};
+
+	struct remove_result {
+		explicit remove_result(bvestl::polyalloc::allocator_handle const handle) : failed_path(handle) {}
+
+		// First error, after which removal stopped
+		std::error_code error;
+		// Where that error happened
+		path failed_path;
+		// Files, links and directories removed, the root included
+		std::uint64_t removed = 0;
+	};
+
+	struct create_options {
+		/**
+		 * Remember directories created or found along the way in a process-wide cache, so later calls for
+		 * them make no syscall at all. Removals through this library clear the cache; call
+		 * clear_directory_cache() after removing directories any other way or changing the working directory.
+		 */
+		bool cache = false;
 	};
 
 	// Utility
 	BVESTL_FS_EXPORT path cwd(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
 
-	BVESTL_FS_EXPORT bool create_directory(const path& p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
-	BVESTL_FS_EXPORT bool create_directory_recursive(const path& p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
-	BVESTL_FS_EXPORT bool remove_directory(const path& p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
-	BVESTL_FS_EXPORT bool remove_directory_recursive(const path& p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
-	BVESTL_FS_EXPORT bool remove_file(const path& p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
-	BVESTL_FS_EXPORT bool resize_file(const path& p,
+	// Queries and operations. The handle is only used for paths too long to render on the stack.
+	BVESTL_FS_EXPORT size_t file_size(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	BVESTL_FS_EXPORT bool file_exists(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	BVESTL_FS_EXPORT bool is_directory(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	BVESTL_FS_EXPORT bool is_file(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+
+	BVESTL_FS_EXPORT bool create_directory(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	BVESTL_FS_EXPORT bool create_directory_recursive(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	/**
+	 * \brief Creates p and every missing parent, succeeding if p already is a directory
+	 *
+	 * Tries p directly first; if a parent is missing, walks down from the deepest existing
+	 * ancestor with mkdirat() relative to the previous directory's descriptor.
+	 */
+	BVESTL_FS_EXPORT bool create_directory_recursive(path_view p,
+	                                                 std::error_code& ec,
+	                                                 create_options const& options = create_options(),
+	                                                 bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	/**
+	 * \brief Creates parent, then each relative path in names below it
+	 *
+	 * The parent is opened once and every child created relative to it. Stops at the first failure.
+	 */
+	BVESTL_FS_EXPORT bool create_directories(path_view parent,
+	                                         const path_view* names,
+	                                         size_t count,
+	                                         std::error_code& ec,
+	                                         create_options const& options = create_options(),
+	                                         bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	// Forgets every directory remembered by create_options::cache
+	BVESTL_FS_EXPORT void clear_directory_cache();
+	BVESTL_FS_EXPORT bool remove_directory(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	BVESTL_FS_EXPORT bool remove_directory_recursive(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	BVESTL_FS_EXPORT remove_result remove_directory_recursive(path_view p,
+	                                                          remove_options const& options,
+	                                                          bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	// Removes a file or symlink; directories are refused, as DeleteFileW does
+	BVESTL_FS_EXPORT bool remove_file(path_view p, bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	BVESTL_FS_EXPORT bool resize_file(path_view p,
 	                                  size_t target_length,
 	                                  bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
 
@@ -154,3 +299,17 @@ namespace bvestl::fs {
 	BVESTL_FS_EXPORT std::ostream& operator<<(std::ostream& os, const path& path);
 
 } // namespace bvestl::fs
+
+namespace eastl {
+	template <>
+	struct hash<bvestl::fs::path> {
+		size_t operator()(bvestl::fs::path const& p) const { return p.hash(); }
+	};
+} // namespace eastl
+
+namespace std {
+	template <>
+	struct hash<bvestl::fs::path> {
+		size_t operator()(bvestl::fs::path const& p) const noexcept { return p.hash(); }
+	};
+} // namespace std
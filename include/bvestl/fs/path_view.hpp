@@ -0,0 +1,143 @@
+#pragma once
+
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/fwd.hpp"
+#include <EABase/config/eaplatform.h>
+#include <EASTL/string_view.h>
+#include <cctype>
+#include <cinttypes>
+#include <cstring>
+#include <iosfwd>
+#include <iterator>
+
+namespace bvestl::fs {
+	enum class path_type : std::uint8_t {
+		windows_path = 0,
+		posix_path = 1,
+#if defined(EA_PLATFORM_WINDOWS)
+		native_path = windows_path
+#else
+		native_path = posix_path
+#endif
+	};
+
+#if defined(EA_PLATFORM_WINDOWS)
+	using native_char = wchar_t;
+#else
+	using native_char = char;
+#endif
+
+	/**
+	 * \brief Non-owning view of a path stored somewhere else
+	 *
+	 * Parses the underlying characters in place: iterating components, taking the
+	 * filename, extension or parent and comparing never allocate. The viewed
+	 * characters must outlive the view.
+	 */
+	class BVESTL_FS_EXPORT path_view {
+	  public:
+		using path_type = ::bvestl::fs::path_type;
+
+		class iterator {
+		  public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = eastl::string_view;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const eastl::string_view*;
+			using reference = const eastl::string_view&;
+
+			iterator() = default;
+
+			reference operator*() const { return m_component; }
+			pointer operator->() const { return &m_component; }
+
+			iterator& operator++() {
+				find_next(m_component.data() + m_component.size());
+				return *this;
+			}
+			iterator operator++(int) {
+				iterator copy(*this);
+				++*this;
+				return copy;
+			}
+
+			bool operator==(const iterator& other) const { return m_component.data() == other.m_component.data(); }
+			bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		  private:
+			friend class path_view;
+
+			iterator(const char* const position, const char* const end, path_type const type) : m_end(end), m_type(type) {
+				find_next(position);
+			}
+
+			void find_next(const char* position) {
+				while (position != m_end && is_separator(*position, m_type))
+					++position;
+				const char* last = position;
+				while (last != m_end && !is_separator(*last, m_type))
+					++last;
+				m_component = eastl::string_view(position, static_cast<size_t>(last - position));
+			}
+
+			eastl::string_view m_component;
+			const char* m_end = nullptr;
+			path_type m_type = path_type::native_path;
+		};
+		using const_iterator = iterator;
+
+		// Constructors
+		constexpr path_view() noexcept : m_text(), m_type(path_type::native_path) {}
+		constexpr path_view(eastl::string_view const text, path_type const type = path_type::native_path) noexcept :
+		    m_text(text), m_type(type) {}
+		path_view(const char* const string, path_type const type = path_type::native_path) noexcept :
+		    m_text(string, std::strlen(string)), m_type(type) {}
+
+		// Raw access
+		eastl::string_view text() const { return m_text; }
+		path_type type() const { return m_type; }
+		// The path this view covers in full, if it was taken from one. Used to reuse its cached native string.
+		const path* source() const { return m_source; }
+
+		// Components
+		iterator begin() const { return iterator(m_text.data() + root_length(), m_text.data() + m_text.size(), m_type); }
+		iterator end() const {
+			const char* const end = m_text.data() + m_text.size();
+			return iterator(end, end, m_type);
+		}
+
+		bool empty() const { return begin() == end(); }
+		size_t length() const;
+
+		bool is_absolute() const;
+
+		eastl::string_view filename() const;
+		eastl::string_view extension() const;
+		path_view parent() const;
+
+		// Hash of the components, equal to path::hash() of the same path. Lets tables keyed by path be searched with views.
+		size_t hash() const;
+
+		// Comparison Operators
+		bool operator==(const path_view& p) const;
+		bool operator!=(const path_view& p) const { return !(*this == p); }
+
+		static constexpr bool is_separator(char const c, path_type const type) { return c == '/' || (type == path_type::windows_path && c == '\\'); }
+
+	  private:
+		friend class path;
+
+		path_view(eastl::string_view const text, path_type const type, const path* const source) noexcept :
+		    m_text(text), m_type(type), m_source(source) {}
+
+		// Number of characters in front of the first component that are not separators (the \\?\ prefix)
+		size_t root_length() const;
+
+		eastl::string_view m_text;
+		path_type m_type;
+		const path* m_source = nullptr;
+	};
+
+	// Printing
+	BVESTL_FS_EXPORT std::ostream& operator<<(std::ostream& os, const path_view& path);
+} // namespace bvestl::fs
@@ -10,10 +10,51 @@
 #pragma once
 
 #include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/directory_handle.hpp"
+#include "bvestl/fs/directory_index.hpp"
+#include "bvestl/fs/pack.hpp"
 #include "bvestl/fs/path.hpp"
+#include "bvestl/fs/internal/vector.hpp"
+#include <EASTL/span.h>
 #include <EASTL/vector.h>
+#include <cstddef>
+#include <cstdint>
 
 namespace bvestl::fs {
+	struct resolver_cache_options {
+		// Drop cached results when something changes below the search paths (inotify, Linux only)
+		bool watch = true;
+		// Look results up again once they are this old; 0 keeps them until invalidated
+		std::uint64_t ttl_ms = 0;
+		// Results kept before the cache starts over
+		size_t max_entries = 64 * 1024;
+		// Directories watched at once before the cache starts over; each one holds a kernel inotify watch
+		size_t max_watches = 4096;
+	};
+
+	enum class case_sensitivity : std::uint8_t {
+		sensitive,   // Names must match the search paths' contents as spelled
+		insensitive, // Names that don't exist as spelled are matched ignoring case, as on Windows
+	};
+
+	struct resolve_options {
+		// Worker count, including the calling thread. 0 uses one per hardware thread.
+		size_t threads = 0;
+	};
+
+	// Outcome of one name in resolver::resolve_many()
+	struct resolved {
+		static constexpr size_t npos = static_cast<size_t>(-1);
+
+		explicit resolved(bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) : result(handle) {}
+
+		bool found() const { return root != npos; }
+
+		// What resolve() would return: the full path, or the name itself when nothing has it
+		path result;
+		// Index of the search path it was found under
+		size_t root = npos;
+	};
 
 	/**
 	 * \brief Simple class for resolving paths on Linux/Windows/Mac OS
@@ -21,15 +62,22 @@ namespace bvestl::fs {
 	 * This convenience class looks for a file or directory given its name
 	 * and a set of search paths. The implementation walks through the
 	 * search paths in order and stops once the file is found.
+	 *
+	 * A search path may also be a mapped_pack, searched as if it were the
+	 * directory its entries were packed from. Names found in it resolve
+	 * below the pack's own path, and open() reads them from the pack.
 	 */
 	class BVESTL_FS_EXPORT resolver {
 	  public:
 		using iterator = internal::vector<path>::iterator;
 		using const_iterator = internal::vector<path>::const_iterator;
 
-		explicit resolver(bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) : m_paths(handle) {
-			m_paths.push_back(cwd());
-		}
+		explicit resolver(bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+		resolver(const resolver& other);
+		resolver(resolver&& other) noexcept;
+		resolver& operator=(const resolver& other);
+		resolver& operator=(resolver&& other) noexcept;
+		~resolver();
 
 		size_t size() const { return m_paths.size(); }
 
@@ -39,19 +87,122 @@ namespace bvestl::fs {
 		const_iterator begin() const { return m_paths.begin(); }
 		const_iterator end() const { return m_paths.end(); }
 
-		void erase(iterator const it) { m_paths.erase(it); }
+		void erase(iterator it);
 
-		void prepend(const path& path) { m_paths.insert(m_paths.begin(), path); }
-		void append(const path& path) { m_paths.push_back(path); }
+		void prepend(const path& path);
+		void append(const path& path);
+		// Searches \p pack, which must outlive the resolver and its copies. Its search path is pack.file().
+		void prepend(const mapped_pack& pack);
+		void append(const mapped_pack& pack);
 		const path& operator[](size_t const index) const { return m_paths[index]; }
 		path& operator[](size_t const index) { return m_paths[index]; }
 
+		/**
+		 * Reopens the directory handle of every search path. Paths edited in place through
+		 * iterators or operator[] are resolved through their full path until then.
+		 */
+		void reopen_roots();
+
 		path resolve(const path& value) const;
 
+		/**
+		 * Resolves \p value and opens what it names, whether it is a loose file, which
+		 * gets mapped, or an entry of a pack. Absolute names are opened as they are;
+		 * a relative one that no search path has fails with no_such_file_or_directory.
+		 */
+		file_contents open(const path& value, std::error_code& ec) const;
+
+		/**
+		 * Resolves every name of \p values into the matching element of \p out, which
+		 * must be as long. Duplicates are looked up once. The names are split into
+		 * chunks shared by a pool of threads, and each chunk is tried against one
+		 * search path at a time, in priority order, so a search path is visited for a
+		 * whole group of names at once. Answers come from the index when there is one.
+		 * Absolute names aren't searched for and come back unresolved.
+		 */
+		bool resolve_many(eastl::span<const path> values, eastl::span<resolved> out, resolve_options const& options = resolve_options()) const;
+
+		/**
+		 * Remembers what resolve() returns for each relative path, found or not, so
+		 * repeating a lookup is one hash probe with no system call. Changing the
+		 * search paths through erase(), prepend(), append() or reopen_roots() drops
+		 * the cache; after editing them in place, call invalidate().
+		 *
+		 * With \c watch on Linux, every directory a lookup went through is watched
+		 * with inotify and any change below them drops the whole cache, shortly
+		 * after it happens. Elsewhere, rely on \c ttl_ms or invalidate(). The
+		 * watches go with the results, and reaching \c max_entries or
+		 * \c max_watches drops both.
+		 */
+		void enable_cache(resolver_cache_options const& options = resolver_cache_options());
+		void disable_cache();
+		bool cache_enabled() const { return m_cache != nullptr; }
+		// Forget every cached result. Safe to call while other threads resolve.
+		void invalidate() const;
+
+		/**
+		 * Scans every search path once, in parallel, into a directory_index. resolve()
+		 * then answers relative paths from it by priority without touching the disk,
+		 * until the search paths change through erase(), prepend() or append(). Copies
+		 * of the resolver don't carry the index.
+		 */
+		bool build_index(std::error_code& ec, index_options const& options = index_options());
+		// Adopts a prebuilt index, such as one from load_directory_index(). False if its roots aren't the search paths.
+		bool use_index(directory_index&& index);
+		void drop_index();
+		bool has_index() const { return !m_index.empty(); }
+		const directory_index& index() const { return m_index; }
+
+		/**
+		 * In case_sensitivity::insensitive mode, a relative name that no search path has
+		 * as spelled is looked up again ignoring case, and resolves to the spelling on
+		 * disk. Every directory visited that way is listed once into a table keyed by
+		 * case-folded names (simple Unicode folding), so correcting a name costs one
+		 * probe per component. Names that exist as spelled never reach it.
+		 *
+		 * Listings are kept until invalidate() or a change of search paths, and while
+		 * the cache watches for changes, until something changes in them.
+		 */
+		void set_case_sensitivity(case_sensitivity mode);
+		case_sensitivity sensitivity() const { return m_folded != nullptr ? case_sensitivity::insensitive : case_sensitivity::sensitive; }
+
 		friend BVESTL_FS_EXPORT std::ostream& operator<<(std::ostream&, const resolver&);
 
 	  private:
+		struct cache;
+		struct folded;
+
+		// What resolve() does, returning the index of the search path \p found is below, or resolved::npos
+		size_t locate(const path& value, path& found) const;
+		// The uncached search
+		size_t lookup(const path& value, path& found) const;
+		// The index's answer, with the packs before it, which it doesn't cover, asked first
+		size_t find_indexed(const path& value) const;
+		// Whether search path \p index has \p value
+		bool exists_in(size_t index, const path& value) const;
+		// The search ignoring case; \p found gets the spelling on disk
+		size_t lookup_folded(const path& value, path& found) const;
+		// Spelling on disk of \p value below search path \p index, ignoring case
+		bool correct_in(size_t index, const path& value, path& corrected) const;
+
 		internal::vector<path> m_paths;
+		struct root {
+			// Search path the handle was opened for
+			path opened;
+			// Closed if the directory couldn't be opened, and for packs
+			directory_handle directory;
+			const mapped_pack* pack = nullptr;
+		};
+
+		// Sets up m_roots for m_paths, keeping the pack of each position in \p previous
+		void open_roots(const internal::vector<root>& previous);
+
+		// One per search path, so candidates are looked up relative to an open directory instead of walking the full path
+		internal::vector<root> m_roots;
+		cache* m_cache = nullptr;
+		// Case-folded directory listings, only in case_sensitivity::insensitive mode
+		folded* m_folded = nullptr;
+		directory_index m_index;
 	};
 
 	BVESTL_FS_EXPORT std::ostream& operator<<(std::ostream& os, const resolver& r);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "bvestl/fs/internal/path_hash.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <EASTL/string_view.h>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace bvestl::fs {
+	namespace internal {
+		// Where one component lies in the text of a path
+		struct path_component {
+			std::uint32_t offset;
+			std::uint32_t length;
+		};
+	} // namespace internal
+
+	/**
+	 * \brief An already parsed path stored elsewhere, in the form path keeps its own
+	 *
+	 * POSIX text with single separators, a leading '/' for absolute POSIX paths
+	 * and a null terminator, the table of its components and their hash. path
+	 * copies one in, or joins it onto another, without parsing it again.
+	 */
+	struct path_literal {
+		const char* text;
+		// Not counting the terminator
+		size_t text_length;
+		const internal::path_component* components;
+		size_t count;
+		std::uint64_t hash;
+		path_type type;
+		bool absolute;
+	};
+
+	/**
+	 * \brief Path parsed at compile time, for constants
+	 *
+	 *     static constexpr static_path objects("data/objects");
+	 *     path const model = objects / name;
+	 *
+	 * Parses like path does and rejects text with embedded null characters at
+	 * compile time. Declared static constexpr, the text and component table sit in
+	 * read-only storage, and turning it into a path or joining it with one copies
+	 * them instead of parsing. Views of it are only valid as long as it is.
+	 */
+	template <size_t N>
+	class static_path {
+	  public:
+		constexpr static_path(const char (&string)[N], path_type const type = path_type::native_path) : m_type(type) {
+			size_t begin = 0;
+			size_t const end = N - 1;
+			for (size_t i = 0; i < end; ++i) {
+				if (string[i] == '\0')
+					throw std::invalid_argument("static_path: embedded null character");
+			}
+
+			bool const windows = type == path_type::windows_path;
+			if (windows) {
+				// The \\?\ prefix is dropped, as path does
+				if (end >= 4 && string[0] == '\\' && string[1] == '\\' && string[2] == '?' && string[3] == '\\')
+					begin = 4;
+				m_absolute = end - begin >= 2 && is_letter(string[begin]) && string[begin + 1] == ':';
+			}
+			else {
+				m_absolute = end != 0 && string[0] == '/';
+			}
+
+			if (m_absolute && !windows)
+				m_text[m_text_length++] = '/';
+			size_t start = begin;
+			for (size_t i = begin; i <= end; ++i) {
+				if (i != end && !path_view::is_separator(string[i], type))
+					continue;
+				if (i != start) {
+					if (m_count != 0)
+						m_text[m_text_length++] = '/';
+					m_components[m_count++] = internal::path_component{static_cast<std::uint32_t>(m_text_length),
+					                                                   static_cast<std::uint32_t>(i - start)};
+					for (size_t j = start; j < i; ++j)
+						m_text[m_text_length++] = string[j];
+					m_hash = internal::hash_component(m_hash, eastl::string_view(string + start, i - start));
+				}
+				start = i + 1;
+			}
+			m_text[m_text_length] = '\0';
+		}
+
+		constexpr operator path_literal() const {
+			return path_literal{m_text, m_text_length, m_components, m_count, m_hash, m_type, m_absolute};
+		}
+		constexpr operator path_view() const { return path_view(text(), m_type); }
+
+		constexpr eastl::string_view text() const { return eastl::string_view(m_text, m_text_length); }
+		constexpr const char* c_str() const { return m_text; }
+		constexpr path_type type() const { return m_type; }
+		constexpr bool empty() const { return m_count == 0; }
+		constexpr size_t length() const { return m_count; }
+		constexpr bool is_absolute() const { return m_absolute; }
+		// Equal to path::hash() of the same path
+		constexpr size_t hash() const { return static_cast<size_t>(m_hash); }
+
+	  private:
+		static constexpr bool is_letter(char const c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+		// Parsing never lengthens the text, and every component but the last takes a separator
+		char m_text[N + 1] = {};
+		internal::path_component m_components[N / 2 + 1] = {};
+		size_t m_text_length = 0;
+		size_t m_count = 0;
+		std::uint64_t m_hash = internal::PATH_HASH_OFFSET;
+		path_type m_type;
+		bool m_absolute = false;
+	};
+} // namespace bvestl::fs
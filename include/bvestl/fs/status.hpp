@@ -0,0 +1,86 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <cinttypes>
+#include <system_error>
+
+namespace bvestl::fs {
+	enum class file_type : std::uint8_t {
+		none = 0,  // Status could not be determined, see the error code
+		not_found, // Nothing exists at the path
+		regular,
+		directory,
+		symlink,
+		block,
+		character,
+		fifo,
+		socket,
+		unknown,
+	};
+
+	/**
+	 * \brief Fields of a file_status to query
+	 *
+	 * Asking only for what is needed lets filesystems skip the rest. Fields that
+	 * were not asked for, or that the filesystem couldn't provide, are left zeroed.
+	 */
+	enum class status_mask : std::uint32_t {
+		none = 0,
+		type = 1u << 0,
+		permissions = 1u << 1,
+		size = 1u << 2,
+		mtime = 1u << 3,
+		inode = 1u << 4, // Inode and device
+		all = type | permissions | size | mtime | inode,
+	};
+
+	constexpr status_mask operator|(status_mask const lhs, status_mask const rhs) {
+		return static_cast<status_mask>(static_cast<std::uint32_t>(lhs) | static_cast<std::uint32_t>(rhs));
+	}
+	constexpr status_mask operator&(status_mask const lhs, status_mask const rhs) {
+		return static_cast<status_mask>(static_cast<std::uint32_t>(lhs) & static_cast<std::uint32_t>(rhs));
+	}
+	constexpr bool any(status_mask const mask) {
+		return mask != status_mask::none;
+	}
+
+	/**
+	 * \brief Everything known about a file after a single query
+	 */
+	struct file_status {
+		file_type type = file_type::none;
+		// POSIX permission bits (07777). Windows only reports read-only files.
+		std::uint32_t permissions = 0;
+		std::uint64_t size = 0;
+		// Last modification in nanoseconds since the Unix epoch
+		std::int64_t mtime_ns = 0;
+		std::uint64_t inode = 0;
+		std::uint64_t device = 0;
+		// Fields actually filled in
+		status_mask valid = status_mask::none;
+
+		bool exists() const { return type != file_type::none && type != file_type::not_found; }
+		bool is_regular_file() const { return type == file_type::regular; }
+		bool is_directory() const { return type == file_type::directory; }
+		bool is_symlink() const { return type == file_type::symlink; }
+	};
+
+	/**
+	 * \brief Query a file with one system call (statx on Linux), following symlinks
+	 *
+	 * Errors are not thrown. A missing file is not an error: it is reported as
+	 * file_type::not_found with a cleared error code. Any other failure sets
+	 * \p ec and returns file_type::none.
+	 */
+	BVESTL_FS_EXPORT file_status status(path_view p,
+	                                    std::error_code& ec,
+	                                    status_mask mask = status_mask::all,
+	                                    bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+	// Same as status(), but reports a symlink itself rather than its target
+	BVESTL_FS_EXPORT file_status symlink_status(path_view p,
+	                                            std::error_code& ec,
+	                                            status_mask mask = status_mask::all,
+	                                            bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+} // namespace bvestl::fs
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "bvestl/fs/allocation.hpp"
+#include "bvestl/fs/api.hpp"
+#include "bvestl/fs/directory_iterator.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/path_view.hpp"
+#include <EASTL/type_traits.h>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+namespace bvestl::fs {
+	// What the walk does after a visitor has seen an entry
+	enum class walk_action : std::uint8_t {
+		proceed,      // Continue, descending if the entry is a directory
+		skip_subtree, // Continue, but don't descend into this directory
+		stop,         // Abandon the walk as soon as possible
+	};
+
+	enum class symlink_policy : std::uint8_t {
+		report, // Visit symlinks as entries, never descend through them
+		follow, // Visit symlinks, descending if they point at a directory that isn't one of their ancestors
+		skip,   // Don't visit symlinks at all
+	};
+
+	struct walk_options {
+		// Worker count, including the calling thread. 0 uses one per hardware thread.
+		size_t threads = 0;
+		// Deepest level descended into; entries of the root itself are at depth 0
+		size_t max_depth = static_cast<size_t>(-1);
+		symlink_policy symlinks = symlink_policy::report;
+		// Skip directories that can't be opened for lack of permission instead of failing
+		bool skip_permission_denied = false;
+		// Bytes of directory entries fetched from the OS per batch
+		size_t buffer_size = 32 * 1024;
+		/**
+		 * Optional array of \c threads allocators, one per worker, used for that worker's
+		 * buffers and the directories it discovers. A directory may be released by another
+		 * worker than the one that allocated it, so these must accept deallocation from
+		 * any thread (arenas that ignore deallocation qualify).
+		 */
+		const bvestl::polyalloc::allocator_handle* thread_allocators = nullptr;
+	};
+
+	struct walk_result {
+		explicit walk_result(bvestl::polyalloc::allocator_handle const handle) : failed_path(handle) {}
+
+		// First error that stopped the walk
+		std::error_code error;
+		// Where that error happened, relative to the root: empty if the root itself couldn't be opened
+		path failed_path;
+		std::uint64_t entries = 0;
+		std::uint64_t directories = 0;
+		// Symlinked directories not descended into because they lead back to one of their ancestors
+		std::uint64_t symlink_loops = 0;
+	};
+
+	/**
+	 * \brief Type-erased visitor for parallel_walk()
+	 *
+	 * enter is called for every entry below the root. leave, if set, is called
+	 * for every visited subdirectory once all of its contents have been visited,
+	 * with the same entry (the directory is still open, so entry.status() and
+	 * fd-relative operations on it keep working).
+	 */
+	struct walk_callbacks {
+		void* context = nullptr;
+		walk_action (*enter)(void* context, const directory_entry& entry, size_t thread) = nullptr;
+		void (*leave)(void* context, const directory_entry& entry, size_t thread) = nullptr;
+	};
+
+	/**
+	 * \brief Walks a directory tree on a work-stealing pool of threads
+	 *
+	 * Each directory is listed by one worker; the subdirectories it finds are
+	 * pushed on that worker's queue and stolen by idle ones. Directories are
+	 * opened relative to their parent's descriptor, so no worker ever rebuilds
+	 * a full path. Callbacks run concurrently and in no particular order,
+	 * except that leave() on a directory happens after everything below it.
+	 */
+	BVESTL_FS_EXPORT walk_result parallel_walk(path_view root,
+	                                           walk_callbacks const& callbacks,
+	                                           walk_options const& options = walk_options(),
+	                                           bvestl::polyalloc::allocator_handle handle BVESTL_FS_GET_GLOBAL_ALLOC);
+
+	namespace internal {
+		template <class Visitor, class = void>
+		struct has_leave : eastl::false_type {};
+		template <class Visitor>
+		struct has_leave<Visitor, eastl::void_t<decltype(eastl::declval<Visitor&>().leave(eastl::declval<const directory_entry&>(), size_t()))>>
+		    : eastl::true_type {};
+	} // namespace internal
+
+	/**
+	 * \brief parallel_walk() over any callable taking (const directory_entry&, size_t thread)
+	 *
+	 * The callable may return a walk_action or nothing. If it also has a
+	 * leave(const directory_entry&, size_t thread) member it gets post-order
+	 * notifications for directories.
+	 */
+	template <class Visitor, class = eastl::enable_if_t<!eastl::is_same_v<eastl::decay_t<Visitor>, walk_callbacks>>>
+	walk_result parallel_walk(path_view const root,
+	                          Visitor&& visitor,
+	                          walk_options const& options = walk_options(),
+	                          bvestl::polyalloc::allocator_handle const handle BVESTL_FS_GET_GLOBAL_ALLOC) {
+		using visitor_type = eastl::remove_reference_t<Visitor>;
+
+		walk_callbacks callbacks;
+		callbacks.context = const_cast<void*>(static_cast<const void*>(&visitor));
+		callbacks.enter = [](void* const context, const directory_entry& entry, size_t const thread) -> walk_action {
+			auto& v = *static_cast<visitor_type*>(context);
+			if constexpr (eastl::is_same_v<decltype(v(entry, thread)), void>) {
+				v(entry, thread);
+				return walk_action::proceed;
+			}
+			else {
+				return v(entry, thread);
+			}
+		};
+		if constexpr (internal::has_leave<visitor_type>::value) {
+			callbacks.leave = [](void* const context, const directory_entry& entry, size_t const thread) {
+				static_cast<visitor_type*>(context)->leave(entry, thread);
+			};
+		}
+		return parallel_walk(root, callbacks, options, handle);
+	}
+} // namespace bvestl::fs
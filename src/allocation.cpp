@@ -1,4 +1,8 @@
 #include "bvestl/fs/allocation.hpp"
+#include <EABase/config/eaplatform.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
 #include <mutex>
 
 namespace bvestl::fs {
@@ -12,23 +16,73 @@ namespace bvestl::fs {
 
 		~mallocator() override = default;
 
+#if defined(EA_PLATFORM_WINDOWS)
+		// Everything comes from _aligned_malloc so deallocate() doesn't need to know which kind it got
+		void* allocate(size_t n, int = 0) override { return _aligned_malloc(n, alignof(std::max_align_t)); }
+		void* allocate(size_t n, size_t alignment, size_t, int = 0) override {
+			return _aligned_malloc(n, alignment > alignof(std::max_align_t) ? alignment : alignof(std::max_align_t));
+		}
+		void deallocate(void* p, size_t) override { _aligned_free(p); }
+#else
 		void* allocate(size_t n, int = 0) override { return malloc(n); }
-		void* allocate(size_t n, size_t, size_t, int = 0) override { return malloc(n); }
+		// Over-aligned requests, such as direct I/O buffers, can't be served by malloc
+		void* allocate(size_t n, size_t alignment, size_t, int = 0) override {
+			if (alignment <= alignof(std::max_align_t))
+				return malloc(n);
+			void* p = nullptr;
+			return posix_memalign(&p, alignment, n) == 0 ? p : nullptr;
+		}
 		void deallocate(void* p, size_t) override { free(p); }
+#endif
 	};
 
-	static std::mutex global_alloc_guard;
-	static mallocator global_alloc_mallocator;
-	static bvestl::polyalloc::allocator_handle global_alloc_handle = &global_alloc_mallocator;
+	namespace {
+		// Handles are published once and never modified, so readers can copy them without a lock
+		struct global_slot {
+			bvestl::polyalloc::allocator_handle handle;
+			global_slot* previous;
+		};
+
+		mallocator global_alloc_mallocator;
+		global_slot global_alloc_default{&global_alloc_mallocator, nullptr};
+		std::atomic<global_slot*> global_alloc_current{&global_alloc_default};
+		// Serializes writers only
+		std::mutex global_alloc_guard;
+
+		// Retired slots stay valid for readers that may still hold them, until exit
+		struct global_slot_reaper {
+			~global_slot_reaper() {
+				// Later destructors may still ask for the global allocator, so point it at the default first
+				std::lock_guard lg(global_alloc_guard);
+				global_slot* slot = global_alloc_current.exchange(&global_alloc_default, std::memory_order_acq_rel);
+				while (slot != &global_alloc_default) {
+					global_slot* const previous = slot->previous;
+					delete slot;
+					slot = previous;
+				}
+			}
+		} global_alloc_reaper;
+
+		thread_local const scoped_allocator* scoped_current = nullptr;
+	} // namespace
 
 	void set_global_allocator(bvestl::polyalloc::allocator_handle const& handle) {
 		std::lock_guard lg(global_alloc_guard);
-		global_alloc_handle = handle;
+		auto* const slot = new global_slot{handle, global_alloc_current.load(std::memory_order_relaxed)};
+		global_alloc_current.store(slot, std::memory_order_release);
 	}
 
 	bvestl::polyalloc::allocator_handle get_global_allocator() {
-		std::lock_guard lg(global_alloc_guard);
-		return global_alloc_handle;
+		if (scoped_current != nullptr)
+			return scoped_current->m_handle;
+		return global_alloc_current.load(std::memory_order_acquire)->handle;
 	}
 
+	scoped_allocator::scoped_allocator(bvestl::polyalloc::allocator_handle const& handle) : m_handle(handle), m_previous(scoped_current) {
+		scoped_current = this;
+	}
+
+	scoped_allocator::~scoped_allocator() {
+		scoped_current = m_previous;
+	}
 } // namespace bvestl::fs
@@ -0,0 +1,433 @@
+#include "bvestl/fs/allocators.hpp"
+#include <EASTL/algorithm.h>
+#include <mutex>
+#include <new>
+
+namespace bvestl::fs {
+	namespace {
+		const size_t MAX_ALIGN = alignof(std::max_align_t);
+
+		size_t align_up(size_t const value, size_t const alignment) {
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+		// Index of the smallest power-of-two class from 16 bytes that holds \p size
+		size_t class_index(size_t const size) {
+			size_t index = 0;
+			for (size_t c = pool_allocator::MIN_CLASS; c < size; c <<= 1)
+				++index;
+			return index;
+		}
+
+		size_t class_size(size_t const index) {
+			return pool_allocator::MIN_CLASS << index;
+		}
+
+		struct free_block {
+			free_block* next;
+		};
+	} // namespace
+
+	//////////////////////
+	// monotonic_arena //
+	//////////////////////
+
+	struct monotonic_arena::block {
+		block* next;
+		// Usable bytes after the header
+		size_t size;
+
+		static size_t header() { return align_up(sizeof(block), MAX_ALIGN); }
+		char* data() { return reinterpret_cast<char*>(this) + header(); }
+	};
+
+	monotonic_arena::monotonic_arena(size_t const block_size, bvestl::polyalloc::allocator_handle const upstream)
+	    : m_upstream(upstream), m_block_size(block_size) {}
+
+	monotonic_arena::monotonic_arena(void* const buffer,
+	                                 size_t const size,
+	                                 size_t const block_size,
+	                                 bvestl::polyalloc::allocator_handle const upstream)
+	    : m_upstream(upstream), m_block_size(block_size), m_initial(static_cast<char*>(buffer)), m_initial_size(size) {
+		reset();
+	}
+
+	monotonic_arena::~monotonic_arena() {
+		release();
+	}
+
+	void* monotonic_arena::allocate(size_t const n, int const flags) {
+		return allocate(n, MAX_ALIGN, 0, flags);
+	}
+
+	void* monotonic_arena::allocate(size_t const n, size_t alignment, size_t const offset, int) {
+		alignment = eastl::max<size_t>(alignment, 1);
+		for (;;) {
+			if (m_position != nullptr) {
+				// p + offset must be aligned
+				auto const address = reinterpret_cast<std::uintptr_t>(m_position);
+				char* const p = m_position + (align_up(address + offset, alignment) - offset - address);
+				if (p <= m_end && static_cast<size_t>(m_end - p) >= n) {
+					m_position = p + n;
+					m_last = p;
+					m_used += n;
+					return p;
+				}
+			}
+			if (!grow(n + offset, alignment))
+				return nullptr;
+		}
+	}
+
+	void monotonic_arena::deallocate(void* const p, size_t const n) {
+		// Only the latest allocation can be taken back
+		if (p != nullptr && p == m_last) {
+			m_position = m_last;
+			m_last = nullptr;
+			m_used -= n;
+		}
+	}
+
+	bool monotonic_arena::grow(size_t const n, size_t const alignment) {
+		size_t const needed = n + alignment;
+		block* const next = m_current != nullptr ? m_current->next : m_first;
+		block* b = next;
+		if (b == nullptr || b->size < needed) {
+			// Keep the too small successor for later resets, put a fitting block in front of it
+			size_t const size = eastl::max(m_block_size, needed);
+			b = static_cast<block*>(m_upstream.allocate(block::header() + size, MAX_ALIGN, 0));
+			if (b == nullptr)
+				return false;
+			b->size = size;
+			b->next = next;
+			if (m_current != nullptr)
+				m_current->next = b;
+			else
+				m_first = b;
+		}
+		m_current = b;
+		m_position = b->data();
+		m_end = m_position + b->size;
+		m_last = nullptr;
+		return true;
+	}
+
+	void monotonic_arena::reset() {
+		m_current = nullptr;
+		m_last = nullptr;
+		m_used = 0;
+		if (m_initial != nullptr) {
+			m_position = m_initial;
+			m_end = m_initial + m_initial_size;
+		}
+		else if (m_first != nullptr) {
+			m_current = m_first;
+			m_position = m_first->data();
+			m_end = m_position + m_first->size;
+		}
+		else {
+			m_position = nullptr;
+			m_end = nullptr;
+		}
+	}
+
+	void monotonic_arena::release() {
+		block* b = m_first;
+		while (b != nullptr) {
+			block* const next = b->next;
+			m_upstream.deallocate(b, block::header() + b->size);
+			b = next;
+		}
+		m_first = nullptr;
+		reset();
+	}
+
+	/////////////////////
+	// pool_allocator //
+	/////////////////////
+
+	struct pool_allocator::chunk {
+		chunk* next;
+		size_t size;
+	};
+
+	pool_allocator::pool_allocator(size_t const chunk_size, bvestl::polyalloc::allocator_handle const upstream)
+	    : m_upstream(upstream), m_chunk_size(align_up(eastl::max(chunk_size, 4 * MAX_CLASS), MAX_CLASS)) {}
+
+	pool_allocator::~pool_allocator() {
+		chunk* c = m_chunks;
+		while (c != nullptr) {
+			chunk* const next = c->next;
+			m_upstream.deallocate(c, c->size);
+			c = next;
+		}
+		if (m_foreign != nullptr)
+			m_upstream.deallocate(m_foreign, m_foreign_capacity * sizeof(void*));
+	}
+
+	void* pool_allocator::allocate(size_t const n, int const flags) {
+		return allocate(n, MAX_ALIGN, 0, flags);
+	}
+
+	void* pool_allocator::allocate(size_t const n, size_t alignment, size_t const offset, int const flags) {
+		if (n > MAX_CLASS)
+			return m_upstream.allocate(n, alignment, offset, flags);
+		alignment = eastl::max<size_t>(alignment, 1);
+		// Blocks are aligned to their class size, so a bigger class satisfies a bigger alignment,
+		// and p + offset keeps it when the offset is a multiple of it
+		if (alignment > MAX_CLASS || offset % alignment != 0)
+			return allocate_foreign(n, alignment, offset, flags);
+		size_t const index = class_index(eastl::max(n, alignment));
+		auto* const block = static_cast<free_block*>(m_free[index]);
+		if (block == nullptr)
+			return refill(index);
+		m_free[index] = block->next;
+		return block;
+	}
+
+	void pool_allocator::deallocate(void* const p, size_t const n) {
+		if (p == nullptr)
+			return;
+		if (n > MAX_CLASS || (m_foreign_count != 0 && release_foreign(p))) {
+			m_upstream.deallocate(p, n);
+			return;
+		}
+		// An over-aligned block lands in a smaller class than it came from, which only wastes its tail
+		size_t const index = class_index(n);
+		auto* const block = static_cast<free_block*>(p);
+		block->next = static_cast<free_block*>(m_free[index]);
+		m_free[index] = block;
+	}
+
+	void* pool_allocator::allocate_foreign(size_t const n, size_t const alignment, size_t const offset, int const flags) {
+		if (m_foreign_count == m_foreign_capacity) {
+			size_t const capacity = eastl::max<size_t>(m_foreign_capacity * 2, 8);
+			auto* const grown = static_cast<void**>(m_upstream.allocate(capacity * sizeof(void*), alignof(void*), 0));
+			if (grown == nullptr)
+				return nullptr;
+			eastl::copy(m_foreign, m_foreign + m_foreign_count, grown);
+			if (m_foreign != nullptr)
+				m_upstream.deallocate(m_foreign, m_foreign_capacity * sizeof(void*));
+			m_foreign = grown;
+			m_foreign_capacity = capacity;
+		}
+		void* const p = m_upstream.allocate(n, alignment, offset, flags);
+		if (p != nullptr)
+			m_foreign[m_foreign_count++] = p;
+		return p;
+	}
+
+	bool pool_allocator::release_foreign(void* const p) {
+		// Searched newest first, since blocks tend to die in reverse order
+		for (size_t i = m_foreign_count; i > 0; --i) {
+			if (m_foreign[i - 1] == p) {
+				m_foreign[i - 1] = m_foreign[--m_foreign_count];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void* pool_allocator::refill(size_t const index) {
+		// The header takes the first MAX_CLASS bytes so every block after it stays aligned to its class
+		auto* const c = static_cast<chunk*>(m_upstream.allocate(m_chunk_size, MAX_CLASS, 0));
+		if (c == nullptr)
+			return nullptr;
+		c->size = m_chunk_size;
+		c->next = m_chunks;
+		m_chunks = c;
+
+		size_t const size = class_size(index);
+		char* const first = reinterpret_cast<char*>(c) + MAX_CLASS;
+		size_t const count = (m_chunk_size - MAX_CLASS) / size;
+		// The first block is returned, the rest go on the free list lowest address first
+		auto* head = static_cast<free_block*>(m_free[index]);
+		for (size_t i = count - 1; i > 0; --i) {
+			auto* const block = reinterpret_cast<free_block*>(first + i * size);
+			block->next = head;
+			head = block;
+		}
+		m_free[index] = head;
+		return first;
+	}
+
+	/////////////////////////////
+	// thread_cache_allocator //
+	/////////////////////////////
+
+	struct thread_cache_allocator::cache {
+		cache* next = nullptr;
+		// Owned by a thread right now
+		std::atomic<bool> in_use{true};
+		free_block* free[CLASS_COUNT] = {};
+		size_t counts[CLASS_COUNT] = {};
+	};
+
+	namespace internal {
+		/**
+		 * The caches of the current thread, by allocator. Entries of destroyed
+		 * allocators are never matched again since ids aren't reused.
+		 */
+		struct thread_cache_table {
+			static const size_t SLOTS = 4;
+
+			struct slot {
+				std::uint64_t id = 0;
+				thread_cache_allocator::cache* cache = nullptr;
+			};
+
+			static std::mutex& registry_lock() {
+				static std::mutex lock;
+				return lock;
+			}
+			static thread_cache_allocator*& registry() {
+				static thread_cache_allocator* head = nullptr;
+				return head;
+			}
+
+			// Hand \p s back for adoption, unless its allocator is already gone
+			static void give_back(slot const& s) {
+				if (s.id == 0)
+					return;
+				std::lock_guard<std::mutex> lg(registry_lock());
+				for (thread_cache_allocator* a = registry(); a != nullptr; a = a->m_next_instance) {
+					if (a->m_id == s.id) {
+						s.cache->in_use.store(false, std::memory_order_release);
+						return;
+					}
+				}
+			}
+
+			~thread_cache_table() {
+				for (slot const& s : slots)
+					give_back(s);
+			}
+
+			slot slots[SLOTS];
+			size_t evict = 0;
+		};
+
+		thread_local thread_cache_table thread_caches;
+	} // namespace internal
+
+	namespace {
+		std::atomic<std::uint64_t> next_cache_id{1};
+	}
+
+	thread_cache_allocator::thread_cache_allocator(size_t const blocks_per_class, bvestl::polyalloc::allocator_handle const upstream)
+	    : m_upstream(upstream), m_limit(blocks_per_class), m_id(next_cache_id.fetch_add(1, std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lg(internal::thread_cache_table::registry_lock());
+		m_next_instance = internal::thread_cache_table::registry();
+		internal::thread_cache_table::registry() = this;
+	}
+
+	thread_cache_allocator::~thread_cache_allocator() {
+		{
+			// Once out of the registry, exiting threads leave our caches alone
+			std::lock_guard<std::mutex> lg(internal::thread_cache_table::registry_lock());
+			thread_cache_allocator** link = &internal::thread_cache_table::registry();
+			while (*link != this)
+				link = &(*link)->m_next_instance;
+			*link = m_next_instance;
+		}
+		cache* c = m_caches.load(std::memory_order_acquire);
+		while (c != nullptr) {
+			for (size_t i = 0; i < CLASS_COUNT; ++i) {
+				free_block* b = c->free[i];
+				while (b != nullptr) {
+					free_block* const next = b->next;
+					m_upstream.deallocate(b, class_size(i));
+					b = next;
+				}
+			}
+			cache* const next = c->next;
+			c->~cache();
+			m_upstream.deallocate(c, sizeof(cache));
+			c = next;
+		}
+	}
+
+	thread_cache_allocator::cache& thread_cache_allocator::local() {
+		internal::thread_cache_table& table = internal::thread_caches;
+		for (auto const& s : table.slots) {
+			if (s.id == m_id)
+				return *s.cache;
+		}
+
+		// Adopt one left behind by an exited thread, or make a new one
+		cache* found = nullptr;
+		for (cache* c = m_caches.load(std::memory_order_acquire); c != nullptr; c = c->next) {
+			bool expected = false;
+			if (!c->in_use.load(std::memory_order_relaxed) && c->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+				found = c;
+				break;
+			}
+		}
+		if (found == nullptr) {
+			found = new (m_upstream.allocate(sizeof(cache), alignof(cache), 0)) cache();
+			found->next = m_caches.load(std::memory_order_relaxed);
+			while (!m_caches.compare_exchange_weak(found->next, found, std::memory_order_release, std::memory_order_relaxed)) {
+			}
+		}
+
+		internal::thread_cache_table::slot* target = nullptr;
+		for (auto& s : table.slots) {
+			if (s.id == 0) {
+				target = &s;
+				break;
+			}
+		}
+		if (target == nullptr) {
+			target = &table.slots[table.evict++ % internal::thread_cache_table::SLOTS];
+			internal::thread_cache_table::give_back(*target);
+		}
+		target->id = m_id;
+		target->cache = found;
+		return *found;
+	}
+
+	void* thread_cache_allocator::allocate(size_t const n, int const flags) {
+		return allocate(n, MAX_ALIGN, 0, flags);
+	}
+
+	void* thread_cache_allocator::allocate(size_t const n, size_t alignment, size_t const offset, int const flags) {
+		if (n > MAX_CLASS)
+			return m_upstream.allocate(n, alignment, offset, flags);
+		alignment = eastl::max<size_t>(alignment, 1);
+		size_t const index = class_index(n);
+		// Taken at the full class size so that deallocate() can cache it like any other block, unless
+		// the offset leaves it misaligned for that, which deallocate() notices
+		if (alignment > MAX_ALIGN || offset % alignment != 0)
+			return m_upstream.allocate(class_size(index), alignment, offset, flags);
+		cache& c = local();
+		free_block* const b = c.free[index];
+		if (b == nullptr)
+			return m_upstream.allocate(class_size(index), MAX_ALIGN, 0, flags);
+		c.free[index] = b->next;
+		--c.counts[index];
+		return b;
+	}
+
+	void thread_cache_allocator::deallocate(void* const p, size_t const n) {
+		if (p == nullptr)
+			return;
+		if (n > MAX_CLASS) {
+			m_upstream.deallocate(p, n);
+			return;
+		}
+		size_t const index = class_index(n);
+		if ((reinterpret_cast<std::uintptr_t>(p) & (MAX_ALIGN - 1)) != 0) {
+			m_upstream.deallocate(p, class_size(index));
+			return;
+		}
+		cache& c = local();
+		if (c.counts[index] >= m_limit) {
+			m_upstream.deallocate(p, class_size(index));
+			return;
+		}
+		auto* const b = static_cast<free_block*>(p);
+		b->next = c.free[index];
+		c.free[index] = b;
+		++c.counts[index];
+	}
+} // namespace bvestl::fs
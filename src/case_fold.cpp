@@ -0,0 +1,140 @@
+#include "bvestl/fs/internal/case_fold.hpp"
+#include "bvestl/fs/internal/path_hash.hpp"
+
+namespace bvestl::fs::internal {
+	namespace {
+		// Stands in for a byte that doesn't start a well formed sequence, distinct from every code point
+		constexpr char32_t MALFORMED = 0x110000;
+
+		char32_t decode(const char*& position, const char* const end) {
+			auto const lead = static_cast<unsigned char>(*position++);
+			if (lead < 0x80)
+				return lead;
+
+			size_t length;
+			char32_t c;
+			if (lead >= 0xC2 && lead <= 0xDF) {
+				length = 1;
+				c = lead & 0x1F;
+			}
+			else if (lead >= 0xE0 && lead <= 0xEF) {
+				length = 2;
+				c = lead & 0x0F;
+			}
+			else if (lead >= 0xF0 && lead <= 0xF4) {
+				length = 3;
+				c = lead & 0x07;
+			}
+			else {
+				return MALFORMED + lead;
+			}
+			if (static_cast<size_t>(end - position) < length)
+				return MALFORMED + lead;
+			for (size_t i = 0; i < length; ++i) {
+				auto const next = static_cast<unsigned char>(position[i]);
+				if ((next & 0xC0) != 0x80)
+					return MALFORMED + lead;
+				c = (c << 6) | (next & 0x3F);
+			}
+			// Overlong forms, surrogates and anything past U+10FFFF
+			if ((length == 2 && (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF))) || (length == 3 && (c < 0x10000 || c > 0x10FFFF)))
+				return MALFORMED + lead;
+			position += length;
+			return c;
+		}
+
+		// Folds the next character of the name, with plain ASCII kept off the decoder
+		char32_t next_folded(const char*& position, const char* const end) {
+			auto const c = static_cast<unsigned char>(*position);
+			if (c < 0x80) {
+				++position;
+				return c >= 'A' && c <= 'Z' ? c + 0x20u : c;
+			}
+			return fold_case(decode(position, end));
+		}
+	} // namespace
+
+	char32_t fold_case(char32_t const c) {
+		if (c < 0x80)
+			return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+		if (c < 0x100) {
+			if (c == 0xB5)
+				return 0x3BC;
+			return c >= 0xC0 && c <= 0xDE && c != 0xD7 ? c + 0x20 : c;
+		}
+		// Latin Extended-A: upper and lower case alternate, starting on an even or an odd code point
+		if (c < 0x180) {
+			if ((c < 0x130 || (c >= 0x132 && c <= 0x137) || (c >= 0x14A && c <= 0x177)) && c % 2 == 0)
+				return c + 1;
+			if (((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E)) && c % 2 == 1)
+				return c + 1;
+			if (c == 0x178)
+				return 0xFF;
+			if (c == 0x17F)
+				return 's';
+			return c;
+		}
+		if (c >= 0x370 && c < 0x400) {
+			if (c == 0x386)
+				return 0x3AC;
+			if (c >= 0x388 && c <= 0x38A)
+				return c + 37;
+			if (c == 0x38C)
+				return 0x3CC;
+			if (c == 0x38E || c == 0x38F)
+				return c + 63;
+			if (c >= 0x391 && c <= 0x3AB && c != 0x3A2)
+				return c + 0x20;
+			if (c == 0x3C2)
+				return 0x3C3;
+			return c;
+		}
+		if (c >= 0x400 && c < 0x530) {
+			if (c < 0x410)
+				return c + 0x50;
+			if (c < 0x430)
+				return c + 0x20;
+			if (((c >= 0x460 && c <= 0x481) || (c >= 0x48A && c <= 0x4BF) || (c >= 0x4D0 && c <= 0x52F)) && c % 2 == 0)
+				return c + 1;
+			if (c == 0x4C0)
+				return 0x4CF;
+			if (c >= 0x4C1 && c <= 0x4CE && c % 2 == 1)
+				return c + 1;
+			return c;
+		}
+		if (c >= 0x531 && c <= 0x556)
+			return c + 0x30;
+		// Latin Extended Additional, ẞ included
+		if (c >= 0x1E00 && c <= 0x1EFF) {
+			if (c == 0x1E9E)
+				return 0xDF;
+			if ((c <= 0x1E95 || c >= 0x1EA0) && c % 2 == 0)
+				return c + 1;
+			return c;
+		}
+		if (c >= 0xFF21 && c <= 0xFF3A)
+			return c + 0x20;
+		return c;
+	}
+
+	std::uint64_t folded_hash(eastl::string_view const name) {
+		std::uint64_t hash = PATH_HASH_OFFSET;
+		const char* position = name.data();
+		const char* const end = name.data() + name.size();
+		while (position != end)
+			hash = (hash ^ next_folded(position, end)) * PATH_HASH_PRIME;
+		return hash;
+	}
+
+	bool folded_equal(eastl::string_view const a, eastl::string_view const b) {
+		const char* left = a.data();
+		const char* const left_end = a.data() + a.size();
+		const char* right = b.data();
+		const char* const right_end = b.data() + b.size();
+		while (left != left_end && right != right_end) {
+			if (next_folded(left, left_end) != next_folded(right, right_end))
+				return false;
+		}
+		return left == left_end && right == right_end;
+	}
+} // namespace bvestl::fs::internal
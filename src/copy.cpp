@@ -0,0 +1,647 @@
+#include "bvestl/fs/copy.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/status.hpp"
+#include "bvestl/fs/walk.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+#if defined(EA_PLATFORM_LINUX)
+#	include <linux/fs.h>
+#	include <sys/ioctl.h>
+#	include <sys/sendfile.h>
+#	include <sys/syscall.h>
+#elif defined(EA_PLATFORM_APPLE)
+#	include <copyfile.h>
+#endif
+
+#include <atomic>
+#include <mutex>
+
+namespace bvestl::fs {
+	namespace {
+#if defined(EA_PLATFORM_WINDOWS)
+		std::error_code last_error() {
+			return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+		}
+#else
+		std::error_code last_error() {
+			return std::error_code(errno, std::generic_category());
+		}
+
+		// Outcome of one way of moving the data
+		enum class transfer { done, unsupported, failed };
+
+		// Errors meaning this kernel or filesystem can't do it, so the next strategy should be tried
+		bool is_unsupported(int const error) {
+			return error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP || error == ENOTTY || error == EPERM
+			       || error == EBADF;
+		}
+
+		transfer try_reflink(int const source, int const destination) {
+#	if defined(EA_PLATFORM_LINUX) && defined(FICLONE)
+			if (ioctl(destination, FICLONE, source) == 0)
+				return transfer::done;
+#	else
+			(void) source;
+			(void) destination;
+#	endif
+			return transfer::unsupported;
+		}
+
+		transfer try_copy_file_range(int const source, int const destination, size_t const expected, std::uint64_t& bytes, std::error_code& ec) {
+#	if defined(EA_PLATFORM_LINUX) && defined(SYS_copy_file_range)
+			bool first = true;
+			for (;;) {
+				long const copied = syscall(SYS_copy_file_range, source, nullptr, destination, nullptr, size_t(1) << 30, 0u);
+				if (copied < 0) {
+					if (errno == EINTR)
+						continue;
+					if (first && is_unsupported(errno))
+						return transfer::unsupported;
+					ec = last_error();
+					return transfer::failed;
+				}
+				// Some pseudo filesystems report nothing at all through here
+				if (copied == 0)
+					return first && expected != 0 ? transfer::unsupported : transfer::done;
+				bytes += static_cast<std::uint64_t>(copied);
+				first = false;
+			}
+#	else
+			(void) source;
+			(void) destination;
+			(void) expected;
+			(void) bytes;
+			(void) ec;
+			return transfer::unsupported;
+#	endif
+		}
+
+		transfer try_sendfile(int const source, int const destination, size_t const expected, std::uint64_t& bytes, std::error_code& ec) {
+#	if defined(EA_PLATFORM_LINUX)
+			bool first = true;
+			for (;;) {
+				ssize_t const copied = sendfile(destination, source, nullptr, size_t(1) << 30);
+				if (copied < 0) {
+					if (errno == EINTR)
+						continue;
+					if (first && is_unsupported(errno))
+						return transfer::unsupported;
+					ec = last_error();
+					return transfer::failed;
+				}
+				if (copied == 0)
+					return first && expected != 0 ? transfer::unsupported : transfer::done;
+				bytes += static_cast<std::uint64_t>(copied);
+				first = false;
+			}
+#	else
+			(void) source;
+			(void) destination;
+			(void) expected;
+			(void) bytes;
+			(void) ec;
+			return transfer::unsupported;
+#	endif
+		}
+
+		bool copy_buffered(int const source,
+		                   int const destination,
+		                   size_t const buffer_size,
+		                   std::uint64_t& bytes,
+		                   std::error_code& ec,
+		                   bvestl::polyalloc::allocator_handle handle) {
+			auto* const buffer = static_cast<char*>(handle.allocate(buffer_size, alignof(std::max_align_t), 0));
+			if (buffer == nullptr) {
+				ec = std::make_error_code(std::errc::not_enough_memory);
+				return false;
+			}
+			bool ok = true;
+			for (;;) {
+				ssize_t const read = ::read(source, buffer, buffer_size);
+				if (read < 0) {
+					if (errno == EINTR)
+						continue;
+					ec = last_error();
+					ok = false;
+					break;
+				}
+				if (read == 0)
+					break;
+				ssize_t written = 0;
+				while (written < read) {
+					ssize_t const n = ::write(destination, buffer + written, static_cast<size_t>(read - written));
+					if (n < 0) {
+						if (errno == EINTR)
+							continue;
+						ec = last_error();
+						ok = false;
+						break;
+					}
+					written += n;
+				}
+				if (!ok)
+					break;
+				bytes += static_cast<std::uint64_t>(read);
+			}
+			handle.deallocate(buffer, buffer_size);
+			return ok;
+		}
+
+		bool copy_data(int const source,
+		               int const destination,
+		               struct stat const& st,
+		               copy_options const& options,
+		               std::uint64_t& bytes,
+		               std::error_code& ec,
+		               bvestl::polyalloc::allocator_handle const handle) {
+			auto const expected = static_cast<size_t>(st.st_size);
+#	if defined(EA_PLATFORM_APPLE)
+			(void) options;
+			(void) handle;
+			if (fcopyfile(source, destination, nullptr, COPYFILE_DATA) != 0) {
+				ec = last_error();
+				return false;
+			}
+			bytes += expected;
+			return true;
+#	else
+			if (options.allow_reflink && expected != 0 && try_reflink(source, destination) == transfer::done) {
+				bytes += expected;
+				return true;
+			}
+			transfer result = try_copy_file_range(source, destination, expected, bytes, ec);
+			if (result == transfer::unsupported)
+				result = try_sendfile(source, destination, expected, bytes, ec);
+			if (result == transfer::unsupported)
+				return copy_buffered(source, destination, eastl::max<size_t>(options.buffer_size, 4096), bytes, ec, handle);
+			return result == transfer::done;
+#	endif
+		}
+
+		bool is_newer(struct stat const& lhs, struct stat const& rhs) {
+#	if defined(EA_PLATFORM_APPLE)
+			if (lhs.st_mtimespec.tv_sec != rhs.st_mtimespec.tv_sec)
+				return lhs.st_mtimespec.tv_sec > rhs.st_mtimespec.tv_sec;
+			return lhs.st_mtimespec.tv_nsec > rhs.st_mtimespec.tv_nsec;
+#	else
+			if (lhs.st_mtim.tv_sec != rhs.st_mtim.tv_sec)
+				return lhs.st_mtim.tv_sec > rhs.st_mtim.tv_sec;
+			return lhs.st_mtim.tv_nsec > rhs.st_mtim.tv_nsec;
+#	endif
+		}
+
+		void source_times(struct stat const& st, timespec (&times)[2]) {
+#	if defined(EA_PLATFORM_APPLE)
+			times[0] = st.st_atimespec;
+			times[1] = st.st_mtimespec;
+#	else
+			times[0] = st.st_atim;
+			times[1] = st.st_mtim;
+#	endif
+		}
+
+		/**
+		 * Applies the existing-destination policy to \p to. Returns false with \p ec set
+		 * to fail, or with \p ec cleared when the copy should quietly be skipped. A symlink
+		 * is judged by what it points to, but replaced itself rather than written through,
+		 * so a link to the source can never get it truncated.
+		 */
+		bool may_write(const char* const to, struct stat const& source, copy_existing const existing, std::error_code& ec) {
+			struct stat st;
+			if (lstat(to, &st) != 0) {
+				if (errno == ENOENT)
+					return true;
+				ec = last_error();
+				return false;
+			}
+			bool const link = S_ISLNK(st.st_mode);
+			struct stat target;
+			if (link && stat(to, &target) == 0)
+				st = target;
+			if (st.st_dev == source.st_dev && st.st_ino == source.st_ino) {
+				ec = std::make_error_code(std::errc::invalid_argument);
+				return false;
+			}
+			if (S_ISDIR(st.st_mode) && !S_ISDIR(source.st_mode)) {
+				ec = std::make_error_code(std::errc::is_a_directory);
+				return false;
+			}
+			bool write = true;
+			switch (existing) {
+				case copy_existing::fail:
+					ec = std::make_error_code(std::errc::file_exists);
+					return false;
+				case copy_existing::skip:
+					return false;
+				case copy_existing::update:
+					write = is_newer(source, st);
+					break;
+				default:
+					break;
+			}
+			if (write && link && unlink(to) != 0 && errno != ENOENT) {
+				ec = last_error();
+				return false;
+			}
+			return write;
+		}
+
+		// Copies the open regular file \p source to \p to. \p copied tells whether the policy let it happen.
+		bool copy_open(int const source,
+		               const char* const to,
+		               copy_options const& options,
+		               bool& copied,
+		               std::uint64_t& bytes,
+		               std::error_code& ec,
+		               bvestl::polyalloc::allocator_handle const handle) {
+			copied = false;
+			struct stat st;
+			if (fstat(source, &st) != 0) {
+				ec = last_error();
+				return false;
+			}
+			if (!S_ISREG(st.st_mode)) {
+				ec = std::make_error_code(S_ISDIR(st.st_mode) ? std::errc::is_a_directory : std::errc::invalid_argument);
+				return false;
+			}
+			if (!may_write(to, st, options.existing, ec))
+				return !ec;
+
+			mode_t const mode = options.preserve_permissions ? (st.st_mode & 07777) : 0666;
+			// A symlink put in place since may_write() makes this fail instead of writing through it
+			int const flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_NOFOLLOW | (options.existing == copy_existing::fail ? O_EXCL : O_TRUNC);
+			int const destination = open(to, flags, mode);
+			if (destination == -1) {
+				ec = last_error();
+				return false;
+			}
+
+			BVESTL_FS_OP_BEGIN(copy);
+			bool ok = copy_data(source, destination, st, options, bytes, ec, handle);
+			BVESTL_FS_OP_END(copy, !ok);
+			// An overwritten file keeps its old permissions through open()
+			if (ok && options.preserve_permissions && fchmod(destination, mode) != 0) {
+				ec = last_error();
+				ok = false;
+			}
+			if (ok && options.preserve_times) {
+				timespec times[2];
+				source_times(st, times);
+				if (futimens(destination, times) != 0) {
+					ec = last_error();
+					ok = false;
+				}
+			}
+			if (close(destination) != 0 && ok) {
+				ec = last_error();
+				ok = false;
+			}
+			if (!ok) {
+				unlink(to);
+				return false;
+			}
+			copied = true;
+			return true;
+		}
+
+		// Recreates the symlink \p name in \p dirfd as \p to
+		bool copy_symlink(int const dirfd, const char* const name, const char* const to, copy_existing const existing, std::error_code& ec) {
+			char target[4096];
+			ssize_t const length = readlinkat(dirfd, name, target, sizeof(target) - 1);
+			if (length < 0) {
+				ec = last_error();
+				return false;
+			}
+			target[length] = '\0';
+			if (symlink(target, to) == 0)
+				return true;
+			if (errno != EEXIST || existing == copy_existing::fail) {
+				ec = last_error();
+				return false;
+			}
+			if (existing == copy_existing::skip)
+				return true;
+			if (unlink(to) != 0 || symlink(target, to) != 0) {
+				ec = last_error();
+				return false;
+			}
+			return true;
+		}
+#endif
+	} // namespace
+
+	bool copy_file(path_view const from,
+	               path_view const to,
+	               std::error_code& ec,
+	               copy_options const& options,
+	               bvestl::polyalloc::allocator_handle const handle) {
+		ec.clear();
+		internal::native_path const source(from, handle);
+		internal::native_path const destination(to, handle);
+#if defined(EA_PLATFORM_WINDOWS)
+		if (options.existing == copy_existing::skip || options.existing == copy_existing::update) {
+			file_status const existing = symlink_status(to, ec, status_mask::type | status_mask::mtime, handle);
+			if (ec)
+				return false;
+			if (existing.exists()) {
+				if (options.existing == copy_existing::skip)
+					return true;
+				file_status const original = status(from, ec, status_mask::mtime, handle);
+				if (ec)
+					return false;
+				if (original.mtime_ns <= existing.mtime_ns)
+					return true;
+			}
+		}
+		BOOL cancel = FALSE;
+		DWORD const flags = options.existing == copy_existing::fail ? COPY_FILE_FAIL_IF_EXISTS : 0;
+		BVESTL_FS_OP_BEGIN(copy);
+		BOOL const copied = CopyFileExW(source.c_str(), destination.c_str(), nullptr, nullptr, &cancel, flags);
+		BVESTL_FS_OP_END(copy, !copied);
+		if (!copied) {
+			ec = last_error();
+			return false;
+		}
+		return true;
+#else
+		int const fd = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd == -1) {
+			ec = last_error();
+			return false;
+		}
+		bool copied = false;
+		std::uint64_t bytes = 0;
+		bool const ok = copy_open(fd, destination.c_str(), options, copied, bytes, ec, handle);
+		close(fd);
+		return ok;
+#endif
+	}
+
+	copy_result copy_directory_recursive(path_view const from,
+	                                     path_view const to,
+	                                     copy_options const& options,
+	                                     bvestl::polyalloc::allocator_handle const handle) {
+		copy_result result(handle);
+
+		std::error_code ec;
+		file_status const root = status(from, ec, status_mask::type | status_mask::permissions, handle);
+		if (!ec && !root.is_directory())
+			ec = std::make_error_code(root.exists() ? std::errc::not_a_directory : std::errc::no_such_file_or_directory);
+		if (ec) {
+			result.error = ec;
+			result.failed_path = path(from, handle);
+			return result;
+		}
+		if (!create_directory_recursive(to, ec, create_options(), handle)) {
+			result.error = ec;
+			result.failed_path = path(to, handle);
+			return result;
+		}
+
+		path const destination_root(to, handle);
+		std::mutex error_lock;
+		std::atomic<std::uint64_t> files{0};
+		std::atomic<std::uint64_t> directories{0};
+		std::atomic<std::uint64_t> bytes{0};
+		auto const fail = [&](std::error_code const& error, path_view const where) {
+			std::lock_guard<std::mutex> lg(error_lock);
+			if (!result.error) {
+				result.error = error;
+				result.failed_path = where.empty() ? path(from, handle) : path(from, handle) / path(where, handle);
+			}
+		};
+
+		struct copier {
+			walk_action operator()(const directory_entry& entry, size_t) {
+				path const target = m_root / path(entry.relative_path(), m_handle);
+				internal::native_path const native(target, m_handle);
+				std::error_code error;
+
+				file_type type = entry.type();
+				if (type == file_type::unknown)
+					type = entry.symlink_status(error, status_mask::type).type;
+
+				if (type == file_type::directory) {
+#if defined(EA_PLATFORM_WINDOWS)
+					if (!CreateDirectoryW(native.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+						error = last_error();
+#else
+					// Writable by us until leave() copies the real permissions over
+					if (mkdir(native.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+						error = last_error();
+#endif
+					if (!error) {
+						m_directories.fetch_add(1, std::memory_order_relaxed);
+						return walk_action::proceed;
+					}
+				}
+				else if (type == file_type::regular) {
+					std::uint64_t copied_bytes = 0;
+					bool copied = false;
+#if defined(EA_PLATFORM_WINDOWS)
+					path const source = m_source / path(entry.relative_path(), m_handle);
+					copied = copy_file(source, target, error, m_options, m_handle);
+					if (copied)
+						copied_bytes = entry.status(error, status_mask::size).size;
+#else
+					int const fd = openat(entry.directory_fd(), entry.name().data(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+					if (fd == -1) {
+						error = last_error();
+					}
+					else {
+						copy_open(fd, native.c_str(), m_options, copied, copied_bytes, error, m_handle);
+						close(fd);
+					}
+#endif
+					if (!error) {
+						if (copied)
+							m_files.fetch_add(1, std::memory_order_relaxed);
+						m_bytes.fetch_add(copied_bytes, std::memory_order_relaxed);
+						return walk_action::proceed;
+					}
+				}
+				else if (type == file_type::symlink) {
+#if !defined(EA_PLATFORM_WINDOWS)
+					if (copy_symlink(entry.directory_fd(), entry.name().data(), native.c_str(), m_options.existing, error))
+						return walk_action::proceed;
+#else
+					return walk_action::proceed;
+#endif
+				}
+				else {
+					// Sockets, fifos and devices aren't copied
+					return walk_action::proceed;
+				}
+				m_fail(error, entry.relative_path());
+				return walk_action::stop;
+			}
+
+			void leave(const directory_entry& entry, size_t) {
+#if !defined(EA_PLATFORM_WINDOWS)
+				std::error_code error;
+				file_status const st = entry.status(error, status_mask::permissions);
+				if (error)
+					return;
+				path const target = m_root / path(entry.relative_path(), m_handle);
+				internal::native_path const native(target, m_handle);
+				if (m_options.preserve_permissions)
+					chmod(native.c_str(), static_cast<mode_t>(st.permissions));
+				if (m_options.preserve_times) {
+					struct stat sb;
+					if (fstatat(entry.directory_fd(), entry.name().data(), &sb, 0) == 0) {
+						timespec times[2];
+						source_times(sb, times);
+						utimensat(AT_FDCWD, native.c_str(), times, 0);
+					}
+				}
+#else
+				(void) entry;
+#endif
+			}
+
+			path const& m_root;
+			path const m_source;
+			copy_options const& m_options;
+			bvestl::polyalloc::allocator_handle m_handle;
+			decltype(fail)& m_fail;
+			std::atomic<std::uint64_t>& m_files;
+			std::atomic<std::uint64_t>& m_directories;
+			std::atomic<std::uint64_t>& m_bytes;
+		};
+
+		walk_options walk;
+		walk.threads = options.threads;
+		walk.symlinks = symlink_policy::report;
+		walk_result const walked = parallel_walk(
+		    from, copier{destination_root, path(from, handle), options, handle, fail, files, directories, bytes}, walk, handle);
+		if (walked.error)
+			fail(walked.error, walked.failed_path);
+
+#if !defined(EA_PLATFORM_WINDOWS)
+		// The root itself, after everything inside it was written
+		if (!result.error) {
+			internal::native_path const source(from, handle);
+			internal::native_path const destination(to, handle);
+			struct stat sb;
+			if (stat(source.c_str(), &sb) == 0) {
+				if (options.preserve_permissions)
+					chmod(destination.c_str(), sb.st_mode & 07777);
+				if (options.preserve_times) {
+					timespec times[2];
+					source_times(sb, times);
+					utimensat(AT_FDCWD, destination.c_str(), times, 0);
+				}
+			}
+		}
+#endif
+
+		result.files = files.load();
+		result.directories = directories.load();
+		result.bytes = bytes.load();
+		return result;
+	}
+
+	bool move_file(path_view const from,
+	               path_view const to,
+	               std::error_code& ec,
+	               copy_options const& options,
+	               bvestl::polyalloc::allocator_handle const handle) {
+		ec.clear();
+		file_status const source = symlink_status(from, ec, status_mask::type | status_mask::mtime, handle);
+		if (ec)
+			return false;
+		if (!source.exists()) {
+			ec = std::make_error_code(std::errc::no_such_file_or_directory);
+			return false;
+		}
+		file_status const existing = symlink_status(to, ec, status_mask::type | status_mask::mtime, handle);
+		if (ec)
+			return false;
+		if (existing.exists()) {
+			switch (options.existing) {
+				case copy_existing::fail:
+					ec = std::make_error_code(std::errc::file_exists);
+					return false;
+				case copy_existing::skip:
+					return true;
+				case copy_existing::update:
+					if (source.mtime_ns <= existing.mtime_ns)
+						return true;
+					break;
+				default:
+					break;
+			}
+		}
+
+		// Directories known to exist may be moving away
+		if (source.is_directory())
+			clear_directory_cache();
+
+		internal::native_path const source_native(from, handle);
+		internal::native_path const destination_native(to, handle);
+#if defined(EA_PLATFORM_WINDOWS)
+		DWORD const flags = MOVEFILE_COPY_ALLOWED | (existing.exists() ? MOVEFILE_REPLACE_EXISTING : 0);
+		BVESTL_FS_OP_BEGIN(rename);
+		BOOL const moved = MoveFileExW(source_native.c_str(), destination_native.c_str(), flags);
+		BVESTL_FS_OP_END(rename, !moved);
+		if (moved)
+			return true;
+		if (GetLastError() != ERROR_NOT_SAME_DEVICE) {
+			ec = last_error();
+			return false;
+		}
+#else
+		BVESTL_FS_OP_BEGIN(rename);
+		int const result = rename(source_native.c_str(), destination_native.c_str());
+		BVESTL_FS_OP_END(rename, result != 0);
+		if (result == 0)
+			return true;
+		if (errno != EXDEV) {
+			ec = last_error();
+			return false;
+		}
+#endif
+
+		// Across devices: copy everything, then remove the original
+		copy_options copy = options;
+		copy.existing = copy_existing::overwrite;
+		copy.preserve_times = true;
+		copy.preserve_permissions = true;
+		if (source.is_directory()) {
+			copy_result const copied = copy_directory_recursive(from, to, copy, handle);
+			if (copied.error) {
+				ec = copied.error;
+				return false;
+			}
+			remove_result const removed = remove_directory_recursive(from, remove_options(), handle);
+			ec = removed.error;
+			return !ec;
+		}
+#if !defined(EA_PLATFORM_WINDOWS)
+		if (source.is_symlink()) {
+			if (!copy_symlink(AT_FDCWD, source_native.c_str(), destination_native.c_str(), copy.existing, ec))
+				return false;
+		}
+		else
+#endif
+		if (!copy_file(from, to, ec, copy, handle)) {
+			return false;
+		}
+		if (!remove_file(from, handle)) {
+			ec = last_error();
+			return false;
+		}
+		return true;
+	}
+} // namespace bvestl::fs
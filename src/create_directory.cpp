@@ -0,0 +1,336 @@
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/path_hash.hpp"
+#include "bvestl/fs/internal/small_vector.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+#include <atomic>
+
+namespace bvestl::fs {
+	namespace {
+		/**
+		 * Process-wide set of directories known to exist, keyed by a hash of their
+		 * components. Fixed size and lock-free: a lookup is a few atomic loads, and
+		 * when a probe run is full the directory simply isn't remembered.
+		 */
+		constexpr size_t KNOWN_SLOTS = 4096;
+		constexpr size_t KNOWN_PROBES = 16;
+
+		std::atomic<std::uint64_t> g_known[KNOWN_SLOTS];
+		std::atomic<bool> g_known_any{false};
+
+		// Unlike path::hash(), tells absolute paths from relative ones, which name different directories here
+		std::uint64_t hash_root(path_view const p) {
+			return (internal::PATH_HASH_OFFSET ^ (p.is_absolute() ? 1u : 0u)) * internal::PATH_HASH_PRIME;
+		}
+
+		// 0 marks an empty slot
+		std::uint64_t slot_key(std::uint64_t const hash) {
+			return hash != 0 ? hash : 1;
+		}
+
+		bool is_known(std::uint64_t const hash) {
+			std::uint64_t const key = slot_key(hash);
+			for (size_t i = 0; i < KNOWN_PROBES; ++i) {
+				std::uint64_t const value = g_known[(key + i) % KNOWN_SLOTS].load(std::memory_order_relaxed);
+				if (value == key)
+					return true;
+				if (value == 0)
+					return false;
+			}
+			return false;
+		}
+
+		void remember(std::uint64_t const hash) {
+			std::uint64_t const key = slot_key(hash);
+			for (size_t i = 0; i < KNOWN_PROBES; ++i) {
+				std::uint64_t expected = 0;
+				if (g_known[(key + i) % KNOWN_SLOTS].compare_exchange_strong(expected, key, std::memory_order_relaxed) || expected == key) {
+					g_known_any.store(true, std::memory_order_relaxed);
+					return;
+				}
+			}
+		}
+
+		// The leading part of p up to and including the given component
+		path_view prefix_through(path_view const p, eastl::string_view const component) {
+			return path_view(p.text().substr(0, static_cast<size_t>(component.data() + component.size() - p.text().data())), p.type());
+		}
+
+		// The leading part of p in front of its first component: the root of absolute paths, nothing for relative ones
+		path_view root_of(path_view const p) {
+			return path_view(p.text().substr(0, static_cast<size_t>(p.begin()->data() - p.text().data())), p.type());
+		}
+
+#if defined(EA_PLATFORM_WINDOWS)
+		std::error_code last_error() {
+			return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+		}
+
+		// Creates a single directory, succeeding if it already is one
+		bool make_one(path_view const p, std::error_code& ec, bvestl::polyalloc::allocator_handle const handle) {
+			internal::native_path const native(p, handle);
+			if (CreateDirectoryW(native.c_str(), nullptr))
+				return true;
+			DWORD const error = GetLastError();
+			if (error == ERROR_ALREADY_EXISTS) {
+				DWORD const attributes = GetFileAttributesW(native.c_str());
+				if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+					return true;
+			}
+			ec = std::error_code(static_cast<int>(error), std::system_category());
+			return false;
+		}
+#else
+		std::error_code last_error() {
+			return std::error_code(errno, std::generic_category());
+		}
+
+		/**
+		 * Creates the components [first, last) as a chain below the open directory
+		 * \p dir_fd, descending into each with openat() so no full path is resolved
+		 * again. \p hash is the hash of \p dir_fd's path.
+		 */
+		bool make_chain(int const dir_fd,
+		                path_view::iterator first,
+		                path_view::iterator const last,
+		                std::uint64_t hash,
+		                bool const cache,
+		                std::error_code& ec,
+		                bvestl::polyalloc::allocator_handle const handle) {
+			internal::small_vector<char, 256> name(handle);
+			int fd = dir_fd;
+			bool ok = true;
+			while (first != last) {
+				eastl::string_view const component = *first;
+				++first;
+				name.assign(component.data(), component.size());
+				name.push_back('\0');
+				hash = internal::hash_component(hash, component);
+
+				BVESTL_FS_OP_BEGIN(mkdir);
+				int const result = mkdirat(fd, name.data(), S_IRWXU);
+				BVESTL_FS_OP_END(mkdir, result != 0);
+				if (result != 0) {
+					int const error = errno;
+					if (error != EEXIST) {
+						ec = std::error_code(error, std::generic_category());
+						ok = false;
+						break;
+					}
+					// Anything in the middle is checked by opening it below
+					struct stat st;
+					if (first == last && (fstatat(fd, name.data(), &st, 0) != 0 || !S_ISDIR(st.st_mode))) {
+						ec = std::make_error_code(std::errc::file_exists);
+						ok = false;
+						break;
+					}
+				}
+				if (cache)
+					remember(hash);
+				if (first == last)
+					break;
+
+				int const next = openat(fd, name.data(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+				if (next == -1) {
+					ec = last_error();
+					ok = false;
+					break;
+				}
+				if (fd != dir_fd)
+					close(fd);
+				fd = next;
+			}
+			if (fd != dir_fd)
+				close(fd);
+			return ok;
+		}
+#endif
+	} // namespace
+
+	bool create_directory_recursive(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		std::error_code ec;
+		return create_directory_recursive(p, ec, create_options(), handle);
+	}
+
+	bool create_directory_recursive(path_view const p,
+	                                std::error_code& ec,
+	                                create_options const& options,
+	                                bvestl::polyalloc::allocator_handle const handle) {
+		ec.clear();
+		if (p.empty()) {
+			// The root always exists; an empty relative path names nothing to create
+			if (p.is_absolute())
+				return true;
+			ec = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+
+		// Running hash of every prefix, so the deepest one already known can be skipped to
+		internal::small_vector<std::uint64_t, 32> hashes(handle);
+		std::uint64_t hash = hash_root(p);
+		for (eastl::string_view const component : p) {
+			hash = internal::hash_component(hash, component);
+			hashes.push_back(hash);
+		}
+		if (options.cache && is_known(hashes.back()))
+			return true;
+
+		auto const remember_all = [&] {
+			if (options.cache)
+				for (size_t i = 0; i < hashes.size(); ++i)
+					remember(hashes.data()[i]);
+		};
+
+#if defined(EA_PLATFORM_WINDOWS)
+		// Try the whole path first, the parent usually exists
+		std::error_code first_error;
+		if (make_one(p, first_error, handle)) {
+			remember_all();
+			return true;
+		}
+		size_t index = 0;
+		for (eastl::string_view const component : p) {
+			if (!(options.cache && is_known(hashes.data()[index]))) {
+				if (!make_one(prefix_through(p, component), ec, handle))
+					return false;
+				if (options.cache)
+					remember(hashes.data()[index]);
+			}
+			++index;
+		}
+		return true;
+#else
+		// Try the whole path first, the parent usually exists
+		internal::native_path const native(p, handle);
+		BVESTL_FS_OP_BEGIN(mkdir);
+		int const result = mkdir(native.c_str(), S_IRWXU);
+		BVESTL_FS_OP_END(mkdir, result != 0);
+		if (result == 0) {
+			remember_all();
+			return true;
+		}
+		if (errno == EEXIST) {
+			struct stat st;
+			if (stat(native.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+				remember_all();
+				return true;
+			}
+			ec = std::make_error_code(std::errc::file_exists);
+			return false;
+		}
+		if (errno != ENOENT) {
+			ec = last_error();
+			return false;
+		}
+
+		// Something above is missing: walk down from the deepest known ancestor, or the root
+		path_view::iterator start = p.begin();
+		path_view start_path = root_of(p);
+		std::uint64_t start_hash = hash_root(p);
+		if (options.cache) {
+			size_t index = 0;
+			for (auto it = p.begin(); index + 1 < hashes.size(); ++it, ++index) {
+				if (is_known(hashes.data()[index])) {
+					start_path = prefix_through(p, *it);
+					start_hash = hashes.data()[index];
+					start = it;
+					++start;
+				}
+			}
+		}
+
+		int dir_fd = AT_FDCWD;
+		if (!start_path.text().empty()) {
+			internal::native_path const start_native(start_path, handle);
+			dir_fd = open(start_native.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (dir_fd == -1) {
+				ec = last_error();
+				return false;
+			}
+		}
+		bool const ok = make_chain(dir_fd, start, p.end(), start_hash, options.cache, ec, handle);
+		if (dir_fd != AT_FDCWD)
+			close(dir_fd);
+		return ok;
+#endif
+	}
+
+	bool create_directories(path_view const parent,
+	                        const path_view* const names,
+	                        size_t const count,
+	                        std::error_code& ec,
+	                        create_options const& options,
+	                        bvestl::polyalloc::allocator_handle const handle) {
+		ec.clear();
+		if (!parent.empty() && !create_directory_recursive(parent, ec, options, handle))
+			return false;
+
+		std::uint64_t parent_hash = hash_root(parent);
+		for (eastl::string_view const component : parent)
+			parent_hash = internal::hash_component(parent_hash, component);
+
+#if defined(EA_PLATFORM_WINDOWS)
+		path const base(parent, handle);
+		for (size_t i = 0; i < count; ++i) {
+			std::uint64_t hash = parent_hash;
+			for (eastl::string_view const component : names[i])
+				hash = internal::hash_component(hash, component);
+			if (options.cache && is_known(hash))
+				continue;
+			if (!create_directory_recursive(base / path(names[i], handle), ec, options, handle))
+				return false;
+		}
+		return true;
+#else
+		// Every child is created relative to one descriptor of the parent
+		int dir_fd = AT_FDCWD;
+		if (!parent.empty() || parent.is_absolute()) {
+			internal::native_path const native(parent, handle);
+			dir_fd = open(native.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (dir_fd == -1) {
+				ec = last_error();
+				return false;
+			}
+		}
+
+		bool ok = true;
+		for (size_t i = 0; i < count && ok; ++i) {
+			if (names[i].is_absolute()) {
+				ec = std::make_error_code(std::errc::invalid_argument);
+				ok = false;
+				break;
+			}
+			if (options.cache) {
+				std::uint64_t hash = parent_hash;
+				for (eastl::string_view const component : names[i])
+					hash = internal::hash_component(hash, component);
+				if (is_known(hash))
+					continue;
+			}
+			ok = make_chain(dir_fd, names[i].begin(), names[i].end(), parent_hash, options.cache, ec, handle);
+		}
+		if (dir_fd != AT_FDCWD)
+			close(dir_fd);
+		return ok;
+#endif
+	}
+
+	void clear_directory_cache() {
+		if (!g_known_any.exchange(false, std::memory_order_relaxed))
+			return;
+		for (auto& slot : g_known)
+			slot.store(0, std::memory_order_relaxed);
+	}
+} // namespace bvestl::fs
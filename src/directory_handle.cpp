@@ -0,0 +1,248 @@
+#include "bvestl/fs/directory_handle.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/open_at.hpp"
+#include "bvestl/fs/internal/status_at.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+#include <new>
+#include <utility>
+
+namespace bvestl::fs {
+	namespace {
+#if defined(EA_PLATFORM_WINDOWS)
+		std::error_code last_error() {
+			return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+		}
+#else
+		std::error_code last_error() {
+			return std::error_code(errno, std::generic_category());
+		}
+
+		// Only needs to name the directory for the *at() calls, never to read it
+#	if defined(O_PATH)
+		int const DIRECTORY_FLAGS = O_PATH | O_DIRECTORY | O_CLOEXEC;
+#	else
+		int const DIRECTORY_FLAGS = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+#	endif
+
+		// Null-terminated name of a path relative to the handle, "." for the directory itself
+		class relative_name {
+		  public:
+			relative_name(path_view const p, bvestl::polyalloc::allocator_handle const handle) : m_native(p, handle), m_empty(p.text().empty()) {}
+
+			const char* c_str() const { return m_empty ? "." : m_native.c_str(); }
+
+		  private:
+			internal::native_path m_native;
+			bool m_empty;
+		};
+#endif
+	} // namespace
+
+	directory_handle::directory_handle(bvestl::polyalloc::allocator_handle const handle) :
+	    m_handle(handle)
+#if defined(EA_PLATFORM_WINDOWS)
+	    ,
+	    m_path(handle)
+#endif
+	{
+	}
+
+	directory_handle::directory_handle(path_view const p, std::error_code& ec, bvestl::polyalloc::allocator_handle const handle) :
+	    directory_handle(handle) {
+		ec.clear();
+#if defined(EA_PLATFORM_WINDOWS)
+		file_status const st = fs::status(p, ec, status_mask::type, handle);
+		if (ec)
+			return;
+		if (!st.is_directory()) {
+			ec = std::make_error_code(st.exists() ? std::errc::not_a_directory : std::errc::no_such_file_or_directory);
+			return;
+		}
+		m_path = path(p, handle);
+		m_open = true;
+#else
+		internal::native_path const native(p, handle);
+		m_fd = open(native.c_str(), DIRECTORY_FLAGS);
+		if (m_fd == -1)
+			ec = last_error();
+#endif
+	}
+
+	directory_handle::directory_handle(directory_handle&& other) noexcept :
+	    m_handle(other.m_handle)
+#if defined(EA_PLATFORM_WINDOWS)
+	    ,
+	    m_path(std::move(other.m_path)),
+	    m_open(other.m_open) {
+		other.m_open = false;
+	}
+#else
+	    ,
+	    m_fd(other.m_fd) {
+		other.m_fd = -1;
+	}
+#endif
+
+	directory_handle& directory_handle::operator=(directory_handle&& other) noexcept {
+		if (this != &other) {
+			this->~directory_handle();
+			new (this) directory_handle(std::move(other));
+		}
+		return *this;
+	}
+
+	directory_handle::~directory_handle() {
+		close();
+	}
+
+	bool directory_handle::is_open() const {
+#if defined(EA_PLATFORM_WINDOWS)
+		return m_open;
+#else
+		return m_fd != -1;
+#endif
+	}
+
+	void directory_handle::close() {
+#if defined(EA_PLATFORM_WINDOWS)
+		m_open = false;
+#else
+		if (m_fd != -1)
+			::close(m_fd);
+		m_fd = -1;
+#endif
+	}
+
+	directory_handle directory_handle::duplicate(std::error_code& ec) const {
+		ec.clear();
+		directory_handle result(m_handle);
+		if (!is_open()) {
+			ec = std::make_error_code(std::errc::bad_file_descriptor);
+			return result;
+		}
+#if defined(EA_PLATFORM_WINDOWS)
+		result.m_path = m_path;
+		result.m_open = true;
+#else
+		result.m_fd = fcntl(m_fd, F_DUPFD_CLOEXEC, 0);
+		if (result.m_fd == -1)
+			ec = last_error();
+#endif
+		return result;
+	}
+
+	directory_handle directory_handle::open_directory(path_view const relative, std::error_code& ec) const {
+#if defined(EA_PLATFORM_WINDOWS)
+		return directory_handle(m_path / path(relative, m_handle), ec, m_handle);
+#else
+		ec.clear();
+		directory_handle result(m_handle);
+		relative_name const name(relative, m_handle);
+		result.m_fd = openat(m_fd, name.c_str(), DIRECTORY_FLAGS);
+		if (result.m_fd == -1)
+			ec = last_error();
+		return result;
+#endif
+	}
+
+	file_status directory_handle::status(path_view const relative, std::error_code& ec, status_mask const mask) const {
+#if defined(EA_PLATFORM_WINDOWS)
+		return fs::status(m_path / path(relative, m_handle), ec, mask, m_handle);
+#else
+		relative_name const name(relative, m_handle);
+		return internal::status_at(m_fd, name.c_str(), true, mask, ec);
+#endif
+	}
+
+	file_status directory_handle::symlink_status(path_view const relative, std::error_code& ec, status_mask const mask) const {
+#if defined(EA_PLATFORM_WINDOWS)
+		return fs::symlink_status(m_path / path(relative, m_handle), ec, mask, m_handle);
+#else
+		relative_name const name(relative, m_handle);
+		return internal::status_at(m_fd, name.c_str(), false, mask, ec);
+#endif
+	}
+
+	bool directory_handle::exists(path_view const relative) const {
+		std::error_code ec;
+		return status(relative, ec, status_mask::type).exists();
+	}
+
+	file_handle directory_handle::open_file(path_view const relative, open_flags const flags, std::error_code& ec) const {
+#if defined(EA_PLATFORM_WINDOWS)
+		return fs::open_file(m_path / path(relative, m_handle), flags, ec, m_handle);
+#else
+		relative_name const name(relative, m_handle);
+		return internal::open_at(m_fd, name.c_str(), flags, ec);
+#endif
+	}
+
+	bool directory_handle::create_directory(path_view const relative, std::error_code& ec) const {
+		ec.clear();
+#if defined(EA_PLATFORM_WINDOWS)
+		internal::native_path const native(m_path / path(relative, m_handle), m_handle);
+		BVESTL_FS_OP_BEGIN(mkdir);
+		bool const ok = CreateDirectoryW(native.c_str(), nullptr) != 0;
+#else
+		relative_name const name(relative, m_handle);
+		BVESTL_FS_OP_BEGIN(mkdir);
+		bool const ok = mkdirat(m_fd, name.c_str(), S_IRWXU) == 0;
+#endif
+		BVESTL_FS_OP_END(mkdir, !ok);
+		if (ok)
+			return true;
+		ec = last_error();
+		return false;
+	}
+
+	bool directory_handle::remove_file(path_view const relative, std::error_code& ec) const {
+		ec.clear();
+#if defined(EA_PLATFORM_WINDOWS)
+		internal::native_path const native(m_path / path(relative, m_handle), m_handle);
+		BVESTL_FS_OP_BEGIN(unlink);
+		bool const ok = DeleteFileW(native.c_str()) != 0;
+#else
+		relative_name const name(relative, m_handle);
+		BVESTL_FS_OP_BEGIN(unlink);
+		bool const ok = unlinkat(m_fd, name.c_str(), 0) == 0;
+#endif
+		BVESTL_FS_OP_END(unlink, !ok);
+		if (ok)
+			return true;
+		ec = last_error();
+		return false;
+	}
+
+	bool directory_handle::resize_file(path_view const relative, size_t const target_length, std::error_code& ec) const {
+		file_handle const file = open_file(relative, open_flags::write, ec);
+		if (ec)
+			return false;
+#if defined(EA_PLATFORM_WINDOWS)
+		LARGE_INTEGER size;
+		size.QuadPart = static_cast<LONGLONG>(target_length);
+		if (SetFilePointerEx(static_cast<HANDLE>(file.native()), size, nullptr, FILE_BEGIN) && SetEndOfFile(static_cast<HANDLE>(file.native())))
+			return true;
+#else
+		if (ftruncate(file.native(), static_cast<off_t>(target_length)) == 0)
+			return true;
+#endif
+		ec = last_error();
+		return false;
+	}
+
+	directory_iterator directory_handle::iterate(std::error_code& ec, directory_options const& options) const {
+		return directory_iterator(*this, ec, options, m_handle);
+	}
+} // namespace bvestl::fs
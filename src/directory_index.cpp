@@ -0,0 +1,383 @@
+#include "bvestl/fs/directory_index.hpp"
+#include "bvestl/fs/file_stream.hpp"
+#include "bvestl/fs/walk.hpp"
+#include "bvestl/fs/internal/path_hash.hpp"
+#include "bvestl/fs/internal/string.hpp"
+#include "bvestl/fs/internal/vector.hpp"
+#include <EASTL/algorithm.h>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace bvestl::fs {
+	/**
+	 * Layout of an index, in memory and on disk, in native byte order:
+	 * header, root records, hash slots, entry records, then every string
+	 * back to back. Sections start on 8 byte boundaries.
+	 */
+	struct directory_index::header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t root_count;
+		std::uint64_t entry_count;
+		// Power of two
+		std::uint64_t slot_count;
+		std::uint64_t roots_offset;
+		std::uint64_t slots_offset;
+		std::uint64_t entries_offset;
+		std::uint64_t strings_offset;
+		std::uint64_t strings_size;
+		std::uint64_t total_size;
+	};
+
+	namespace {
+		const char INDEX_MAGIC[8] = {'B', 'V', 'F', 'S', 'I', 'D', 'X', '\0'};
+		// 2: entry hashes are internal::hash_components() of the path
+		const std::uint32_t INDEX_VERSION = 2;
+
+		struct root_record {
+			std::uint64_t offset;
+			std::uint64_t length;
+		};
+
+		struct entry_record {
+			std::uint64_t hash;
+			std::uint64_t name_offset;
+			std::uint32_t name_length;
+			std::uint16_t root;
+			std::uint8_t type;
+			std::uint8_t reserved;
+		};
+
+		// Slots hold entry index + 1, 0 when empty
+		using slot_record = std::uint32_t;
+
+		template <class T>
+		const T* section(const char* const base, std::uint64_t const offset) {
+			return reinterpret_cast<const T*>(base + offset);
+		}
+
+		size_t align8(size_t const value) {
+			return (value + 7) & ~size_t(7);
+		}
+
+		// Whether the stored '/' joined \p key names the same path as \p p
+		bool key_equals(eastl::string_view key, path_view const p) {
+			bool first = true;
+			for (eastl::string_view const component : p) {
+				if (!first) {
+					if (key.empty() || key.front() != '/')
+						return false;
+					key.remove_prefix(1);
+				}
+				first = false;
+				if (key.size() < component.size() || key.substr(0, component.size()) != component)
+					return false;
+				key.remove_prefix(component.size());
+			}
+			return key.empty();
+		}
+
+		struct scanned {
+			std::uint64_t offset;
+			std::uint32_t length;
+			file_type type;
+		};
+
+		// Everything found below one root: names back to back, '/' joined
+		struct root_scan {
+			explicit root_scan(bvestl::polyalloc::allocator_handle const handle) : names(handle), entries(handle) {}
+
+			internal::string names;
+			internal::vector<scanned> entries;
+			std::error_code error;
+		};
+
+		void scan_root(path const& root, root_scan& scan, index_options const& options, bvestl::polyalloc::allocator_handle const handle) {
+			walk_options walk;
+			walk.threads = 1;
+			walk.symlinks = options.follow_symlinks ? symlink_policy::follow : symlink_policy::report;
+			walk.skip_permission_denied = options.skip_permission_denied;
+			walk_result const result = parallel_walk(
+			    root,
+			    [&](const directory_entry& entry, size_t) {
+				    size_t const offset = scan.names.size();
+				    bool first = true;
+				    for (eastl::string_view const component : entry.relative_path()) {
+					    if (!first)
+						    scan.names.push_back('/');
+					    first = false;
+					    scan.names.append(component.data(), component.data() + component.size());
+				    }
+				    scan.entries.push_back(scanned{offset, static_cast<std::uint32_t>(scan.names.size() - offset), entry.type()});
+			    },
+			    walk, handle);
+			// A search path that doesn't exist simply provides nothing
+			if (result.error && result.error != std::errc::no_such_file_or_directory && result.error != std::errc::not_a_directory)
+				scan.error = result.error;
+		}
+	} // namespace
+
+	directory_index::directory_index(bvestl::polyalloc::allocator_handle const handle) : m_handle(handle) {}
+
+	directory_index::directory_index(directory_index&& other) noexcept
+	    : m_handle(other.m_handle),
+	      m_owned(other.m_owned),
+	      m_owned_size(other.m_owned_size),
+	      m_mapping(std::move(other.m_mapping)),
+	      m_header(other.m_header) {
+		other.m_owned = nullptr;
+		other.m_owned_size = 0;
+		other.m_header = nullptr;
+	}
+
+	directory_index& directory_index::operator=(directory_index&& other) noexcept {
+		if (this != &other) {
+			this->~directory_index();
+			new (this) directory_index(std::move(other));
+		}
+		return *this;
+	}
+
+	directory_index::~directory_index() {
+		release();
+	}
+
+	void directory_index::release() {
+		if (m_owned != nullptr)
+			m_handle.deallocate(m_owned, m_owned_size);
+		m_owned = nullptr;
+		m_owned_size = 0;
+		m_mapping.close();
+		m_header = nullptr;
+	}
+
+	size_t directory_index::root_count() const {
+		return m_header != nullptr ? m_header->root_count : 0;
+	}
+
+	eastl::string_view directory_index::root(size_t const index) const {
+		auto const* const base = reinterpret_cast<const char*>(m_header);
+		root_record const& r = section<root_record>(base, m_header->roots_offset)[index];
+		return eastl::string_view(base + m_header->strings_offset + r.offset, static_cast<size_t>(r.length));
+	}
+
+	size_t directory_index::size() const {
+		return m_header != nullptr ? static_cast<size_t>(m_header->entry_count) : 0;
+	}
+
+	bool directory_index::indexable(path_view const relative) {
+		if (relative.is_absolute() || relative.empty())
+			return false;
+		for (eastl::string_view const component : relative) {
+			if (component == "." || component == "..")
+				return false;
+		}
+		return true;
+	}
+
+	size_t directory_index::find(path_view const relative, file_type* const type) const {
+		if (m_header == nullptr || !indexable(relative))
+			return npos;
+		auto const* const base = reinterpret_cast<const char*>(m_header);
+		auto const* const slots = section<slot_record>(base, m_header->slots_offset);
+		auto const* const entries = section<entry_record>(base, m_header->entries_offset);
+		const char* const strings = base + m_header->strings_offset;
+
+		std::uint64_t const hash = internal::hash_components(relative);
+		std::uint64_t const mask = m_header->slot_count - 1;
+		for (std::uint64_t i = hash & mask;; i = (i + 1) & mask) {
+			slot_record const slot = slots[i];
+			if (slot == 0)
+				return npos;
+			entry_record const& e = entries[slot - 1];
+			if (e.hash == hash && key_equals(eastl::string_view(strings + e.name_offset, e.name_length), relative)) {
+				if (type != nullptr)
+					*type = static_cast<file_type>(e.type);
+				return e.root;
+			}
+		}
+	}
+
+	bool directory_index::save(path_view const file, std::error_code& ec) const {
+		ec.clear();
+		if (m_header == nullptr) {
+			ec = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+		file_writer writer(file, ec, open_flags::write | open_flags::create | open_flags::truncate, stream_options(), m_handle);
+		if (ec)
+			return false;
+		if (!writer.write(m_header, static_cast<size_t>(m_header->total_size), ec))
+			return false;
+		return writer.close(ec);
+	}
+
+	directory_index build_directory_index(const path* const roots,
+	                                      size_t const count,
+	                                      std::error_code& ec,
+	                                      index_options const& options,
+	                                      bvestl::polyalloc::allocator_handle handle) {
+		ec.clear();
+		directory_index index(handle);
+		if (count > 0xffff) {
+			ec = std::make_error_code(std::errc::invalid_argument);
+			return index;
+		}
+
+		// One root per worker at a time; the calling thread is worker 0
+		internal::vector<root_scan> scans(handle);
+		scans.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+			scans.push_back(root_scan(handle));
+		std::atomic<size_t> next{0};
+		auto const work = [&] {
+			for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+				scan_root(roots[i], scans[i], options, handle);
+		};
+		size_t workers = options.threads != 0 ? options.threads : eastl::max<size_t>(1, std::thread::hardware_concurrency());
+		workers = eastl::min(workers, eastl::max<size_t>(count, 1));
+		internal::vector<std::thread> threads(handle);
+		for (size_t t = 1; t < workers; ++t)
+			threads.push_back(std::thread(work));
+		work();
+		for (std::thread& t : threads)
+			t.join();
+		for (root_scan const& scan : scans) {
+			if (scan.error) {
+				ec = scan.error;
+				return index;
+			}
+		}
+
+		// Merge in priority order: a name already present came from an earlier root
+		size_t total = 0;
+		size_t root_text = 0;
+		for (size_t i = 0; i < count; ++i) {
+			total += scans[i].entries.size();
+			root_text += path_view(roots[i]).text().size();
+		}
+		size_t slot_count = 16;
+		while (slot_count < total * 2)
+			slot_count *= 2;
+
+		internal::vector<slot_record> slots(slot_count, 0, handle);
+		internal::vector<entry_record> entries(handle);
+		entries.reserve(total);
+		internal::string strings(handle);
+		strings.reserve(root_text + total * 16);
+		internal::vector<root_record> root_records(handle);
+		for (size_t i = 0; i < count; ++i) {
+			eastl::string_view const text = path_view(roots[i]).text();
+			root_records.push_back(root_record{strings.size(), text.size()});
+			strings.append(text.data(), text.data() + text.size());
+		}
+
+		size_t const mask = slot_count - 1;
+		for (size_t r = 0; r < count; ++r) {
+			root_scan const& scan = scans[r];
+			for (scanned const& s : scan.entries) {
+				eastl::string_view const key(scan.names.data() + s.offset, s.length);
+				path_view const key_path(key, path_type::posix_path);
+				std::uint64_t const hash = internal::hash_components(key_path);
+				size_t i = static_cast<size_t>(hash) & mask;
+				bool present = false;
+				for (; slots[i] != 0; i = (i + 1) & mask) {
+					entry_record const& e = entries[slots[i] - 1];
+					if (e.hash == hash && eastl::string_view(strings.data() + e.name_offset, e.name_length) == key) {
+						present = true;
+						break;
+					}
+				}
+				if (present)
+					continue;
+				entries.push_back(entry_record{hash, strings.size(), s.length, static_cast<std::uint16_t>(r), static_cast<std::uint8_t>(s.type), 0});
+				strings.append(key.data(), key.data() + key.size());
+				slots[i] = static_cast<slot_record>(entries.size());
+			}
+		}
+
+		// Lay everything out in one buffer
+		directory_index::header h{};
+		std::memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+		h.version = INDEX_VERSION;
+		h.root_count = static_cast<std::uint32_t>(count);
+		h.entry_count = entries.size();
+		h.slot_count = slot_count;
+		h.roots_offset = align8(sizeof(h));
+		h.slots_offset = align8(h.roots_offset + count * sizeof(root_record));
+		h.entries_offset = align8(h.slots_offset + slot_count * sizeof(slot_record));
+		h.strings_offset = align8(h.entries_offset + entries.size() * sizeof(entry_record));
+		h.strings_size = strings.size();
+		h.total_size = align8(h.strings_offset + strings.size());
+
+		auto const size = static_cast<size_t>(h.total_size);
+		auto* const buffer = static_cast<char*>(handle.allocate(size, 8, 0));
+		if (buffer == nullptr) {
+			ec = std::make_error_code(std::errc::not_enough_memory);
+			return index;
+		}
+		std::memset(buffer, 0, size);
+		std::memcpy(buffer, &h, sizeof(h));
+		if (count != 0)
+			std::memcpy(buffer + h.roots_offset, root_records.data(), count * sizeof(root_record));
+		std::memcpy(buffer + h.slots_offset, slots.data(), slot_count * sizeof(slot_record));
+		if (!entries.empty())
+			std::memcpy(buffer + h.entries_offset, entries.data(), entries.size() * sizeof(entry_record));
+		if (!strings.empty())
+			std::memcpy(buffer + h.strings_offset, strings.data(), strings.size());
+
+		index.m_owned = buffer;
+		index.m_owned_size = size;
+		index.m_header = reinterpret_cast<const directory_index::header*>(buffer);
+		return index;
+	}
+
+	directory_index load_directory_index(path_view const file, std::error_code& ec, bvestl::polyalloc::allocator_handle const handle) {
+		ec.clear();
+		directory_index index(handle);
+		mapped_file mapping(file, ec, map_options(), handle);
+		if (ec)
+			return index;
+
+		// Everything a lookup touches must be inside the file
+		auto const* const h = reinterpret_cast<const directory_index::header*>(mapping.data());
+		std::uint64_t const size = mapping.size();
+		auto const fits = [&](std::uint64_t const offset, std::uint64_t const count, std::uint64_t const element) {
+			return offset % 8 == 0 && offset <= size && count <= (size - offset) / element;
+		};
+		bool valid = size >= sizeof(directory_index::header) && std::memcmp(h->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+		             h->version == INDEX_VERSION && h->total_size <= size && h->slot_count != 0 && (h->slot_count & (h->slot_count - 1)) == 0 &&
+		             h->entry_count < h->slot_count && fits(h->roots_offset, h->root_count, sizeof(root_record)) &&
+		             fits(h->slots_offset, h->slot_count, sizeof(slot_record)) && fits(h->entries_offset, h->entry_count, sizeof(entry_record)) &&
+		             h->strings_offset <= size && h->strings_size <= size - h->strings_offset;
+		if (valid) {
+			auto const* const base = reinterpret_cast<const char*>(h);
+			auto const* const slots = section<slot_record>(base, h->slots_offset);
+			auto const* const entries = section<entry_record>(base, h->entries_offset);
+			auto const* const roots = section<root_record>(base, h->roots_offset);
+			// A probe only stops at an empty slot or a match, so there must be an empty one
+			std::uint64_t empty = 0;
+			for (std::uint64_t i = 0; valid && i < h->slot_count; ++i) {
+				valid = slots[i] <= h->entry_count;
+				empty += slots[i] == 0 ? 1 : 0;
+			}
+			valid = valid && empty != 0;
+			for (std::uint64_t i = 0; valid && i < h->entry_count; ++i) {
+				entry_record const& e = entries[i];
+				valid = e.root < h->root_count && e.name_offset <= h->strings_size && e.name_length <= h->strings_size - e.name_offset;
+			}
+			for (std::uint64_t i = 0; valid && i < h->root_count; ++i)
+				valid = roots[i].offset <= h->strings_size && roots[i].length <= h->strings_size - roots[i].offset;
+		}
+		if (!valid) {
+			ec = std::make_error_code(std::errc::bad_message);
+			return index;
+		}
+
+		index.m_mapping = std::move(mapping);
+		index.m_header = reinterpret_cast<const directory_index::header*>(index.m_mapping.data());
+		return index;
+	}
+} // namespace bvestl::fs
@@ -0,0 +1,343 @@
+#include "bvestl/fs/directory_iterator.hpp"
+#include "bvestl/fs/directory_handle.hpp"
+#include "bvestl/fs/internal/directory_stream.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/small_vector.hpp"
+#include "bvestl/fs/internal/status_at.hpp"
+#include "bvestl/fs/internal/vector.hpp"
+
+#if !defined(EA_PLATFORM_WINDOWS)
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <cerrno>
+#endif
+
+#include <new>
+#include <utility>
+
+namespace bvestl::fs {
+	struct directory_iterator::state {
+		struct level {
+			internal::directory_stream stream;
+			char* buffer = nullptr;
+			// Length of this directory's path relative to the root, including the trailing separator
+			size_t path_length = 0;
+#if !defined(EA_PLATFORM_WINDOWS)
+			// Identity of the directory, only recorded when following symlinks
+			std::uint64_t device = 0;
+			std::uint64_t file_id = 0;
+#endif
+		};
+
+		state(directory_options const& options, bool const recursive, bvestl::polyalloc::allocator_handle const handle) :
+		    levels(handle), relative(handle), options(options), recursive(recursive), handle(handle)
+#if defined(EA_PLATFORM_WINDOWS)
+		    ,
+		    root(handle)
+#endif
+		{
+			if (this->options.buffer_size < internal::directory_stream::MIN_BUFFER_SIZE)
+				this->options.buffer_size = internal::directory_stream::MIN_BUFFER_SIZE;
+			relative.push_back('\0');
+		}
+
+		~state() {
+			close_all();
+			for (auto& l : levels) {
+				if (l.buffer != nullptr)
+					handle.deallocate(l.buffer, options.buffer_size);
+			}
+		}
+
+		void close_all() {
+			while (depth != 0)
+				levels[--depth].stream.close();
+		}
+
+		/**
+		 * Opens the directory named by the current relative path, below the root.
+		 * Returns false with \p ec cleared when the directory should silently be skipped.
+		 */
+		bool open(const char* const name, bool const is_root, std::error_code& ec) {
+			if (levels.size() == depth)
+				levels.push_back(level());
+			level& l = levels[depth];
+			if (l.buffer == nullptr)
+				l.buffer = static_cast<char*>(handle.allocate(options.buffer_size, alignof(std::uint64_t), 0));
+
+#if defined(EA_PLATFORM_WINDOWS)
+			(void) name;
+			// FindFirstFileExW wants a pattern: <root>/<relative>/*
+			internal::small_vector<char, 256> pattern(handle);
+			eastl::string_view const root_text = static_cast<path_view>(root).text();
+			pattern.append(root_text.data(), root_text.size());
+			pattern.push_back('/');
+			pattern.append(relative.data(), relative.size() - 1);
+			pattern.push_back('/');
+			pattern.push_back('*');
+			internal::native_path const native(path_view(eastl::string_view(pattern.data(), pattern.size()), path_type::windows_path), handle);
+			bool const opened = l.stream.open(native.c_str(), l.buffer, options.buffer_size, ec);
+#else
+			int const parent = is_root ? root_fd : levels[depth - 1].stream.fd();
+			bool const opened = l.stream.open(parent, name, is_root || options.follow_symlinks, l.buffer, options.buffer_size, ec);
+#endif
+			if (!opened) {
+				// Entries that vanished, were swapped for something else or that we may not read are skipped
+				if (!is_root && skippable(ec))
+					ec.clear();
+				return false;
+			}
+#if !defined(EA_PLATFORM_WINDOWS)
+			// A link back to a directory still being listed would be descended into forever
+			if (options.follow_symlinks && is_loop(l)) {
+				l.stream.close();
+				return false;
+			}
+#endif
+			// Entries below go after the directory's name and the separator the caller appends
+			l.path_length = is_root ? 0 : relative.size();
+			++depth;
+			return true;
+		}
+
+#if !defined(EA_PLATFORM_WINDOWS)
+		/**
+		 * Records the identity of \p l, just opened at the current depth, and tells whether
+		 * it is also one of the levels above it, reached again through a symlink.
+		 */
+		bool is_loop(level& l) {
+			struct stat st;
+			BVESTL_FS_OP_BEGIN(stat);
+			int const result = fstat(l.stream.fd(), &st);
+			BVESTL_FS_OP_END(stat, result != 0);
+			if (result != 0)
+				return false;
+			l.device = static_cast<std::uint64_t>(st.st_dev);
+			l.file_id = static_cast<std::uint64_t>(st.st_ino);
+			for (size_t i = 0; i < depth; ++i) {
+				if (levels[i].device == l.device && levels[i].file_id == l.file_id)
+					return true;
+			}
+			return false;
+		}
+#endif
+
+		bool skippable(std::error_code const& ec) const {
+			if (internal::is_permission_error(ec))
+				return options.skip_permission_denied;
+			return internal::is_vanished_error(ec);
+		}
+
+		internal::vector<level> levels;
+		// Number of open levels in levels
+		size_t depth = 0;
+		// Path of the current entry relative to the root, null-terminated
+		internal::small_vector<char, 256> relative;
+		directory_options options;
+		bool recursive;
+		bool descend_pending = false;
+		bvestl::polyalloc::allocator_handle handle;
+#if defined(EA_PLATFORM_WINDOWS)
+		path root;
+#else
+		// Directory the root is opened relative to
+		int root_fd = AT_FDCWD;
+#endif
+	};
+
+	file_status directory_entry::status(std::error_code& ec, status_mask const mask) const {
+#if defined(EA_PLATFORM_WINDOWS)
+		return fs::status(*m_root / path(m_relative_path, get_global_allocator()), ec, mask);
+#else
+		return internal::status_at(m_directory_fd, m_name.data(), true, mask, ec);
+#endif
+	}
+
+	file_status directory_entry::symlink_status(std::error_code& ec, status_mask const mask) const {
+#if defined(EA_PLATFORM_WINDOWS)
+		return fs::symlink_status(*m_root / path(m_relative_path, get_global_allocator()), ec, mask);
+#else
+		return internal::status_at(m_directory_fd, m_name.data(), false, mask, ec);
+#endif
+	}
+
+	directory_iterator::directory_iterator(path_view const root,
+	                                       std::error_code& ec,
+	                                       directory_options const& options,
+	                                       bvestl::polyalloc::allocator_handle const handle) :
+	    directory_iterator(nullptr, root, ec, options, false, handle) {}
+
+	directory_iterator::directory_iterator(directory_handle const& directory,
+	                                       std::error_code& ec,
+	                                       directory_options const& options,
+	                                       bvestl::polyalloc::allocator_handle const handle) :
+	    directory_iterator(&directory, path_view(), ec, options, false, handle) {}
+
+	directory_iterator::directory_iterator(directory_handle const* const directory,
+	                                       path_view const root,
+	                                       std::error_code& ec,
+	                                       directory_options const& options,
+	                                       bool const recursive,
+	                                       bvestl::polyalloc::allocator_handle const handle) :
+	    m_state(nullptr),
+	    m_handle(handle),
+	    m_started(false) {
+		ec.clear();
+		void* const memory = m_handle.allocate(sizeof(state), alignof(state), 0);
+		m_state = new (memory) state(options, recursive, m_handle);
+
+#if defined(EA_PLATFORM_WINDOWS)
+		m_state->root = directory != nullptr ? directory->native() : path(root, m_handle);
+		m_state->open(nullptr, true, ec);
+#else
+		if (directory != nullptr) {
+			// Handles may be O_PATH descriptors, which can't be listed themselves
+			m_state->root_fd = directory->native();
+			m_state->open(".", true, ec);
+		}
+		else {
+			internal::native_path const native(root, m_handle);
+			m_state->open(native.c_str(), true, ec);
+		}
+#endif
+		if (ec) {
+			m_error = ec;
+			m_state->~state();
+			m_handle.deallocate(m_state, sizeof(state));
+			m_state = nullptr;
+		}
+	}
+
+	directory_iterator::directory_iterator(directory_iterator&& other) noexcept :
+	    m_state(other.m_state),
+	    m_handle(other.m_handle),
+	    m_entry(other.m_entry),
+	    m_error(other.m_error),
+	    m_started(other.m_started) {
+		other.m_state = nullptr;
+		other.m_entry = directory_entry();
+	}
+
+	directory_iterator& directory_iterator::operator=(directory_iterator&& other) noexcept {
+		if (this != &other) {
+			this->~directory_iterator();
+			new (this) directory_iterator(std::move(other));
+		}
+		return *this;
+	}
+
+	directory_iterator::~directory_iterator() {
+		if (m_state != nullptr) {
+			m_state->~state();
+			m_handle.deallocate(m_state, sizeof(state));
+		}
+	}
+
+	directory_iterator::iterator directory_iterator::begin() {
+		if (!m_started) {
+			m_started = true;
+			next();
+		}
+		return m_entry.m_type == file_type::none ? end() : iterator(this);
+	}
+
+	bool directory_iterator::next() {
+		m_started = true;
+		if (m_state == nullptr)
+			return false;
+		state& s = *m_state;
+
+		if (s.descend_pending) {
+			s.descend_pending = false;
+			// Opened while the name is still null-terminated: a trailing separator would
+			// make the kernel follow a symlink swapped in since the listing
+			size_t const name_offset = static_cast<size_t>(m_entry.m_name.data() - s.relative.data());
+			if (!s.open(m_entry.m_name.data(), false, m_error)) {
+				if (m_error) {
+					s.close_all();
+					m_entry = directory_entry();
+					return false;
+				}
+			}
+			else {
+				// Appending may move the buffer the entry points into
+				s.relative.back() = '/';
+				s.relative.push_back('\0');
+				m_entry.m_name = eastl::string_view(s.relative.data() + name_offset, m_entry.m_name.size());
+				m_entry.m_relative_path = path_view(eastl::string_view(s.relative.data(), name_offset + m_entry.m_name.size()));
+			}
+		}
+
+		while (s.depth != 0) {
+			state::level& top = s.levels[s.depth - 1];
+			internal::raw_directory_entry raw{};
+			if (!top.stream.read(raw, m_error)) {
+				top.stream.close();
+				--s.depth;
+				if (m_error) {
+					s.close_all();
+					break;
+				}
+				continue;
+			}
+			if (internal::is_dot_or_dot_dot(raw.name))
+				continue;
+
+			s.relative.resize(top.path_length);
+			s.relative.append(raw.name, raw.length);
+			s.relative.push_back('\0');
+
+			m_entry.m_name = eastl::string_view(s.relative.data() + top.path_length, raw.length);
+			m_entry.m_relative_path = path_view(eastl::string_view(s.relative.data(), s.relative.size() - 1));
+			m_entry.m_type = raw.type;
+			m_entry.m_inode = raw.inode;
+			m_entry.m_depth = s.depth - 1;
+#if defined(EA_PLATFORM_WINDOWS)
+			m_entry.m_root = &s.root;
+#else
+			m_entry.m_directory_fd = top.stream.fd();
+#endif
+
+			if (s.recursive && m_entry.m_depth < s.options.max_depth) {
+				file_type type = raw.type;
+				// Only ask the filesystem when the listing couldn't tell
+				if (type == file_type::unknown || (type == file_type::symlink && s.options.follow_symlinks)) {
+					std::error_code ignored;
+					type = m_entry.symlink_status(ignored, status_mask::type).type;
+					if (type == file_type::symlink && s.options.follow_symlinks)
+						type = m_entry.status(ignored, status_mask::type).type;
+				}
+				s.descend_pending = type == file_type::directory;
+			}
+			return true;
+		}
+
+		m_entry = directory_entry();
+		return false;
+	}
+
+	recursive_directory_iterator::recursive_directory_iterator(path_view const root,
+	                                                           std::error_code& ec,
+	                                                           directory_options const& options,
+	                                                           bvestl::polyalloc::allocator_handle const handle) :
+	    directory_iterator(nullptr, root, ec, options, true, handle) {}
+
+	recursive_directory_iterator::recursive_directory_iterator(directory_handle const& directory,
+	                                                           std::error_code& ec,
+	                                                           directory_options const& options,
+	                                                           bvestl::polyalloc::allocator_handle const handle) :
+	    directory_iterator(&directory, path_view(), ec, options, true, handle) {}
+
+	void recursive_directory_iterator::disable_recursion_pending() {
+		if (m_state != nullptr)
+			m_state->descend_pending = false;
+	}
+
+	void recursive_directory_iterator::pop() {
+		if (m_state == nullptr || m_state->depth == 0)
+			return;
+		m_state->descend_pending = false;
+		m_state->levels[--m_state->depth].stream.close();
+	}
+} // namespace bvestl::fs
@@ -0,0 +1,211 @@
+#include "bvestl/fs/internal/directory_stream.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <dirent.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <cerrno>
+#	include <cstring>
+#endif
+
+#if defined(EA_PLATFORM_LINUX)
+#	include <sys/syscall.h>
+#endif
+
+namespace bvestl::fs::internal {
+	namespace {
+#if defined(EA_PLATFORM_LINUX)
+		// Layout of the records returned by getdents64
+		struct linux_dirent64 {
+			std::uint64_t d_ino;
+			std::int64_t d_off;
+			unsigned short d_reclen;
+			unsigned char d_type;
+			char d_name[1];
+		};
+#endif
+
+#if !defined(EA_PLATFORM_WINDOWS)
+		file_type type_from_dirent(unsigned char const type) {
+			switch (type) {
+				case DT_REG:
+					return file_type::regular;
+				case DT_DIR:
+					return file_type::directory;
+				case DT_LNK:
+					return file_type::symlink;
+				case DT_BLK:
+					return file_type::block;
+				case DT_CHR:
+					return file_type::character;
+				case DT_FIFO:
+					return file_type::fifo;
+				case DT_SOCK:
+					return file_type::socket;
+				default:
+					return file_type::unknown;
+			}
+		}
+#endif
+	} // namespace
+
+#if defined(EA_PLATFORM_WINDOWS)
+	// The find data lives at the front of the buffer, the UTF-8 name of the current entry behind it
+
+	bool directory_stream::open(const wchar_t* const pattern, char* const buffer, size_t const buffer_size, std::error_code& ec) {
+		auto* const data = reinterpret_cast<WIN32_FIND_DATAW*>(buffer);
+		BVESTL_FS_OP_BEGIN(open_directory);
+		HANDLE const find = FindFirstFileExW(pattern, FindExInfoBasic, data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		BVESTL_FS_OP_END(open_directory, find == INVALID_HANDLE_VALUE);
+		if (find == INVALID_HANDLE_VALUE) {
+			ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+			return false;
+		}
+		m_find = find;
+		m_has_pending = true;
+		m_buffer = buffer;
+		m_capacity = buffer_size;
+		return true;
+	}
+
+	bool directory_stream::is_open() const {
+		return m_find != nullptr;
+	}
+
+	void directory_stream::close() {
+		if (m_find != nullptr)
+			FindClose(static_cast<HANDLE>(m_find));
+		m_find = nullptr;
+	}
+
+	bool directory_stream::read(raw_directory_entry& out, std::error_code& ec) {
+		auto* const data = reinterpret_cast<WIN32_FIND_DATAW*>(m_buffer);
+		if (!m_has_pending) {
+			BVESTL_FS_OP_BEGIN(read_directory);
+			BOOL const found = FindNextFileW(static_cast<HANDLE>(m_find), data);
+			BVESTL_FS_OP_END(read_directory, !found && GetLastError() != ERROR_NO_MORE_FILES);
+			if (!found) {
+				DWORD const error = GetLastError();
+				if (error != ERROR_NO_MORE_FILES)
+					ec = std::error_code(static_cast<int>(error), std::system_category());
+				return false;
+			}
+		}
+		m_has_pending = false;
+
+		char* const name = m_buffer + sizeof(WIN32_FIND_DATAW);
+		int const capacity = static_cast<int>(m_capacity - sizeof(WIN32_FIND_DATAW));
+		int const size = WideCharToMultiByte(CP_UTF8, 0, data->cFileName, -1, name, capacity, nullptr, nullptr);
+
+		out.name = name;
+		out.length = size > 0 ? static_cast<size_t>(size) - 1 : 0;
+		if (data->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+			out.type = file_type::symlink;
+		else if (data->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			out.type = file_type::directory;
+		else
+			out.type = file_type::regular;
+		out.inode = 0;
+		return true;
+	}
+#else
+	bool directory_stream::open(int const parent_fd,
+	                            const char* const name,
+	                            bool const follow_symlinks,
+	                            char* const buffer,
+	                            size_t const buffer_size,
+	                            std::error_code& ec) {
+		int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+		if (!follow_symlinks)
+			flags |= O_NOFOLLOW;
+		BVESTL_FS_OP_BEGIN(open_directory);
+		int const fd = openat(parent_fd, name, flags);
+		BVESTL_FS_OP_END(open_directory, fd == -1);
+		if (fd == -1) {
+			ec = std::error_code(errno, std::generic_category());
+			return false;
+		}
+#	if defined(EA_PLATFORM_LINUX)
+		m_position = 0;
+		m_end = 0;
+#	else
+		DIR* const dir = fdopendir(fd);
+		if (dir == nullptr) {
+			ec = std::error_code(errno, std::generic_category());
+			::close(fd);
+			return false;
+		}
+		m_dir = dir;
+#	endif
+		m_fd = fd;
+		m_buffer = buffer;
+		m_capacity = buffer_size;
+		return true;
+	}
+
+	bool directory_stream::is_open() const {
+		return m_fd != -1;
+	}
+
+	void directory_stream::close() {
+#	if defined(EA_PLATFORM_LINUX)
+		if (m_fd != -1)
+			::close(m_fd);
+#	else
+		// closedir() also closes the descriptor
+		if (m_dir != nullptr)
+			closedir(static_cast<DIR*>(m_dir));
+		m_dir = nullptr;
+#	endif
+		m_fd = -1;
+	}
+
+	bool directory_stream::read(raw_directory_entry& out, std::error_code& ec) {
+#	if defined(EA_PLATFORM_LINUX)
+		if (m_position >= m_end) {
+			BVESTL_FS_OP_BEGIN(read_directory);
+			long const read = syscall(SYS_getdents64, m_fd, m_buffer, m_capacity);
+			BVESTL_FS_OP_END(read_directory, read < 0);
+			if (read < 0) {
+				ec = std::error_code(errno, std::generic_category());
+				return false;
+			}
+			if (read == 0)
+				return false;
+			m_position = 0;
+			m_end = static_cast<size_t>(read);
+		}
+
+		auto const* const record = reinterpret_cast<const linux_dirent64*>(m_buffer + m_position);
+		m_position += record->d_reclen;
+
+		out.name = record->d_name;
+		out.length = std::strlen(record->d_name);
+		out.type = type_from_dirent(record->d_type);
+		out.inode = record->d_ino;
+		return true;
+#	else
+		errno = 0;
+		BVESTL_FS_OP_BEGIN(read_directory);
+		struct dirent const* const record = readdir(static_cast<DIR*>(m_dir));
+		BVESTL_FS_OP_END(read_directory, record == nullptr && errno != 0);
+		if (record == nullptr) {
+			if (errno != 0)
+				ec = std::error_code(errno, std::generic_category());
+			return false;
+		}
+
+		out.name = record->d_name;
+		out.length = std::strlen(record->d_name);
+		out.type = type_from_dirent(record->d_type);
+		out.inode = static_cast<std::uint64_t>(record->d_ino);
+		return true;
+#	endif
+	}
+#endif
+} // namespace bvestl::fs::internal
@@ -0,0 +1,113 @@
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/open_at.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+namespace bvestl::fs {
+	void file_handle::close() {
+		if (m_native == INVALID)
+			return;
+#if defined(EA_PLATFORM_WINDOWS)
+		CloseHandle(static_cast<HANDLE>(m_native));
+#else
+		::close(m_native);
+#endif
+		m_native = INVALID;
+	}
+
+#if defined(EA_PLATFORM_WINDOWS)
+	file_handle internal::open_native(const wchar_t* const native, open_flags const flags, std::error_code& ec) {
+		ec.clear();
+		DWORD access = 0;
+		if (any(flags & open_flags::read))
+			access |= GENERIC_READ;
+		if (any(flags & open_flags::append))
+			access |= FILE_APPEND_DATA;
+		else if (any(flags & open_flags::write))
+			access |= GENERIC_WRITE;
+
+		DWORD disposition = OPEN_EXISTING;
+		if (any(flags & open_flags::create)) {
+			if (any(flags & open_flags::exclusive))
+				disposition = CREATE_NEW;
+			else if (any(flags & open_flags::truncate))
+				disposition = CREATE_ALWAYS;
+			else
+				disposition = OPEN_ALWAYS;
+		}
+		else if (any(flags & open_flags::truncate)) {
+			disposition = TRUNCATE_EXISTING;
+		}
+
+		DWORD attributes = FILE_ATTRIBUTE_NORMAL;
+		if (any(flags & open_flags::direct))
+			attributes |= FILE_FLAG_NO_BUFFERING;
+
+		BVESTL_FS_OP_BEGIN(open);
+		HANDLE const file = CreateFileW(native, access, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, disposition,
+		                                attributes, nullptr);
+		BVESTL_FS_OP_END(open, file == INVALID_HANDLE_VALUE);
+		if (file == INVALID_HANDLE_VALUE) {
+			ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+			return file_handle();
+		}
+		return file_handle(file);
+	}
+#else
+	file_handle internal::open_at(int const dirfd, const char* const name, open_flags const flags, std::error_code& ec) {
+		ec.clear();
+		int native = O_CLOEXEC;
+		if (any(flags & open_flags::read) && any(flags & (open_flags::write | open_flags::append)))
+			native |= O_RDWR;
+		else if (any(flags & (open_flags::write | open_flags::append)))
+			native |= O_WRONLY;
+		else
+			native |= O_RDONLY;
+		if (any(flags & open_flags::create))
+			native |= O_CREAT;
+		if (any(flags & open_flags::exclusive))
+			native |= O_EXCL;
+		if (any(flags & open_flags::truncate))
+			native |= O_TRUNC;
+		if (any(flags & open_flags::append))
+			native |= O_APPEND;
+#	if defined(O_DIRECT)
+		if (any(flags & open_flags::direct))
+			native |= O_DIRECT;
+#	endif
+
+		BVESTL_FS_OP_BEGIN(open);
+		int const fd = openat(dirfd, name, native, 0666);
+		BVESTL_FS_OP_END(open, fd == -1);
+		if (fd == -1) {
+			ec = std::error_code(errno, std::generic_category());
+			return file_handle();
+		}
+#	if !defined(O_DIRECT) && defined(F_NOCACHE)
+		// Apple has no O_DIRECT, but can turn the cache off after the fact
+		if (any(flags & open_flags::direct))
+			fcntl(fd, F_NOCACHE, 1);
+#	endif
+		return file_handle(fd);
+	}
+#endif
+
+	file_handle open_file(path_view const p, open_flags const flags, std::error_code& ec, bvestl::polyalloc::allocator_handle const handle) {
+		internal::native_path const native(p, handle);
+#if defined(EA_PLATFORM_WINDOWS)
+		return internal::open_native(native.c_str(), flags, ec);
+#else
+		return internal::open_at(AT_FDCWD, native.c_str(), flags, ec);
+#endif
+	}
+} // namespace bvestl::fs
@@ -0,0 +1,452 @@
+#include "bvestl/fs/file_stream.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <sys/uio.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+#include <EASTL/algorithm.h>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace bvestl::fs {
+	namespace {
+		// Block size direct I/O is aligned to; large enough for every common device
+		const size_t DIRECT_ALIGNMENT = 4096;
+
+		size_t align_up(size_t const value, size_t const alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+#if defined(EA_PLATFORM_WINDOWS)
+		std::error_code last_error() {
+			return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+		}
+#else
+		std::error_code last_error() {
+			return std::error_code(errno, std::generic_category());
+		}
+#endif
+
+		// Bytes read, 0 at the end of the file, -1 on error
+		std::ptrdiff_t read_some(file_handle const& file, void* const out, size_t const size, std::error_code& ec) {
+#if defined(EA_PLATFORM_WINDOWS)
+			DWORD read = 0;
+			if (!ReadFile(static_cast<HANDLE>(file.native()), out, static_cast<DWORD>(eastl::min<size_t>(size, 1u << 30)), &read, nullptr)) {
+				ec = last_error();
+				return -1;
+			}
+			return static_cast<std::ptrdiff_t>(read);
+#else
+			for (;;) {
+				ssize_t const read = ::read(file.native(), out, size);
+				if (read >= 0)
+					return read;
+				if (errno != EINTR) {
+					ec = last_error();
+					return -1;
+				}
+			}
+#endif
+		}
+
+		// Writes \p first then \p second completely, in a single writev() unless the OS takes less
+		bool write_all(file_handle const& file,
+		               const void* const first,
+		               size_t const first_size,
+		               const void* const second,
+		               size_t const second_size,
+		               std::error_code& ec) {
+#if defined(EA_PLATFORM_WINDOWS)
+			const void* const pieces[2] = {first, second};
+			size_t const sizes[2] = {first_size, second_size};
+			for (int i = 0; i < 2; ++i) {
+				auto const* data = static_cast<const char*>(pieces[i]);
+				size_t left = sizes[i];
+				while (left != 0) {
+					DWORD written = 0;
+					if (!WriteFile(static_cast<HANDLE>(file.native()), data, static_cast<DWORD>(eastl::min<size_t>(left, 1u << 30)), &written,
+					               nullptr)) {
+						ec = last_error();
+						return false;
+					}
+					data += written;
+					left -= written;
+				}
+			}
+			return true;
+#else
+			iovec pieces[2];
+			pieces[0].iov_base = const_cast<void*>(first);
+			pieces[0].iov_len = first_size;
+			pieces[1].iov_base = const_cast<void*>(second);
+			pieces[1].iov_len = second_size;
+
+			int current = 0;
+			while (current < 2) {
+				if (pieces[current].iov_len == 0) {
+					++current;
+					continue;
+				}
+				ssize_t written = writev(file.native(), pieces + current, 2 - current);
+				if (written < 0) {
+					if (errno == EINTR)
+						continue;
+					ec = last_error();
+					return false;
+				}
+				// Skip whatever went out, possibly part of a piece
+				while (written > 0) {
+					size_t const taken = eastl::min(static_cast<size_t>(written), pieces[current].iov_len);
+					pieces[current].iov_base = static_cast<char*>(pieces[current].iov_base) + taken;
+					pieces[current].iov_len -= taken;
+					written -= static_cast<ssize_t>(taken);
+					if (pieces[current].iov_len == 0)
+						++current;
+				}
+			}
+			return true;
+#endif
+		}
+
+		bool truncate_to(file_handle const& file, std::uint64_t const size, std::error_code& ec) {
+#if defined(EA_PLATFORM_WINDOWS)
+			LARGE_INTEGER position;
+			position.QuadPart = static_cast<LONGLONG>(size);
+			if (SetFilePointerEx(static_cast<HANDLE>(file.native()), position, nullptr, FILE_BEGIN) && SetEndOfFile(static_cast<HANDLE>(file.native())))
+				return true;
+#else
+			if (ftruncate(file.native(), static_cast<off_t>(size)) == 0)
+				return true;
+#endif
+			ec = last_error();
+			return false;
+		}
+
+		char* allocate_buffer(bvestl::polyalloc::allocator_handle& handle, size_t const size, bool const direct, std::error_code& ec) {
+			void* const memory = handle.allocate(size, direct ? DIRECT_ALIGNMENT : alignof(std::max_align_t), 0);
+			if (memory == nullptr)
+				ec = std::make_error_code(std::errc::not_enough_memory);
+			return static_cast<char*>(memory);
+		}
+
+		size_t buffer_capacity(stream_options const& options) {
+			size_t const size = eastl::max<size_t>(options.buffer_size, 1);
+			return options.direct ? align_up(size, DIRECT_ALIGNMENT) : size;
+		}
+	} // namespace
+
+	// Reader
+
+	file_reader::file_reader(path_view const p,
+	                         std::error_code& ec,
+	                         stream_options const& options,
+	                         bvestl::polyalloc::allocator_handle const handle) :
+	    m_handle(handle),
+	    m_direct(options.direct) {
+		m_file = open_file(p, options.direct ? open_flags::read | open_flags::direct : open_flags::read, ec, handle);
+		if (!ec)
+			grow(buffer_capacity(options), ec);
+		if (ec)
+			m_file.close();
+	}
+
+	file_reader::file_reader(file_handle&& file,
+	                         std::error_code& ec,
+	                         stream_options const& options,
+	                         bvestl::polyalloc::allocator_handle const handle) :
+	    m_file(std::move(file)),
+	    m_handle(handle),
+	    m_direct(options.direct) {
+		ec.clear();
+		if (!grow(buffer_capacity(options), ec))
+			m_file.close();
+	}
+
+	file_reader::file_reader(file_reader&& other) noexcept :
+	    m_file(std::move(other.m_file)),
+	    m_handle(other.m_handle),
+	    m_buffer(other.m_buffer),
+	    m_capacity(other.m_capacity),
+	    m_begin(other.m_begin),
+	    m_end(other.m_end),
+	    m_eof(other.m_eof),
+	    m_direct(other.m_direct) {
+		other.m_buffer = nullptr;
+		other.m_capacity = 0;
+		other.m_begin = other.m_end = 0;
+	}
+
+	file_reader& file_reader::operator=(file_reader&& other) noexcept {
+		if (this != &other) {
+			this->~file_reader();
+			new (this) file_reader(std::move(other));
+		}
+		return *this;
+	}
+
+	file_reader::~file_reader() {
+		close();
+	}
+
+	void file_reader::close() {
+		m_file.close();
+		if (m_buffer != nullptr)
+			m_handle.deallocate(m_buffer, m_capacity);
+		m_buffer = nullptr;
+		m_capacity = 0;
+		m_begin = m_end = 0;
+	}
+
+	bool file_reader::grow(size_t capacity, std::error_code& ec) {
+		if (m_direct)
+			capacity = align_up(capacity, DIRECT_ALIGNMENT);
+		char* const buffer = allocate_buffer(m_handle, capacity, m_direct, ec);
+		if (buffer == nullptr)
+			return false;
+		// Same layout as before, so direct reads stay aligned
+		if (m_buffer != nullptr) {
+			std::memcpy(buffer, m_buffer, m_end);
+			m_handle.deallocate(m_buffer, m_capacity);
+		}
+		m_buffer = buffer;
+		m_capacity = capacity;
+		return true;
+	}
+
+	bool file_reader::refill(std::error_code& ec) {
+		if (m_eof || !is_open())
+			return false;
+
+		// Unread bytes move to the front. Direct reads must land on a block boundary, so they end on one.
+		size_t const left = m_end - m_begin;
+		size_t const destination = m_direct ? align_up(left, DIRECT_ALIGNMENT) - left : 0;
+		if (m_begin != destination) {
+			std::memmove(m_buffer + destination, m_buffer + m_begin, left);
+			m_begin = destination;
+			m_end = destination + left;
+		}
+		if (m_end == m_capacity && !grow(m_capacity * 2, ec))
+			return false;
+
+		std::ptrdiff_t const read = read_some(m_file, m_buffer + m_end, m_capacity - m_end, ec);
+		if (read < 0)
+			return false;
+		// A short direct read can only be the end of the file, and the next one couldn't be aligned anyway
+		if (read == 0 || (m_direct && static_cast<size_t>(read) % DIRECT_ALIGNMENT != 0))
+			m_eof = true;
+		m_end += static_cast<size_t>(read);
+		return read != 0;
+	}
+
+	size_t file_reader::read(void* const out, size_t const size, std::error_code& ec) {
+		ec.clear();
+		auto* const destination = static_cast<char*>(out);
+		size_t copied = 0;
+		while (copied < size) {
+			if (m_begin == m_end) {
+				// Reads at least as large as the buffer skip it
+				if (!m_direct && !m_eof && size - copied >= m_capacity) {
+					std::ptrdiff_t const read = read_some(m_file, destination + copied, size - copied, ec);
+					if (read <= 0) {
+						m_eof = read == 0;
+						break;
+					}
+					copied += static_cast<size_t>(read);
+					continue;
+				}
+				if (!refill(ec))
+					break;
+			}
+			size_t const taken = eastl::min(size - copied, m_end - m_begin);
+			std::memcpy(destination + copied, m_buffer + m_begin, taken);
+			m_begin += taken;
+			copied += taken;
+		}
+		return copied;
+	}
+
+	bool file_reader::read_exact(size_t const size, eastl::span<const std::byte>& out, std::error_code& ec) {
+		ec.clear();
+		// Room for the record, plus the alignment slack refill() may put in front of it
+		size_t const needed = size + (m_direct ? DIRECT_ALIGNMENT : 0);
+		if (needed > m_capacity && !grow(needed, ec))
+			return false;
+
+		while (m_end - m_begin < size) {
+			if (!refill(ec)) {
+				if (!ec && m_begin != m_end)
+					ec = std::make_error_code(std::errc::io_error);
+				return false;
+			}
+		}
+		out = eastl::span<const std::byte>(reinterpret_cast<const std::byte*>(m_buffer + m_begin), size);
+		m_begin += size;
+		return true;
+	}
+
+	bool file_reader::read_line(eastl::string_view& line, std::error_code& ec) {
+		ec.clear();
+		// Bytes already searched, relative to m_begin since refill() moves them
+		size_t searched = 0;
+		for (;;) {
+			auto const* const newline =
+			    static_cast<const char*>(std::memchr(m_buffer + m_begin + searched, '\n', m_end - m_begin - searched));
+			if (newline != nullptr) {
+				auto const end = static_cast<size_t>(newline - m_buffer);
+				size_t length = end - m_begin;
+				if (length != 0 && m_buffer[end - 1] == '\r')
+					--length;
+				line = eastl::string_view(m_buffer + m_begin, length);
+				m_begin = end + 1;
+				return true;
+			}
+			searched = m_end - m_begin;
+			if (!refill(ec)) {
+				if (ec || m_begin == m_end)
+					return false;
+				// The last line, unterminated
+				line = eastl::string_view(m_buffer + m_begin, m_end - m_begin);
+				m_begin = m_end;
+				return true;
+			}
+		}
+	}
+
+	// Writer
+
+	file_writer::file_writer(path_view const p,
+	                         std::error_code& ec,
+	                         open_flags const flags,
+	                         stream_options const& options,
+	                         bvestl::polyalloc::allocator_handle const handle) :
+	    m_handle(handle),
+	    m_direct(options.direct) {
+		m_file = open_file(p, options.direct ? flags | open_flags::direct : flags, ec, handle);
+		if (ec)
+			return;
+		m_capacity = buffer_capacity(options);
+		m_buffer = allocate_buffer(m_handle, m_capacity, m_direct, ec);
+		if (ec)
+			m_file.close();
+	}
+
+	file_writer::file_writer(file_handle&& file,
+	                         std::error_code& ec,
+	                         stream_options const& options,
+	                         bvestl::polyalloc::allocator_handle const handle) :
+	    m_file(std::move(file)),
+	    m_handle(handle),
+	    m_direct(options.direct) {
+		ec.clear();
+		m_capacity = buffer_capacity(options);
+		m_buffer = allocate_buffer(m_handle, m_capacity, m_direct, ec);
+		if (ec)
+			m_file.close();
+	}
+
+	file_writer::file_writer(file_writer&& other) noexcept :
+	    m_file(std::move(other.m_file)),
+	    m_handle(other.m_handle),
+	    m_buffer(other.m_buffer),
+	    m_capacity(other.m_capacity),
+	    m_used(other.m_used),
+	    m_written(other.m_written),
+	    m_direct(other.m_direct) {
+		other.m_buffer = nullptr;
+		other.m_capacity = 0;
+		other.m_used = 0;
+	}
+
+	file_writer& file_writer::operator=(file_writer&& other) noexcept {
+		if (this != &other) {
+			this->~file_writer();
+			new (this) file_writer(std::move(other));
+		}
+		return *this;
+	}
+
+	file_writer::~file_writer() {
+		std::error_code ignored;
+		close(ignored);
+	}
+
+	bool file_writer::write(const void* const data, size_t size, std::error_code& ec) {
+		ec.clear();
+		if (size <= m_capacity - m_used) {
+			std::memcpy(m_buffer + m_used, data, size);
+			m_used += size;
+			return true;
+		}
+
+		if (!m_direct) {
+			// Out together with what's buffered, straight from the caller's memory
+			if (!write_all(m_file, m_buffer, m_used, data, size, ec))
+				return false;
+			m_written += m_used + size;
+			m_used = 0;
+			return true;
+		}
+
+		// Direct I/O has to go through the aligned buffer
+		auto const* source = static_cast<const char*>(data);
+		while (size != 0) {
+			size_t const taken = eastl::min(size, m_capacity - m_used);
+			std::memcpy(m_buffer + m_used, source, taken);
+			m_used += taken;
+			source += taken;
+			size -= taken;
+			if (m_used == m_capacity && !flush(ec))
+				return false;
+		}
+		return true;
+	}
+
+	bool file_writer::put(char const c, std::error_code& ec) {
+		if (m_used == m_capacity && !flush(ec))
+			return false;
+		m_buffer[m_used++] = c;
+		return true;
+	}
+
+	bool file_writer::flush(std::error_code& ec) {
+		ec.clear();
+		size_t const out = m_direct ? m_used / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT : m_used;
+		if (out == 0)
+			return true;
+		if (!write_all(m_file, m_buffer, out, nullptr, 0, ec))
+			return false;
+		std::memmove(m_buffer, m_buffer + out, m_used - out);
+		m_used -= out;
+		m_written += out;
+		return true;
+	}
+
+	bool file_writer::close(std::error_code& ec) {
+		ec.clear();
+		if (!is_open())
+			return true;
+
+		bool ok = flush(ec);
+		if (ok && m_direct && m_used != 0) {
+			// Pad the last block out to its full size, then cut the file back to its real length
+			std::memset(m_buffer + m_used, 0, DIRECT_ALIGNMENT - m_used);
+			ok = write_all(m_file, m_buffer, DIRECT_ALIGNMENT, nullptr, 0, ec) && truncate_to(m_file, m_written + m_used, ec);
+			m_written += m_used;
+			m_used = 0;
+		}
+
+		m_file.close();
+		if (m_buffer != nullptr)
+			m_handle.deallocate(m_buffer, m_capacity);
+		m_buffer = nullptr;
+		m_capacity = 0;
+		return ok;
+	}
+} // namespace bvestl::fs
@@ -0,0 +1,150 @@
+#include "bvestl/fs/internal/instrument.hpp"
+#include <chrono>
+
+namespace bvestl::fs {
+	namespace {
+		struct atomic_counters {
+			std::atomic<std::uint64_t> calls{0};
+			std::atomic<std::uint64_t> failures{0};
+			std::atomic<std::uint64_t> total_ns{0};
+			std::atomic<std::uint64_t> max_ns{0};
+			std::atomic<std::uint64_t> latency[op_counters::LATENCY_BUCKETS] = {};
+		};
+
+		atomic_counters op_table[static_cast<size_t>(fs_op::count)];
+
+		size_t latency_bucket(std::uint64_t const ns) {
+			std::uint64_t us = ns / 1000;
+			size_t bucket = 0;
+			while (us != 0 && bucket + 1 < op_counters::LATENCY_BUCKETS) {
+				us >>= 1;
+				++bucket;
+			}
+			return bucket;
+		}
+
+		void raise_to(std::atomic<std::uint64_t>& target, std::uint64_t const value) {
+			std::uint64_t current = target.load(std::memory_order_relaxed);
+			while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+			}
+		}
+	} // namespace
+
+	const char* to_string(fs_op const op) {
+		switch (op) {
+			case fs_op::stat:
+				return "stat";
+			case fs_op::open:
+				return "open";
+			case fs_op::open_directory:
+				return "open_directory";
+			case fs_op::read_directory:
+				return "read_directory";
+			case fs_op::mkdir:
+				return "mkdir";
+			case fs_op::unlink:
+				return "unlink";
+			case fs_op::rmdir:
+				return "rmdir";
+			case fs_op::rename:
+				return "rename";
+			case fs_op::copy:
+				return "copy";
+			default:
+				return "unknown";
+		}
+	}
+
+	std::uint64_t internal::op_clock() {
+		auto const now = std::chrono::steady_clock::now().time_since_epoch();
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+	}
+
+	void internal::record_op(fs_op const op, std::uint64_t const start, bool const failed) {
+		std::uint64_t const elapsed = op_clock() - start;
+		atomic_counters& c = op_table[static_cast<size_t>(op)];
+		c.calls.fetch_add(1, std::memory_order_relaxed);
+		if (failed)
+			c.failures.fetch_add(1, std::memory_order_relaxed);
+		c.total_ns.fetch_add(elapsed, std::memory_order_relaxed);
+		raise_to(c.max_ns, elapsed);
+		c.latency[latency_bucket(elapsed)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	instrumentation_snapshot capture_instrumentation() {
+		instrumentation_snapshot snapshot;
+		for (size_t i = 0; i < static_cast<size_t>(fs_op::count); ++i) {
+			atomic_counters const& from = op_table[i];
+			op_counters& to = snapshot.ops[i];
+			to.calls = from.calls.load(std::memory_order_relaxed);
+			to.failures = from.failures.load(std::memory_order_relaxed);
+			to.total_ns = from.total_ns.load(std::memory_order_relaxed);
+			to.max_ns = from.max_ns.load(std::memory_order_relaxed);
+			for (size_t b = 0; b < op_counters::LATENCY_BUCKETS; ++b)
+				to.latency[b] = from.latency[b].load(std::memory_order_relaxed);
+		}
+		return snapshot;
+	}
+
+	void reset_instrumentation() {
+		for (atomic_counters& c : op_table) {
+			c.calls.store(0, std::memory_order_relaxed);
+			c.failures.store(0, std::memory_order_relaxed);
+			c.total_ns.store(0, std::memory_order_relaxed);
+			c.max_ns.store(0, std::memory_order_relaxed);
+			for (auto& bucket : c.latency)
+				bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	counting_allocator::counting_allocator(bvestl::polyalloc::allocator_handle const upstream) : m_upstream(upstream) {}
+
+	void* counting_allocator::allocate(size_t const n, int const flags) {
+		void* const p = m_upstream.allocate(n, flags);
+		allocated(p, n);
+		return p;
+	}
+
+	void* counting_allocator::allocate(size_t const n, size_t const alignment, size_t const offset, int const flags) {
+		void* const p = m_upstream.allocate(n, alignment, offset, flags);
+		allocated(p, n);
+		return p;
+	}
+
+	void counting_allocator::deallocate(void* const p, size_t const n) {
+		if (p == nullptr)
+			return;
+		if (m_trace != nullptr)
+			m_trace(m_trace_context, p, n, false);
+		m_deallocations.fetch_add(1, std::memory_order_relaxed);
+		m_bytes_live.fetch_sub(n, std::memory_order_relaxed);
+		m_upstream.deallocate(p, n);
+	}
+
+	void counting_allocator::allocated(void* const p, size_t const n) {
+		if (p == nullptr)
+			return;
+		m_allocations.fetch_add(1, std::memory_order_relaxed);
+		m_bytes_allocated.fetch_add(n, std::memory_order_relaxed);
+		raise_to(m_peak_bytes_live, m_bytes_live.fetch_add(n, std::memory_order_relaxed) + n);
+		if (m_trace != nullptr)
+			m_trace(m_trace_context, p, n, true);
+	}
+
+	allocation_counters counting_allocator::counters() const {
+		allocation_counters result;
+		result.allocations = m_allocations.load(std::memory_order_relaxed);
+		result.deallocations = m_deallocations.load(std::memory_order_relaxed);
+		result.bytes_allocated = m_bytes_allocated.load(std::memory_order_relaxed);
+		result.bytes_live = m_bytes_live.load(std::memory_order_relaxed);
+		result.peak_bytes_live = m_peak_bytes_live.load(std::memory_order_relaxed);
+		return result;
+	}
+
+	void counting_allocator::reset() {
+		m_allocations.store(0, std::memory_order_relaxed);
+		m_deallocations.store(0, std::memory_order_relaxed);
+		m_bytes_allocated.store(0, std::memory_order_relaxed);
+		m_peak_bytes_live.store(m_bytes_live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+} // namespace bvestl::fs
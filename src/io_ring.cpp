@@ -0,0 +1,159 @@
+#include "bvestl/fs/internal/io_ring.hpp"
+
+#if defined(BVESTL_FS_HAS_IO_URING)
+#	include <sys/mman.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#	include <cerrno>
+#	include <cstdlib>
+#	include <cstring>
+
+namespace bvestl::fs::internal {
+	namespace {
+		std::error_code last_error() {
+			return std::error_code(errno, std::generic_category());
+		}
+
+		template <class T>
+		T* at(void* const base, std::uint32_t const offset) {
+			return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+		}
+	} // namespace
+
+	io_ring::~io_ring() {
+		if (m_sqes != nullptr)
+			munmap(m_sqes, m_sqes_size);
+		if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring)
+			munmap(m_cq_ring, m_cq_ring_size);
+		if (m_sq_ring != nullptr)
+			munmap(m_sq_ring, m_sq_ring_size);
+		if (m_fd != -1)
+			close(m_fd);
+	}
+
+	bool io_ring::init(unsigned const entries, std::error_code& ec) {
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		int const fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if (fd < 0) {
+			ec = last_error();
+			return false;
+		}
+		m_fd = fd;
+		m_sq_entries = params.sq_entries;
+
+		m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single_mmap) {
+			if (m_cq_ring_size > m_sq_ring_size)
+				m_sq_ring_size = m_cq_ring_size;
+			m_cq_ring_size = m_sq_ring_size;
+		}
+
+		void* const sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (sq_ring == MAP_FAILED) {
+			ec = last_error();
+			return false;
+		}
+		m_sq_ring = sq_ring;
+
+		if (single_mmap) {
+			m_cq_ring = m_sq_ring;
+		}
+		else {
+			void* const cq_ring = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (cq_ring == MAP_FAILED) {
+				ec = last_error();
+				return false;
+			}
+			m_cq_ring = cq_ring;
+		}
+
+		m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		void* const sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED) {
+			ec = last_error();
+			return false;
+		}
+		m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+		m_sq_head = at<unsigned>(m_sq_ring, params.sq_off.head);
+		m_sq_tail_shared = at<unsigned>(m_sq_ring, params.sq_off.tail);
+		m_sq_mask = at<unsigned>(m_sq_ring, params.sq_off.ring_mask);
+		m_sq_array = at<unsigned>(m_sq_ring, params.sq_off.array);
+		m_cq_head = at<unsigned>(m_cq_ring, params.cq_off.head);
+		m_cq_tail = at<unsigned>(m_cq_ring, params.cq_off.tail);
+		m_cq_mask = at<unsigned>(m_cq_ring, params.cq_off.ring_mask);
+		m_cqes = at<io_uring_cqe>(m_cq_ring, params.cq_off.cqes);
+		m_sq_tail = *m_sq_tail_shared;
+		m_submitted = m_sq_tail;
+
+		// Which operations exist; kernels too old to answer get nothing enabled
+		size_t const probe_size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+		auto* const probe = static_cast<io_uring_probe*>(std::calloc(1, probe_size));
+		if (probe != nullptr) {
+			if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+				for (unsigned i = 0; i < probe->ops_len && i < 256; ++i)
+					m_supported[probe->ops[i].op] = (probe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0;
+			}
+			std::free(probe);
+		}
+		return true;
+	}
+
+	bool io_ring::supports(std::uint8_t const opcode) const {
+		return m_supported[opcode] != 0;
+	}
+
+	io_uring_sqe* io_ring::next_sqe() {
+		unsigned const head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+		if (m_sq_tail - head >= m_sq_entries)
+			return nullptr;
+		unsigned const index = m_sq_tail & *m_sq_mask;
+		io_uring_sqe* const sqe = &m_sqes[index];
+		std::memset(sqe, 0, sizeof(*sqe));
+		m_sq_array[index] = index;
+		++m_sq_tail;
+		return sqe;
+	}
+
+	bool io_ring::submit(unsigned const wait_for, std::error_code& ec) {
+		__atomic_store_n(m_sq_tail_shared, m_sq_tail, __ATOMIC_RELEASE);
+		for (;;) {
+			unsigned const pending = m_sq_tail - m_submitted;
+			unsigned const flags = wait_for != 0 ? IORING_ENTER_GETEVENTS : 0;
+			long const submitted = syscall(__NR_io_uring_enter, m_fd, pending, wait_for, flags, nullptr, 0);
+			if (submitted >= 0) {
+				m_submitted += static_cast<unsigned>(submitted);
+				return true;
+			}
+			if (errno != EINTR) {
+				ec = last_error();
+				return false;
+			}
+		}
+	}
+
+	bool io_ring::wait(unsigned const wait_for, std::error_code& ec) {
+		for (;;) {
+			if (syscall(__NR_io_uring_enter, m_fd, 0, wait_for, IORING_ENTER_GETEVENTS, nullptr, 0) >= 0)
+				return true;
+			if (errno != EINTR) {
+				ec = last_error();
+				return false;
+			}
+		}
+	}
+
+	bool io_ring::pop(io_uring_cqe& out) {
+		unsigned const head = *m_cq_head;
+		if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+			return false;
+		out = m_cqes[head & *m_cq_mask];
+		__atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+		++m_completed;
+		return true;
+	}
+} // namespace bvestl::fs::internal
+#endif
@@ -0,0 +1,469 @@
+#include "bvestl/fs/load_files.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/internal/io_ring.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/vector.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+#include <EASTL/algorithm.h>
+#include <EASTL/optional.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace bvestl::fs {
+	namespace internal {
+		struct load_access {
+			static void reset(loaded_file& file, size_t const index) {
+				file.m_index = index;
+				file.m_error.clear();
+				file.m_size = 0;
+			}
+
+			static void fail(loaded_file& file, std::error_code const& ec) {
+				if (!file.m_error)
+					file.m_error = ec;
+			}
+
+			static bool allocate(loaded_file& file, size_t const size, bool const null_terminate) {
+				size_t const capacity = size + (null_terminate ? 1 : 0);
+				if (capacity == 0)
+					return true;
+				void* const memory = file.m_handle.allocate(capacity, alignof(std::max_align_t), 0);
+				if (memory == nullptr) {
+					fail(file, std::make_error_code(std::errc::not_enough_memory));
+					return false;
+				}
+				file.m_data = static_cast<std::byte*>(memory);
+				file.m_capacity = capacity;
+				file.m_size = size;
+				return true;
+			}
+
+			// Records how much was actually read, which is less than allocated if the file shrank meanwhile
+			static void finish(loaded_file& file, size_t const size) {
+				file.m_size = size;
+				if (file.m_data != nullptr && file.m_capacity > size)
+					file.m_data[size] = std::byte{0};
+			}
+		};
+	} // namespace internal
+
+	loaded_file::loaded_file(loaded_file&& other) noexcept :
+	    m_handle(other.m_handle),
+	    m_index(other.m_index),
+	    m_error(other.m_error),
+	    m_data(other.m_data),
+	    m_size(other.m_size),
+	    m_capacity(other.m_capacity) {
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_capacity = 0;
+	}
+
+	loaded_file& loaded_file::operator=(loaded_file&& other) noexcept {
+		if (this != &other) {
+			this->~loaded_file();
+			new (this) loaded_file(std::move(other));
+		}
+		return *this;
+	}
+
+	loaded_file::~loaded_file() {
+		if (m_data != nullptr)
+			m_handle.deallocate(m_data, m_capacity);
+	}
+
+	std::byte* loaded_file::release() {
+		std::byte* const data = m_data;
+		m_data = nullptr;
+		m_size = 0;
+		m_capacity = 0;
+		return data;
+	}
+
+	namespace {
+		using internal::load_access;
+
+#if defined(EA_PLATFORM_WINDOWS)
+		std::error_code last_error() {
+			return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+		}
+#else
+		std::error_code last_error() {
+			return std::error_code(errno, std::generic_category());
+		}
+#endif
+
+		// Blocking load of one file, allocating under \p allocation_lock
+		void load_one(path_view const p, loaded_file& file, std::mutex& allocation_lock, bool const null_terminate) {
+			std::error_code ec;
+			file_handle const handle = open_file(p, open_flags::read, ec, file.get_allocator());
+			if (ec) {
+				load_access::fail(file, ec);
+				return;
+			}
+
+#if defined(EA_PLATFORM_WINDOWS)
+			LARGE_INTEGER native_size;
+			if (!GetFileSizeEx(static_cast<HANDLE>(handle.native()), &native_size)) {
+				load_access::fail(file, last_error());
+				return;
+			}
+			auto const size = static_cast<size_t>(native_size.QuadPart);
+#else
+			struct stat st;
+			if (fstat(handle.native(), &st) != 0) {
+				load_access::fail(file, last_error());
+				return;
+			}
+			if (S_ISDIR(st.st_mode)) {
+				load_access::fail(file, std::make_error_code(std::errc::is_a_directory));
+				return;
+			}
+			auto const size = static_cast<size_t>(st.st_size);
+#endif
+			{
+				std::lock_guard<std::mutex> lg(allocation_lock);
+				if (!load_access::allocate(file, size, null_terminate))
+					return;
+			}
+
+			size_t done = 0;
+			while (done < size) {
+#if defined(EA_PLATFORM_WINDOWS)
+				DWORD const chunk = static_cast<DWORD>(eastl::min<size_t>(size - done, 1u << 30));
+				DWORD read = 0;
+				if (!ReadFile(static_cast<HANDLE>(handle.native()), file.data() + done, chunk, &read, nullptr)) {
+					load_access::fail(file, last_error());
+					return;
+				}
+#else
+				ssize_t const read = pread(handle.native(), file.data() + done, size - done, static_cast<off_t>(done));
+				if (read < 0) {
+					if (errno == EINTR)
+						continue;
+					load_access::fail(file, last_error());
+					return;
+				}
+#endif
+				if (read == 0)
+					break;
+				done += static_cast<size_t>(read);
+			}
+			load_access::finish(file, done);
+		}
+
+		load_result load_with_threads(const path_view* const paths,
+		                              size_t const count,
+		                              load_callbacks const& callbacks,
+		                              load_options const& options,
+		                              bvestl::polyalloc::allocator_handle const handle) {
+			load_result result;
+			result.backend = load_backend::threads;
+
+			size_t workers = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+			workers = eastl::max<size_t>(eastl::min(workers, count), 1);
+
+			std::atomic<size_t> next{0};
+			std::atomic<std::uint64_t> loaded{0};
+			std::atomic<std::uint64_t> failed{0};
+			std::mutex allocation_lock;
+			bvestl::polyalloc::allocator_handle buffers = handle;
+
+			auto const work = [&] {
+				for (size_t i = next++; i < count; i = next++) {
+					loaded_file file(handle);
+					load_access::reset(file, i);
+					load_one(paths[i], file, allocation_lock, options.null_terminate);
+					(file.error() ? failed : loaded).fetch_add(1, std::memory_order_relaxed);
+					callbacks.done(callbacks.context, file);
+					// Buffers the callback didn't keep go back under the lock too
+					if (file.data() != nullptr) {
+						size_t const capacity = file.capacity();
+						std::lock_guard<std::mutex> lg(allocation_lock);
+						buffers.deallocate(file.release(), capacity);
+					}
+				}
+			};
+
+			// The calling thread is one of the workers
+			internal::vector<std::thread> threads(handle);
+			threads.reserve(workers - 1);
+			for (size_t i = 1; i < workers; ++i)
+				threads.emplace_back(work);
+			work();
+			for (auto& thread : threads)
+				thread.join();
+
+			result.loaded = loaded.load();
+			result.failed = failed.load();
+			return result;
+		}
+#if defined(BVESTL_FS_HAS_IO_URING)
+		/**
+		 * Drives up to queue_depth files at once through a state machine: open and statx are
+		 * submitted together, then reads until the file is complete. All completions are
+		 * reaped on the calling thread.
+		 */
+		class uring_loader {
+		  public:
+			uring_loader(internal::io_ring& ring,
+			             const path_view* const paths,
+			             size_t const count,
+			             load_callbacks const& callbacks,
+			             load_options const& options,
+			             bvestl::polyalloc::allocator_handle const handle) :
+			    m_ring(ring),
+			    m_paths(paths),
+			    m_count(count),
+			    m_callbacks(callbacks),
+			    m_options(options),
+			    m_handle(handle),
+			    m_free(handle) {}
+			uring_loader(uring_loader const&) = delete;
+			uring_loader& operator=(uring_loader const&) = delete;
+
+			~uring_loader() {
+				// Slots the kernel may still write into can't be freed; leaking them is the lesser evil
+				if (m_slots == nullptr || m_ring.in_flight() != 0)
+					return;
+				for (size_t i = 0; i < m_depth; ++i) {
+					if (m_slots[i].fd != -1)
+						close(m_slots[i].fd);
+					m_slots[i].~slot();
+				}
+				m_handle.deallocate(m_slots, sizeof(slot) * m_depth);
+			}
+
+			load_result run(size_t const depth) {
+				m_result.backend = load_backend::io_uring;
+				// Slots are never moved: the kernel writes into them
+				m_slots = static_cast<slot*>(m_handle.allocate(sizeof(slot) * depth, alignof(slot), 0));
+				m_depth = depth;
+				m_free.reserve(depth);
+				for (size_t i = 0; i < depth; ++i) {
+					new (&m_slots[i]) slot(m_handle);
+					m_free.push_back(depth - 1 - i);
+				}
+				while (m_next < m_count && !m_free.empty())
+					start();
+
+				while (m_active != 0) {
+					std::error_code ec;
+					if (!m_ring.submit(1, ec) && !retryable(ec)) {
+						m_result.error = ec;
+						drain();
+						break;
+					}
+					io_uring_cqe cqe;
+					while (m_ring.pop(cqe))
+						complete(cqe);
+				}
+				return m_result;
+			}
+
+		  private:
+			enum operation : std::uint64_t { op_open = 0, op_statx = 1, op_read = 2 };
+
+			struct slot {
+				explicit slot(bvestl::polyalloc::allocator_handle const handle) : file(handle) {}
+
+				loaded_file file;
+				eastl::optional<internal::native_path> name;
+				struct statx stx;
+				int fd = -1;
+				unsigned pending = 0;
+				size_t done = 0;
+			};
+
+			static std::uint64_t tag(size_t const index, operation const op) { return (static_cast<std::uint64_t>(index) << 2) | op; }
+
+			static bool retryable(std::error_code const& ec) {
+				return ec == std::errc::resource_unavailable_try_again || ec == std::errc::device_or_resource_busy;
+			}
+
+			// Waits out every request the kernel has taken, which may still write into the slots, without starting more
+			void drain() {
+				while (m_ring.in_flight() != 0) {
+					std::error_code ec;
+					if (!m_ring.wait(1, ec) && !retryable(ec))
+						return;
+					io_uring_cqe cqe;
+					while (m_ring.pop(cqe)) {
+						// Descriptors opened meanwhile are closed with the slots
+						if ((cqe.user_data & 3) == op_open && cqe.res >= 0)
+							m_slots[cqe.user_data >> 2].fd = cqe.res;
+					}
+				}
+			}
+
+			void start() {
+				size_t const index = m_free.back();
+				m_free.pop_back();
+				slot& s = m_slots[index];
+				load_access::reset(s.file, m_next);
+				s.name.emplace(m_paths[m_next], m_handle);
+				s.fd = -1;
+				s.done = 0;
+				++m_next;
+				++m_active;
+
+				// The ring has room for two entries per slot
+				io_uring_sqe* const open = m_ring.next_sqe();
+				open->opcode = IORING_OP_OPENAT;
+				open->fd = AT_FDCWD;
+				open->addr = reinterpret_cast<std::uint64_t>(s.name->c_str());
+				open->open_flags = O_RDONLY | O_CLOEXEC;
+				open->user_data = tag(index, op_open);
+
+				io_uring_sqe* const stat = m_ring.next_sqe();
+				stat->opcode = IORING_OP_STATX;
+				stat->fd = AT_FDCWD;
+				stat->addr = reinterpret_cast<std::uint64_t>(s.name->c_str());
+				stat->len = STATX_TYPE | STATX_SIZE;
+				stat->off = reinterpret_cast<std::uint64_t>(&s.stx);
+				stat->user_data = tag(index, op_statx);
+
+				s.pending = 2;
+			}
+
+			void read(size_t const index) {
+				slot& s = m_slots[index];
+				io_uring_sqe* const sqe = m_ring.next_sqe();
+				sqe->opcode = IORING_OP_READ;
+				sqe->fd = s.fd;
+				sqe->addr = reinterpret_cast<std::uint64_t>(s.file.data() + s.done);
+				sqe->len = static_cast<std::uint32_t>(eastl::min<size_t>(s.file.size() - s.done, 1u << 30));
+				sqe->off = s.done;
+				sqe->user_data = tag(index, op_read);
+				s.pending = 1;
+			}
+
+			void complete(io_uring_cqe const& cqe) {
+				auto const index = static_cast<size_t>(cqe.user_data >> 2);
+				auto const op = static_cast<operation>(cqe.user_data & 3);
+				slot& s = m_slots[index];
+				--s.pending;
+
+				if (cqe.res < 0) {
+					// Interrupted reads are simply retried
+					if (op == op_read && (cqe.res == -EINTR || cqe.res == -EAGAIN)) {
+						read(index);
+						return;
+					}
+					load_access::fail(s.file, std::error_code(-cqe.res, std::generic_category()));
+				}
+				else if (op == op_open) {
+					s.fd = cqe.res;
+				}
+				else if (op == op_statx && S_ISDIR(s.stx.stx_mode)) {
+					load_access::fail(s.file, std::make_error_code(std::errc::is_a_directory));
+				}
+				else if (op == op_read) {
+					s.done += static_cast<size_t>(cqe.res);
+					// A zero read means the file shrank since statx
+					if (cqe.res != 0 && s.done < s.file.size()) {
+						read(index);
+						return;
+					}
+					finish(index);
+					return;
+				}
+
+				if (s.pending != 0)
+					return;
+				if (s.file.error()) {
+					finish(index);
+					return;
+				}
+				// Both open and statx are in: size the buffer and start reading
+				if (!load_access::allocate(s.file, static_cast<size_t>(s.stx.stx_size), m_options.null_terminate) || s.stx.stx_size == 0) {
+					finish(index);
+					return;
+				}
+				read(index);
+			}
+
+			void finish(size_t const index) {
+				slot& s = m_slots[index];
+				if (s.fd != -1)
+					close(s.fd);
+				s.fd = -1;
+				s.name.reset();
+				if (!s.file.error())
+					load_access::finish(s.file, s.done);
+
+				++(s.file.error() ? m_result.failed : m_result.loaded);
+				m_callbacks.done(m_callbacks.context, s.file);
+				// Whatever the callback left behind, including a moved-from file, is recycled
+				s.file = loaded_file(m_handle);
+
+				--m_active;
+				m_free.push_back(index);
+				if (m_next < m_count)
+					start();
+			}
+
+			internal::io_ring& m_ring;
+			const path_view* m_paths;
+			size_t m_count;
+			load_callbacks const& m_callbacks;
+			load_options const& m_options;
+			bvestl::polyalloc::allocator_handle m_handle;
+
+			slot* m_slots = nullptr;
+			size_t m_depth = 0;
+			internal::vector<size_t> m_free;
+			size_t m_next = 0;
+			size_t m_active = 0;
+			load_result m_result;
+		};
+#endif
+	} // namespace
+
+	load_result load_files(const path_view* const paths,
+	                       size_t const count,
+	                       load_callbacks const& callbacks,
+	                       load_options const& options,
+	                       bvestl::polyalloc::allocator_handle const handle) {
+		if (count == 0)
+			return load_result();
+
+#if defined(BVESTL_FS_HAS_IO_URING)
+		if (options.backend != load_backend::threads) {
+			size_t const depth = eastl::max<size_t>(eastl::min<size_t>(eastl::min(options.queue_depth, count), 2048), 1);
+			internal::io_ring ring;
+			std::error_code ec;
+			bool const usable = ring.init(static_cast<unsigned>(depth * 2), ec) && ring.supports(IORING_OP_OPENAT)
+			                    && ring.supports(IORING_OP_STATX) && ring.supports(IORING_OP_READ);
+			if (usable)
+				return uring_loader(ring, paths, count, callbacks, options, handle).run(depth);
+			if (options.backend == load_backend::io_uring) {
+				load_result result;
+				result.error = ec ? ec : std::make_error_code(std::errc::function_not_supported);
+				return result;
+			}
+		}
+#else
+		if (options.backend == load_backend::io_uring) {
+			load_result result;
+			result.error = std::make_error_code(std::errc::function_not_supported);
+			return result;
+		}
+#endif
+		return load_with_threads(paths, count, callbacks, options, handle);
+	}
+} // namespace bvestl::fs
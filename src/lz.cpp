@@ -0,0 +1,148 @@
+#include "bvestl/fs/internal/lz.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace bvestl::fs::internal {
+	namespace {
+		const size_t MIN_MATCH = 4;
+		const size_t MAX_OFFSET = 0xffff;
+		const unsigned HASH_BITS = 12;
+
+		std::uint32_t load32(const unsigned char* const p) {
+			std::uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		std::uint32_t hash4(std::uint32_t const sequence) {
+			return (sequence * 2654435761u) >> (32 - HASH_BITS);
+		}
+
+		// Lengths past the 4 bits of the token continue in bytes of 255, ended by a smaller one
+		bool put_length(unsigned char*& out, const unsigned char* const end, size_t length) {
+			for (; length >= 255; length -= 255) {
+				if (out == end)
+					return false;
+				*out++ = 255;
+			}
+			if (out == end)
+				return false;
+			*out++ = static_cast<unsigned char>(length);
+			return true;
+		}
+
+		bool get_length(const unsigned char*& in, const unsigned char* const end, size_t& length) {
+			unsigned char byte;
+			do {
+				if (in == end)
+					return false;
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		}
+
+		// One sequence: literals, then a match unless it is the last one
+		bool put_sequence(unsigned char*& out,
+		                  const unsigned char* const end,
+		                  const unsigned char* const literals,
+		                  size_t const literal_count,
+		                  size_t const offset,
+		                  size_t const match_length) {
+			if (out == end)
+				return false;
+			size_t const match_code = match_length != 0 ? match_length - MIN_MATCH : 0;
+			unsigned char* const token = out++;
+			*token = static_cast<unsigned char>(((literal_count < 15 ? literal_count : 15) << 4) | (match_code < 15 ? match_code : 15));
+			if (literal_count >= 15 && !put_length(out, end, literal_count - 15))
+				return false;
+			if (static_cast<size_t>(end - out) < literal_count)
+				return false;
+			if (literal_count != 0)
+				std::memcpy(out, literals, literal_count);
+			out += literal_count;
+			if (match_length == 0)
+				return true;
+			if (end - out < 2)
+				return false;
+			*out++ = static_cast<unsigned char>(offset & 0xff);
+			*out++ = static_cast<unsigned char>(offset >> 8);
+			return match_code < 15 || put_length(out, end, match_code - 15);
+		}
+	} // namespace
+
+	size_t lz_compress(const std::byte* const in, size_t const size, std::byte* const out, size_t const capacity) {
+		auto const* const source = reinterpret_cast<const unsigned char*>(in);
+		auto* output = reinterpret_cast<unsigned char*>(out);
+		auto const* const output_end = output + capacity;
+
+		std::uint32_t table[1u << HASH_BITS] = {};
+		size_t anchor = 0;
+		size_t position = 0;
+		while (position + MIN_MATCH <= size) {
+			std::uint32_t const sequence = load32(source + position);
+			std::uint32_t& slot = table[hash4(sequence)];
+			size_t const candidate = slot;
+			slot = static_cast<std::uint32_t>(position);
+			if (candidate >= position || position - candidate > MAX_OFFSET || load32(source + candidate) != sequence) {
+				++position;
+				continue;
+			}
+			size_t length = MIN_MATCH;
+			while (position + length < size && source[candidate + length] == source[position + length])
+				++length;
+			if (!put_sequence(output, output_end, source + anchor, position - anchor, position - candidate, length))
+				return 0;
+			position += length;
+			anchor = position;
+		}
+		if (!put_sequence(output, output_end, source + anchor, size - anchor, 0, 0))
+			return 0;
+		return static_cast<size_t>(output - reinterpret_cast<unsigned char*>(out));
+	}
+
+	bool lz_decompress(const std::byte* const in, size_t const in_size, std::byte* const out, size_t const out_size) {
+		auto const* input = reinterpret_cast<const unsigned char*>(in);
+		auto const* const input_end = input + in_size;
+		auto* const output_begin = reinterpret_cast<unsigned char*>(out);
+		auto* output = output_begin;
+		auto const* const output_end = output_begin + out_size;
+
+		while (input != input_end) {
+			unsigned const token = *input++;
+			size_t literals = token >> 4;
+			if (literals == 15 && !get_length(input, input_end, literals))
+				return false;
+			if (literals > static_cast<size_t>(input_end - input) || literals > static_cast<size_t>(output_end - output))
+				return false;
+			if (literals != 0)
+				std::memcpy(output, input, literals);
+			input += literals;
+			output += literals;
+			if (input == input_end)
+				break;
+
+			if (input_end - input < 2)
+				return false;
+			size_t const offset = input[0] | (static_cast<size_t>(input[1]) << 8);
+			input += 2;
+			size_t length = token & 15;
+			if (length == 15 && !get_length(input, input_end, length))
+				return false;
+			length += MIN_MATCH;
+			if (offset == 0 || offset > static_cast<size_t>(output - output_begin) || length > static_cast<size_t>(output_end - output))
+				return false;
+			// Matches may overlap what they produce, which repeats the last offset bytes
+			const unsigned char* match = output - offset;
+			if (offset >= length) {
+				std::memcpy(output, match, length);
+				output += length;
+			}
+			else {
+				for (size_t i = 0; i < length; ++i)
+					*output++ = *match++;
+			}
+		}
+		return output == output_end;
+	}
+} // namespace bvestl::fs::internal
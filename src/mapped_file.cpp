@@ -0,0 +1,287 @@
+#include "bvestl/fs/mapped_file.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+#include <new>
+#include <utility>
+
+namespace bvestl::fs {
+	namespace {
+#if defined(EA_PLATFORM_WINDOWS)
+		std::error_code last_error() {
+			return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+		}
+
+		size_t page_size() {
+			static size_t const size = [] {
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return static_cast<size_t>(info.dwPageSize);
+			}();
+			return size;
+		}
+#else
+		std::error_code last_error() {
+			return std::error_code(errno, std::generic_category());
+		}
+
+		size_t page_size() {
+			static size_t const size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			return size;
+		}
+
+		int to_madvise(access_hint const hint) {
+			switch (hint) {
+				case access_hint::sequential:
+					return MADV_SEQUENTIAL;
+				case access_hint::random:
+					return MADV_RANDOM;
+				case access_hint::willneed:
+					return MADV_WILLNEED;
+				case access_hint::dontneed:
+					return MADV_DONTNEED;
+				default:
+					return MADV_NORMAL;
+			}
+		}
+#endif
+	} // namespace
+
+	mapped_file::mapped_file(path_view const p, std::error_code& ec, map_options const& options, bvestl::polyalloc::allocator_handle const handle) :
+	    m_options(options) {
+		open_flags flags = open_flags::read;
+		if (options.mode == map_mode::read_write) {
+			flags = flags | open_flags::write;
+			if (options.create)
+				flags = flags | open_flags::create;
+		}
+		m_file = open_file(p, flags, ec, handle);
+		if (!ec)
+			attach(ec);
+	}
+
+	mapped_file::mapped_file(file_handle&& file, std::error_code& ec, map_options const& options) : m_file(std::move(file)), m_options(options) {
+		ec.clear();
+		attach(ec);
+	}
+
+	void mapped_file::attach(std::error_code& ec) {
+#if defined(EA_PLATFORM_WINDOWS)
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(static_cast<HANDLE>(m_file.native()), &size)) {
+			ec = last_error();
+			m_file.close();
+			return;
+		}
+		m_size = static_cast<size_t>(size.QuadPart);
+#else
+		struct stat st;
+		if (fstat(m_file.native(), &st) != 0) {
+			ec = last_error();
+			m_file.close();
+			return;
+		}
+		m_size = static_cast<size_t>(st.st_size);
+#endif
+		if (!map(ec))
+			m_file.close();
+	}
+
+	mapped_file::mapped_file(mapped_file&& other) noexcept :
+	    m_file(std::move(other.m_file)),
+	    m_address(other.m_address),
+	    m_size(other.m_size),
+#if defined(EA_PLATFORM_WINDOWS)
+	    m_mapping(other.m_mapping),
+#endif
+	    m_options(other.m_options) {
+		other.m_address = nullptr;
+		other.m_size = 0;
+#if defined(EA_PLATFORM_WINDOWS)
+		other.m_mapping = nullptr;
+#endif
+	}
+
+	mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+		if (this != &other) {
+			this->~mapped_file();
+			new (this) mapped_file(std::move(other));
+		}
+		return *this;
+	}
+
+	mapped_file::~mapped_file() {
+		close();
+	}
+
+	void mapped_file::close() {
+		unmap();
+		m_file.close();
+		m_size = 0;
+	}
+
+	bool mapped_file::map(std::error_code& ec) {
+		// Nothing to map; the OS refuses zero length mappings
+		if (m_size == 0)
+			return true;
+		bool const writable = m_options.mode == map_mode::read_write;
+
+#if defined(EA_PLATFORM_WINDOWS)
+		HANDLE const mapping =
+		    CreateFileMappingW(static_cast<HANDLE>(m_file.native()), nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			ec = last_error();
+			return false;
+		}
+		void* const address = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, m_size);
+		if (address == nullptr) {
+			ec = last_error();
+			CloseHandle(mapping);
+			return false;
+		}
+		m_mapping = mapping;
+		m_address = address;
+		if (m_options.populate)
+			advise(access_hint::willneed);
+#else
+		int flags = MAP_SHARED;
+#	if defined(MAP_POPULATE)
+		if (m_options.populate)
+			flags |= MAP_POPULATE;
+#	endif
+		void* const address = mmap(nullptr, m_size, PROT_READ | (writable ? PROT_WRITE : 0), flags, m_file.native(), 0);
+		if (address == MAP_FAILED) {
+			ec = last_error();
+			return false;
+		}
+		m_address = address;
+#	if !defined(MAP_POPULATE)
+		if (m_options.populate)
+			advise(access_hint::willneed);
+#	endif
+#	if defined(MADV_HUGEPAGE)
+		if (m_options.huge_pages)
+			madvise(m_address, m_size, MADV_HUGEPAGE);
+#	endif
+#endif
+		if (m_options.hint != access_hint::normal)
+			advise(m_options.hint);
+		return true;
+	}
+
+	void mapped_file::unmap() {
+#if defined(EA_PLATFORM_WINDOWS)
+		if (m_address != nullptr)
+			UnmapViewOfFile(m_address);
+		if (m_mapping != nullptr)
+			CloseHandle(static_cast<HANDLE>(m_mapping));
+		m_mapping = nullptr;
+#else
+		if (m_address != nullptr)
+			munmap(m_address, m_size);
+#endif
+		m_address = nullptr;
+	}
+
+	void mapped_file::advise(access_hint const hint, size_t const offset, size_t length) const {
+		if (m_address == nullptr || offset >= m_size)
+			return;
+		if (length > m_size - offset)
+			length = m_size - offset;
+		// The range has to start on a page boundary
+		size_t const start = offset - offset % page_size();
+		length += offset - start;
+		char* const address = static_cast<char*>(m_address) + start;
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	if _WIN32_WINNT >= 0x0602
+		if (hint == access_hint::willneed) {
+			WIN32_MEMORY_RANGE_ENTRY range;
+			range.VirtualAddress = address;
+			range.NumberOfBytes = length;
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		}
+#	else
+		(void) hint;
+		(void) address;
+#	endif
+#else
+		madvise(address, length, to_madvise(hint));
+#endif
+	}
+
+	bool mapped_file::resize(size_t const new_size, std::error_code& ec) {
+		ec.clear();
+		if (!is_open()) {
+			ec = std::make_error_code(std::errc::bad_file_descriptor);
+			return false;
+		}
+		if (m_options.mode != map_mode::read_write) {
+			ec = std::make_error_code(std::errc::operation_not_permitted);
+			return false;
+		}
+
+#if defined(EA_PLATFORM_WINDOWS)
+		// A file can't be resized while a view of it is mapped
+		unmap();
+		LARGE_INTEGER size;
+		size.QuadPart = static_cast<LONGLONG>(new_size);
+		HANDLE const file = static_cast<HANDLE>(m_file.native());
+		if (!SetFilePointerEx(file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+			ec = last_error();
+			map(ec);
+			return false;
+		}
+		m_size = new_size;
+		return map(ec);
+#else
+		if (ftruncate(m_file.native(), static_cast<off_t>(new_size)) != 0) {
+			ec = last_error();
+			return false;
+		}
+#	if defined(EA_PLATFORM_LINUX)
+		// Grow or shrink in place when possible, without tearing down the mapping
+		if (m_address != nullptr && new_size != 0) {
+			void* const address = mremap(m_address, m_size, new_size, MREMAP_MAYMOVE);
+			if (address == MAP_FAILED) {
+				ec = last_error();
+				return false;
+			}
+			m_address = address;
+			m_size = new_size;
+			return true;
+		}
+#	endif
+		unmap();
+		m_size = new_size;
+		return map(ec);
+#endif
+	}
+
+	bool mapped_file::flush(std::error_code& ec, bool const async) {
+		ec.clear();
+		if (m_address == nullptr || m_options.mode != map_mode::read_write)
+			return true;
+#if defined(EA_PLATFORM_WINDOWS)
+		if (!FlushViewOfFile(m_address, m_size) || (!async && !FlushFileBuffers(static_cast<HANDLE>(m_file.native())))) {
+			ec = last_error();
+			return false;
+		}
+#else
+		if (msync(m_address, m_size, async ? MS_ASYNC : MS_SYNC) != 0) {
+			ec = last_error();
+			return false;
+		}
+#endif
+		return true;
+	}
+} // namespace bvestl::fs
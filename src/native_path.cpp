@@ -0,0 +1,65 @@
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/path.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#endif
+
+namespace bvestl::fs::internal {
+	namespace {
+		template <class Buffer>
+		void render(Buffer& out, path_view const path, char const separator) {
+			bool first = true;
+			for (auto const component : path) {
+				if (!first)
+					out.push_back(separator);
+				out.append(component.data(), component.size());
+				first = false;
+			}
+		}
+	} // namespace
+
+#if defined(EA_PLATFORM_WINDOWS)
+	native_path::native_path(path_view const path, bvestl::polyalloc::allocator_handle const handle) : m_buffer(handle), m_c_str(nullptr) {
+		if (path.source() != nullptr) {
+			m_c_str = path.source()->native_c_str();
+			return;
+		}
+
+		small_vector<char, 256> utf8(handle);
+		utf8.reserve(path.text().size() + 5);
+		render(utf8, path, '\\');
+
+		// Windows requires a \\?\ prefix to handle paths longer than MAX_PATH
+		// (including their null character).
+		if (path.is_absolute() && utf8.size() + 1 > 260) {
+			m_buffer.append(LR"(\\?\)", 4);
+		}
+
+		if (!utf8.empty()) {
+			int const size = MultiByteToWideChar(CP_UTF8, 0, utf8.data(), static_cast<int>(utf8.size()), nullptr, 0);
+			size_t const offset = m_buffer.size();
+			m_buffer.resize(offset + static_cast<size_t>(size));
+			MultiByteToWideChar(CP_UTF8, 0, utf8.data(), static_cast<int>(utf8.size()), m_buffer.data() + offset, size);
+		}
+		m_buffer.push_back(L'\0');
+		m_c_str = m_buffer.data();
+	}
+#else
+	native_path::native_path(path_view const path, bvestl::polyalloc::allocator_handle const handle) : m_buffer(handle), m_c_str(nullptr) {
+		if (path.source() != nullptr) {
+			m_c_str = path.source()->native_c_str();
+			return;
+		}
+
+		m_buffer.reserve(path.text().size() + 2);
+		if (path.type() == path_type::posix_path && path.is_absolute())
+			m_buffer.push_back('/');
+		render(m_buffer, path, '/');
+		m_buffer.push_back('\0');
+		m_c_str = m_buffer.data();
+	}
+#endif
+} // namespace bvestl::fs::internal
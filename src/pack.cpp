@@ -0,0 +1,584 @@
+#include "bvestl/fs/pack.hpp"
+#include "bvestl/fs/directory_iterator.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/internal/lz.hpp"
+#include "bvestl/fs/internal/path_hash.hpp"
+#include <EASTL/algorithm.h>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+namespace bvestl::fs {
+	/**
+	 * Layout of a pack, in native byte order: header, entry records sorted by
+	 * name, hash slots, every name back to back, then the data of each entry on
+	 * a 16 byte boundary. Sections start on 8 byte boundaries. A compressed
+	 * entry starts with the stored size of each of its blocks (uint32), a
+	 * block stored as is having its full size, followed by the blocks.
+	 */
+	struct mapped_pack::header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t block_size;
+		std::uint64_t entry_count;
+		// Power of two
+		std::uint64_t slot_count;
+		std::uint64_t entries_offset;
+		std::uint64_t slots_offset;
+		std::uint64_t strings_offset;
+		std::uint64_t strings_size;
+		std::uint64_t data_offset;
+		std::uint64_t total_size;
+	};
+
+	namespace {
+		const char PACK_MAGIC[8] = {'B', 'V', 'F', 'S', 'P', 'A', 'K', '\0'};
+		// 2: entry hashes are internal::hash_components() of the name
+		const std::uint32_t PACK_VERSION = 2;
+		const std::uint32_t MAX_BLOCK_SIZE = 64 * 1024;
+
+		struct entry_record {
+			std::uint64_t hash;
+			std::uint64_t offset;
+			std::uint64_t size;
+			std::uint64_t stored_size;
+			std::uint64_t name_offset;
+			std::uint32_t name_length;
+			std::uint8_t compression;
+			std::uint8_t reserved[3];
+		};
+
+		// Slots hold entry index + 1, 0 when empty
+		using slot_record = std::uint32_t;
+
+		template <class T>
+		const T* section(const char* const base, std::uint64_t const offset) {
+			return reinterpret_cast<const T*>(base + offset);
+		}
+
+		std::uint64_t align8(std::uint64_t const value) {
+			return (value + 7) & ~std::uint64_t(7);
+		}
+
+		std::uint64_t align16(std::uint64_t const value) {
+			return (value + 15) & ~std::uint64_t(15);
+		}
+
+
+		// Whether the stored '/' joined \p key names the same path as \p p
+		bool key_equals(eastl::string_view key, path_view const p) {
+			bool first = true;
+			for (eastl::string_view const component : p) {
+				if (!first) {
+					if (key.empty() || key.front() != '/')
+						return false;
+					key.remove_prefix(1);
+				}
+				first = false;
+				if (key.size() < component.size() || key.substr(0, component.size()) != component)
+					return false;
+				key.remove_prefix(component.size());
+			}
+			return key.empty();
+		}
+
+		// Orders \p key against the components of \p p joined by '/', followed by a '/'
+		int compare_below(eastl::string_view const key, path_view const p) {
+			size_t position = 0;
+			auto const step = [&](char const c) {
+				if (position == key.size())
+					return -1;
+				auto const stored = static_cast<unsigned char>(key[position++]);
+				auto const wanted = static_cast<unsigned char>(c);
+				return stored < wanted ? -1 : stored > wanted ? 1 : 0;
+			};
+			for (eastl::string_view const component : p) {
+				for (char const c : component) {
+					if (int const order = step(c))
+						return order;
+				}
+				if (int const order = step('/'))
+					return order;
+			}
+			return 0;
+		}
+
+		// First index in [first, last) for which \p below is false, when it is true up to some point and false from there on
+		template <class Predicate>
+		size_t partition_point(size_t first, size_t const last, Predicate const& below) {
+			for (size_t length = last - first; length != 0;) {
+				size_t const half = length / 2;
+				if (below(first + half)) {
+					first += half + 1;
+					length -= half + 1;
+				}
+				else {
+					length = half;
+				}
+			}
+			return first;
+		}
+
+		// No name can be looked up with "." or ".." components, or from an absolute path
+		bool lookupable(path_view const relative) {
+			if (relative.is_absolute())
+				return false;
+			for (eastl::string_view const component : relative) {
+				if (component == "." || component == "..")
+					return false;
+			}
+			return true;
+		}
+
+		// Components of \p p joined by '/'; false if it can't name an entry
+		bool join_name(path_view const p, internal::string& out) {
+			if (p.empty() || !lookupable(p))
+				return false;
+			for (eastl::string_view const component : p) {
+				if (!out.empty())
+					out.push_back('/');
+				out.append(component.data(), component.data() + component.size());
+			}
+			return true;
+		}
+
+		std::error_code last_error() {
+#if defined(EA_PLATFORM_WINDOWS)
+			return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+#else
+			return std::error_code(errno, std::generic_category());
+#endif
+		}
+
+		// Writes \p size bytes at \p offset, leaving the file position alone
+		bool write_at(file_handle const& file, std::uint64_t offset, const void* const data, size_t size, std::error_code& ec) {
+			auto const* bytes = static_cast<const char*>(data);
+			while (size != 0) {
+#if defined(EA_PLATFORM_WINDOWS)
+				OVERLAPPED overlapped{};
+				overlapped.Offset = static_cast<DWORD>(offset);
+				overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+				DWORD written = 0;
+				if (!WriteFile(static_cast<HANDLE>(file.native()), bytes, static_cast<DWORD>(eastl::min<size_t>(size, 1u << 30)), &written,
+				               &overlapped)) {
+					ec = last_error();
+					return false;
+				}
+#else
+				ssize_t const written = pwrite(file.native(), bytes, size, static_cast<off_t>(offset));
+				if (written < 0) {
+					if (errno == EINTR)
+						continue;
+					ec = last_error();
+					return false;
+				}
+#endif
+				bytes += written;
+				offset += static_cast<std::uint64_t>(written);
+				size -= static_cast<size_t>(written);
+			}
+			return true;
+		}
+	} // namespace
+
+	file_contents::file_contents(mapped_file&& file, bvestl::polyalloc::allocator_handle const handle) : m_handle(handle), m_mapping(std::move(file)) {
+		m_data = m_mapping.data();
+		m_size = m_mapping.size();
+		m_open = m_mapping.is_open();
+	}
+
+	file_contents::file_contents(file_contents&& other) noexcept
+	    : m_handle(other.m_handle),
+	      m_mapping(std::move(other.m_mapping)),
+	      m_owned(other.m_owned),
+	      m_data(other.m_data),
+	      m_size(other.m_size),
+	      m_open(other.m_open) {
+		other.m_owned = nullptr;
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_open = false;
+	}
+
+	file_contents& file_contents::operator=(file_contents&& other) noexcept {
+		if (this != &other) {
+			this->~file_contents();
+			new (this) file_contents(std::move(other));
+		}
+		return *this;
+	}
+
+	file_contents::~file_contents() {
+		if (m_owned != nullptr)
+			m_handle.deallocate(m_owned, m_size != 0 ? m_size : 1);
+	}
+
+	mapped_pack::mapped_pack(bvestl::polyalloc::allocator_handle const handle) : m_handle(handle), m_file(handle) {}
+
+	mapped_pack::mapped_pack(path_view const file, std::error_code& ec, bvestl::polyalloc::allocator_handle const handle)
+	    : m_handle(handle), m_file(file, handle) {
+		ec.clear();
+		mapped_file mapping(file, ec, map_options(), handle);
+		if (ec)
+			return;
+
+		// Everything a lookup touches must be inside the file; block tables are checked when an entry is opened
+		auto const* const h = reinterpret_cast<const header*>(mapping.data());
+		std::uint64_t const size = mapping.size();
+		auto const fits = [&](std::uint64_t const offset, std::uint64_t const count, std::uint64_t const element) {
+			return offset % 8 == 0 && offset <= size && count <= (size - offset) / element;
+		};
+		bool valid = size >= sizeof(header) && std::memcmp(h->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 && h->version == PACK_VERSION &&
+		             h->block_size != 0 && h->block_size <= MAX_BLOCK_SIZE && h->total_size <= size && h->slot_count != 0 &&
+		             (h->slot_count & (h->slot_count - 1)) == 0 && h->entry_count < h->slot_count &&
+		             fits(h->entries_offset, h->entry_count, sizeof(entry_record)) && fits(h->slots_offset, h->slot_count, sizeof(slot_record)) &&
+		             h->strings_offset <= size && h->strings_size <= size - h->strings_offset;
+		if (valid) {
+			auto const* const base = reinterpret_cast<const char*>(h);
+			auto const* const slots = section<slot_record>(base, h->slots_offset);
+			auto const* const entries = section<entry_record>(base, h->entries_offset);
+			// A probe only stops at an empty slot or a match, so there must be an empty one
+			std::uint64_t empty = 0;
+			for (std::uint64_t i = 0; valid && i < h->slot_count; ++i) {
+				valid = slots[i] <= h->entry_count;
+				empty += slots[i] == 0 ? 1 : 0;
+			}
+			valid = valid && empty != 0;
+			for (std::uint64_t i = 0; valid && i < h->entry_count; ++i) {
+				entry_record const& e = entries[i];
+				valid = e.name_offset <= h->strings_size && e.name_length <= h->strings_size - e.name_offset && e.offset <= h->total_size &&
+				        e.stored_size <= h->total_size - e.offset && e.compression <= static_cast<std::uint8_t>(pack_compression::lz) &&
+				        (e.compression != static_cast<std::uint8_t>(pack_compression::none) || e.stored_size == e.size);
+			}
+		}
+		if (!valid) {
+			ec = std::make_error_code(std::errc::bad_message);
+			return;
+		}
+
+		m_mapping = std::move(mapping);
+		m_header = reinterpret_cast<const header*>(m_mapping.data());
+	}
+
+	mapped_pack::mapped_pack(mapped_pack&& other) noexcept
+	    : m_handle(other.m_handle), m_file(std::move(other.m_file)), m_mapping(std::move(other.m_mapping)), m_header(other.m_header) {
+		other.m_header = nullptr;
+	}
+
+	mapped_pack& mapped_pack::operator=(mapped_pack&& other) noexcept {
+		if (this != &other) {
+			this->~mapped_pack();
+			new (this) mapped_pack(std::move(other));
+		}
+		return *this;
+	}
+
+	size_t mapped_pack::size() const {
+		return m_header != nullptr ? static_cast<size_t>(m_header->entry_count) : 0;
+	}
+
+	pack_entry mapped_pack::entry(size_t const index) const {
+		auto const* const base = reinterpret_cast<const char*>(m_header);
+		entry_record const& e = section<entry_record>(base, m_header->entries_offset)[index];
+		pack_entry out;
+		out.name = eastl::string_view(base + m_header->strings_offset + e.name_offset, e.name_length);
+		out.size = e.size;
+		out.stored_size = e.stored_size;
+		out.compression = static_cast<pack_compression>(e.compression);
+		return out;
+	}
+
+	size_t mapped_pack::find(path_view const relative) const {
+		if (m_header == nullptr || relative.empty() || !lookupable(relative))
+			return npos;
+		auto const* const base = reinterpret_cast<const char*>(m_header);
+		auto const* const slots = section<slot_record>(base, m_header->slots_offset);
+		auto const* const entries = section<entry_record>(base, m_header->entries_offset);
+		const char* const strings = base + m_header->strings_offset;
+
+		std::uint64_t const hash = internal::hash_components(relative);
+		std::uint64_t const mask = m_header->slot_count - 1;
+		for (std::uint64_t i = hash & mask;; i = (i + 1) & mask) {
+			slot_record const slot = slots[i];
+			if (slot == 0)
+				return npos;
+			entry_record const& e = entries[slot - 1];
+			if (e.hash == hash && key_equals(eastl::string_view(strings + e.name_offset, e.name_length), relative))
+				return slot - 1;
+		}
+	}
+
+	eastl::pair<size_t, size_t> mapped_pack::entries_below(path_view const relative) const {
+		size_t const count = size();
+		if (relative.empty())
+			return eastl::pair<size_t, size_t>(0, count);
+		if (!lookupable(relative))
+			return eastl::pair<size_t, size_t>(0, 0);
+
+		// Entries below a directory share its name and a '/' as prefix, so they are contiguous in name order
+		auto const* const base = reinterpret_cast<const char*>(m_header);
+		auto const* const entries = section<entry_record>(base, m_header->entries_offset);
+		const char* const strings = base + m_header->strings_offset;
+		auto const order = [&](size_t const index) {
+			entry_record const& e = entries[index];
+			return compare_below(eastl::string_view(strings + e.name_offset, e.name_length), relative);
+		};
+		size_t const first = partition_point(0, count, [&](size_t const i) { return order(i) < 0; });
+		size_t const last = partition_point(first, count, [&](size_t const i) { return order(i) == 0; });
+		return eastl::pair<size_t, size_t>(first, last);
+	}
+
+	bool mapped_pack::is_directory(path_view const relative) const {
+		if (m_header == nullptr)
+			return false;
+		if (relative.empty())
+			return true;
+		eastl::pair<size_t, size_t> const range = entries_below(relative);
+		return range.first != range.second;
+	}
+
+	eastl::span<const std::byte> mapped_pack::data(size_t const index) const {
+		auto const* const base = reinterpret_cast<const char*>(m_header);
+		entry_record const& e = section<entry_record>(base, m_header->entries_offset)[index];
+		if (e.compression != static_cast<std::uint8_t>(pack_compression::none))
+			return eastl::span<const std::byte>();
+		return eastl::span<const std::byte>(reinterpret_cast<const std::byte*>(base + e.offset), static_cast<size_t>(e.size));
+	}
+
+	file_contents mapped_pack::open(size_t const index, std::error_code& ec) const {
+		ec.clear();
+		file_contents contents(m_handle);
+		auto const* const base = reinterpret_cast<const char*>(m_header);
+		entry_record const& e = section<entry_record>(base, m_header->entries_offset)[index];
+		if (e.compression == static_cast<std::uint8_t>(pack_compression::none)) {
+			contents.m_data = reinterpret_cast<const std::byte*>(base + e.offset);
+			contents.m_size = static_cast<size_t>(e.size);
+			contents.m_open = true;
+			return contents;
+		}
+
+		std::uint64_t const block_size = m_header->block_size;
+		std::uint64_t const blocks = (e.size + block_size - 1) / block_size;
+		if (blocks > e.stored_size / sizeof(std::uint32_t)) {
+			ec = std::make_error_code(std::errc::bad_message);
+			return contents;
+		}
+		auto const size = static_cast<size_t>(e.size);
+		auto handle = m_handle;
+		auto* const buffer = static_cast<std::byte*>(handle.allocate(size != 0 ? size : 1, 16, 0));
+		if (buffer == nullptr) {
+			ec = std::make_error_code(std::errc::not_enough_memory);
+			return contents;
+		}
+		contents.m_owned = buffer;
+		contents.m_data = buffer;
+		contents.m_size = size;
+
+		std::uint64_t position = blocks * sizeof(std::uint32_t);
+		for (std::uint64_t b = 0; b < blocks; ++b) {
+			std::uint32_t stored;
+			std::memcpy(&stored, base + e.offset + b * sizeof(std::uint32_t), sizeof(stored));
+			std::uint64_t const raw = eastl::min(block_size, e.size - b * block_size);
+			std::byte* const out = buffer + b * block_size;
+			auto const* const in = reinterpret_cast<const std::byte*>(base + e.offset + position);
+			if (stored > e.stored_size - position || (stored != raw && !internal::lz_decompress(in, stored, out, static_cast<size_t>(raw)))) {
+				ec = std::make_error_code(std::errc::bad_message);
+				return file_contents(m_handle);
+			}
+			if (stored == raw)
+				std::memcpy(out, in, stored);
+			position += stored;
+		}
+		contents.m_open = true;
+		return contents;
+	}
+
+	pack_builder::pack_builder(pack_options const& options, bvestl::polyalloc::allocator_handle const handle)
+	    : m_options(options), m_handle(handle), m_items(handle) {
+		m_options.block_size = eastl::max<std::uint32_t>(1, eastl::min(m_options.block_size, MAX_BLOCK_SIZE));
+	}
+
+	bool pack_builder::add_item(path_view const name, std::error_code& ec, item&& it) {
+		ec.clear();
+		if (!join_name(name, it.name)) {
+			ec = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+		m_items.push_back(std::move(it));
+		return true;
+	}
+
+	bool pack_builder::add(path_view const name, eastl::span<const std::byte> const data, std::error_code& ec, pack_compression const compression) {
+		item it{internal::string(m_handle), internal::vector<std::byte>(m_handle), path(m_handle), compression};
+		it.data.assign(data.begin(), data.end());
+		return add_item(name, ec, std::move(it));
+	}
+
+	bool pack_builder::add_file(path_view const name, path_view const source, std::error_code& ec, pack_compression const compression) {
+		item it{internal::string(m_handle), internal::vector<std::byte>(m_handle), path(source, m_handle), compression};
+		return add_item(name, ec, std::move(it));
+	}
+
+	bool pack_builder::add_directory(path_view const source, std::error_code& ec, pack_compression const compression, path_view const prefix) {
+		path const root(source, m_handle);
+		internal::string name(m_handle);
+		recursive_directory_iterator entries(source, ec, directory_options(), m_handle);
+		if (ec)
+			return false;
+		while (entries.next()) {
+			directory_entry const& entry = entries.entry();
+			file_type type = entry.type();
+			if (type == file_type::symlink || type == file_type::unknown) {
+				std::error_code status_error;
+				type = entry.status(status_error).type;
+			}
+			if (type != file_type::regular)
+				continue;
+
+			path_view const relative = entry.relative_path();
+			name.clear();
+			for (path_view const part : {prefix, relative}) {
+				for (eastl::string_view const component : part) {
+					if (!name.empty())
+						name.push_back('/');
+					name.append(component.data(), component.data() + component.size());
+				}
+			}
+			if (!add_file(path_view(eastl::string_view(name.data(), name.size()), path_type::posix_path), root / path(relative, m_handle), ec, compression))
+				return false;
+		}
+		ec = entries.error();
+		return !ec;
+	}
+
+	bool pack_builder::write(path_view const destination, std::error_code& ec) const {
+		ec.clear();
+		size_t const count = m_items.size();
+		auto const name_of = [this](size_t const i) { return eastl::string_view(m_items[i].name.data(), m_items[i].name.size()); };
+
+		// Name order, in which a name added twice is next to itself, and a file is followed by what is below it
+		internal::vector<size_t> order(count, 0, m_handle);
+		for (size_t i = 0; i < count; ++i)
+			order[i] = i;
+		eastl::sort(order.begin(), order.end(), [&](size_t const a, size_t const b) { return name_of(a) < name_of(b); });
+		for (size_t i = 0; i + 1 < count; ++i) {
+			eastl::string_view const name = name_of(order[i]);
+			if (name_of(order[i + 1]) == name) {
+				ec = std::make_error_code(std::errc::file_exists);
+				return false;
+			}
+			path_view const as_directory(name, path_type::posix_path);
+			size_t const below = partition_point(i + 1, count, [&](size_t const j) { return compare_below(name_of(order[j]), as_directory) < 0; });
+			if (below != count && compare_below(name_of(order[below]), as_directory) == 0) {
+				ec = std::make_error_code(std::errc::not_a_directory);
+				return false;
+			}
+		}
+
+		size_t slot_count = 16;
+		while (slot_count < count * 2)
+			slot_count *= 2;
+		internal::vector<slot_record> slots(slot_count, 0, m_handle);
+		internal::vector<entry_record> entries(count, entry_record{}, m_handle);
+		internal::string strings(m_handle);
+		for (size_t i = 0; i < count; ++i) {
+			eastl::string_view const name = name_of(order[i]);
+			entry_record& e = entries[i];
+			e.hash = internal::hash_components(path_view(name, path_type::posix_path));
+			e.name_offset = strings.size();
+			e.name_length = static_cast<std::uint32_t>(name.size());
+			e.compression = static_cast<std::uint8_t>(m_items[order[i]].compression);
+			strings.append(name.data(), name.data() + name.size());
+			size_t slot = static_cast<size_t>(e.hash) & (slot_count - 1);
+			while (slots[slot] != 0)
+				slot = (slot + 1) & (slot_count - 1);
+			slots[slot] = static_cast<slot_record>(i + 1);
+		}
+
+		mapped_pack::header h{};
+		std::memcpy(h.magic, PACK_MAGIC, sizeof(h.magic));
+		h.version = PACK_VERSION;
+		h.block_size = m_options.block_size;
+		h.entry_count = count;
+		h.slot_count = slot_count;
+		h.entries_offset = align8(sizeof(h));
+		h.slots_offset = align8(h.entries_offset + count * sizeof(entry_record));
+		h.strings_offset = align8(h.slots_offset + slot_count * sizeof(slot_record));
+		h.strings_size = strings.size();
+		h.data_offset = align16(h.strings_offset + strings.size());
+
+		file_handle out = open_file(destination, open_flags::write | open_flags::create | open_flags::truncate, ec, m_handle);
+		if (ec)
+			return false;
+
+		// Data goes in first, behind room for the index, which is written once every offset is known
+		size_t const block_size = m_options.block_size;
+		internal::vector<std::byte> compressed(block_size, std::byte{}, m_handle);
+		internal::vector<std::uint32_t> table(m_handle);
+		std::uint64_t offset = h.data_offset;
+		for (size_t i = 0; i < count; ++i) {
+			item const& it = m_items[order[i]];
+			entry_record& e = entries[i];
+			mapped_file mapping;
+			eastl::span<const std::byte> bytes(it.data.data(), it.data.size());
+			if (!it.source.empty()) {
+				mapping = mapped_file(it.source, ec, map_options(), m_handle);
+				if (ec)
+					return false;
+				mapping.advise(access_hint::sequential);
+				bytes = mapping.bytes();
+			}
+
+			// Empty entries take no room, so they never point past the end of the file
+			if (!bytes.empty())
+				offset = align16(offset);
+			e.offset = offset;
+			e.size = bytes.size();
+			if (it.compression == pack_compression::none) {
+				if (!write_at(out, offset, bytes.data(), bytes.size(), ec))
+					return false;
+				e.stored_size = bytes.size();
+			}
+			else {
+				size_t const blocks = (bytes.size() + block_size - 1) / block_size;
+				table.assign(blocks, 0);
+				std::uint64_t position = offset + blocks * sizeof(std::uint32_t);
+				for (size_t b = 0; b < blocks; ++b) {
+					const std::byte* const raw = bytes.data() + b * block_size;
+					size_t const raw_size = eastl::min(block_size, bytes.size() - b * block_size);
+					// A block is only kept compressed if that makes it smaller
+					size_t const packed = internal::lz_compress(raw, raw_size, compressed.data(), raw_size - 1);
+					const std::byte* const stored = packed != 0 ? compressed.data() : raw;
+					table[b] = static_cast<std::uint32_t>(packed != 0 ? packed : raw_size);
+					if (!write_at(out, position, stored, table[b], ec))
+						return false;
+					position += table[b];
+				}
+				if (!write_at(out, offset, table.data(), blocks * sizeof(std::uint32_t), ec))
+					return false;
+				e.stored_size = position - offset;
+			}
+			offset += e.stored_size;
+		}
+		h.total_size = offset;
+
+		auto const index_size = static_cast<size_t>(h.data_offset);
+		internal::vector<char> index(index_size, 0, m_handle);
+		std::memcpy(index.data(), &h, sizeof(h));
+		if (count != 0)
+			std::memcpy(index.data() + h.entries_offset, entries.data(), count * sizeof(entry_record));
+		std::memcpy(index.data() + h.slots_offset, slots.data(), slot_count * sizeof(slot_record));
+		if (!strings.empty())
+			std::memcpy(index.data() + h.strings_offset, strings.data(), strings.size());
+		return write_at(out, 0, index.data(), index.size(), ec);
+	}
+} // namespace bvestl::fs
@@ -1,5 +1,10 @@
 #define LIBFS_DISABLE_GLOBAL_ALLOCATOR
 #include "bvestl/fs/path.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/separators.hpp"
+#include "bvestl/fs/status.hpp"
+#include "bvestl/fs/walk.hpp"
 
 #if !defined(EA_PLATFORM_WINDOWS) && !defined(EA_PLATFORM_POSIX)
 #	error "FS Library designed for windows or POSIX only"
@@ -13,41 +18,121 @@
 #	include <Windows.h>
 #else
 #	include <unistd.h>
+#	include <fcntl.h>
 #	include <sys/stat.h>
-#	include <ftw.h>
 #endif
 
 #if defined(EA_PLATFORM_LINUX)
 #	include <linux/limits.h>
 #endif
 
+#include <EASTL/algorithm.h>
 #include <EASTL/type_traits.h>
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstring>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 
 namespace bvestl::fs {
-	void path::set(internal::string const& str, path_type const type, bvestl::polyalloc::allocator_handle const handle) {
+	path::path(path&& other) noexcept
+	    : m_text(std::move(other.m_text)),
+	      m_components(std::move(other.m_components)),
+	      m_hash(other.m_hash),
+	      m_type(other.m_type),
+	      m_absolute(other.m_absolute)
+#if defined(EA_PLATFORM_WINDOWS)
+	      ,
+	      m_native(std::move(other.m_native))
+#endif
+	{
+		other.reset_moved();
+	}
+
+	path& path::operator=(path&& other) noexcept {
+		if (this != &other) {
+			m_text = std::move(other.m_text);
+			m_components = std::move(other.m_components);
+			m_hash = other.m_hash;
+			m_type = other.m_type;
+			m_absolute = other.m_absolute;
+#if defined(EA_PLATFORM_WINDOWS)
+			m_native = std::move(other.m_native);
+#endif
+			other.reset_moved();
+		}
+		return *this;
+	}
+
+	void path::reset_moved() {
+#if defined(EA_PLATFORM_WINDOWS)
+		m_native.reset();
+#endif
+		// Both buffers are back to their inline storage, so this can't allocate
+		m_text.clear();
+		m_text.push_back('\0');
+		m_components.clear();
+		m_hash = internal::PATH_HASH_OFFSET;
+		m_absolute = false;
+	}
+
+	void path::set(internal::string const& str, path_type const type, bvestl::polyalloc::allocator_handle /*handle*/) {
+		assign(str.data(), str.size(), type);
+	}
+
+	void path::assign(const char* str, size_t length, path_type const type) {
+#if defined(EA_PLATFORM_WINDOWS)
+		m_native.reset();
+#endif
 		m_type = type;
-		if (type == path_type::windows_path) {
-			internal::string tmp(str, handle);
+		m_text.clear();
+		m_components.clear();
+		m_hash = internal::PATH_HASH_OFFSET;
 
+		bool const windows = type == path_type::windows_path;
+		if (windows) {
 			// Long windows paths (sometimes) begin with the prefix \\?\. It should only
 			// be used when the path is >MAX_PATH characters long, so we remove it
 			// for convenience and add it back (if necessary) in str()/wstr().
-			static const internal::string PREFIX(R"(\\?\)", get_global_allocator());
-			if (tmp.length() >= PREFIX.length()
-			    && std::mismatch(std::begin(PREFIX), std::end(PREFIX), std::begin(tmp)).first == std::end(PREFIX)) {
-				tmp.erase(0, 4);
+			static const char PREFIX[] = R"(\\?\)";
+			static const size_t PREFIX_LENGTH = sizeof(PREFIX) - 1;
+			if (length >= PREFIX_LENGTH && std::memcmp(str, PREFIX, PREFIX_LENGTH) == 0) {
+				str += PREFIX_LENGTH;
+				length -= PREFIX_LENGTH;
 			}
-			m_path = tokenize(tmp, internal::string("/\\", handle), m_path.get_allocator());
-			m_absolute = tmp.size() >= 2 && std::isalpha(tmp[0]) && tmp[1] == ':';
+			m_absolute = length >= 2 && std::isalpha(static_cast<unsigned char>(str[0])) && str[1] == ':';
 		}
 		else {
-			m_path = tokenize(str, internal::string("/", handle), m_path.get_allocator());
-			m_absolute = !str.empty() && str[0] == '/';
+			m_absolute = length != 0 && str[0] == '/';
 		}
+
+		// The text never grows beyond the input plus the root and the terminator
+		m_text.reserve(length + 2);
+		if (prefix_length() != 0)
+			m_text.push_back('/');
+		m_text.push_back('\0');
+
+		const char* const end = str + length;
+		for (const char* start = str;; ++start) {
+			const char* const separator = internal::find_separator(start, end, windows);
+			if (separator != start)
+				push_component(start, static_cast<size_t>(separator - start));
+			if (separator == end)
+				break;
+			start = separator;
+		}
+	}
+
+	void path::push_component(const char* const str, size_t const length) {
+		m_text.pop_back();
+		if (!m_components.empty())
+			m_text.push_back('/');
+		m_components.push_back(component{static_cast<std::uint32_t>(m_text.size()), static_cast<std::uint32_t>(length)});
+		m_text.append(str, length);
+		m_text.push_back('\0');
+		m_hash = internal::hash_component(m_hash, eastl::string_view(str, length));
 	}
 
 #if defined(EA_PLATFORM_WINDOWS)
@@ -65,35 +150,30 @@ namespace bvestl::fs {
 	internal::string path::str(path_type const type, bvestl::polyalloc::allocator_handle const handle) const {
 		internal::string out_str(handle);
 
+		const char* const body = m_text.data() + prefix_length();
+		size_t const body_length = text_length() - prefix_length();
+		out_str.reserve(body_length + 5);
+
 		if (m_absolute) {
 			if (m_type == path_type::posix_path)
 				out_str += '/';
 			else {
-				size_t length = 0;
-				for (const auto& i : m_path) {
-					// No special case for the last segment to count the NULL character
-					length += i.length() + 1;
-				}
+				// Every component plus its separator, the last one counting the NULL character
+				size_t const length = m_components.empty() ? 0 : body_length + 1;
 				// Windows requires a \\?\ prefix to handle paths longer than MAX_PATH
 				// (including their null character). NOTE: relative paths >MAX_PATH are
 				// not supported at all in Windows.
 				if (length > MAX_PATH_WINDOWS_LEGACY) {
-					char header[] = R"(\\?\)";
-					out_str.append(header, eastl::extent<decltype(header)>::value);
+					out_str.append(R"(\\?\)");
 				}
 			}
 		}
 
-		for (size_t i = 0; i < m_path.size(); ++i) {
-			out_str.append(m_path[i]);
-			if (i + 1 < m_path.size()) {
-				if (type == path_type::posix_path) {
-					out_str += '/';
-				}
-				else {
-					out_str += '\\';
-				}
-			}
+		// Components are stored joined by '/', so only windows output needs rewriting
+		size_t const offset = out_str.size();
+		out_str.append(body, body + body_length);
+		if (type != path_type::posix_path) {
+			std::replace(out_str.begin() + offset, out_str.end(), '/', '\\');
 		}
 
 		return out_str;
@@ -109,78 +189,58 @@ namespace bvestl::fs {
 	}
 #endif
 
+#if defined(EA_PLATFORM_WINDOWS)
+	const native_char* path::native_c_str() const {
+		if (!m_native)
+			m_native.emplace(wstr(path_type::windows_path, m_text.get_allocator()));
+		return m_native->c_str();
+	}
+#endif
+
 	internal::string path::filename(bvestl::polyalloc::allocator_handle const handle) const {
 		if (empty())
 			return internal::string(handle);
-		const internal::string& last = m_path[m_path.size() - 1];
-		return internal::string(last, handle);
+		const char* const last = component_data(m_components.size() - 1);
+		return internal::string(last, last + m_components.back().length, handle);
 	}
 
 	internal::string path::extension(bvestl::polyalloc::allocator_handle const handle) const {
-		const internal::string& name = filename(handle);
-		size_t const pos = name.find_last_of('.');
-		if (pos == internal::string::npos)
+		if (empty())
 			return internal::string(handle);
-		return internal::substr(name, pos + 1, handle);
+		const char* const name = component_data(m_components.size() - 1);
+		const char* const name_end = name + m_components.back().length;
+		for (const char* it = name_end; it != name; --it) {
+			if (it[-1] == '.')
+				return internal::string(it, name_end, handle);
+		}
+		return internal::string(handle);
 	}
 
 	size_t path::file_size(bvestl::polyalloc::allocator_handle const handle) const {
-#if defined(_WIN32)
-		struct _stati64 sb;
-		if (_wstati64(wstr(handle).c_str(), &sb) != 0)
-			throw std::runtime_error(("path::file_size(): cannot stat file \"" + str(handle) + "\"!").c_str());
-#else
-		struct stat sb {};
-		if (stat(str(path_type::posix_path, handle).c_str(), &sb) != 0)
-			throw std::runtime_error(("path::file_size(): cannot stat file \"" + str(path_type::posix_path, handle) + "\"!").c_str());
-#endif
-		return static_cast<size_t>(sb.st_size);
+		return fs::file_size(*this, handle);
 	}
 
 	bool path::file_exists(bvestl::polyalloc::allocator_handle const handle) const {
-#if defined(_WIN32)
-		return GetFileAttributesW(wstr(handle).c_str()) != INVALID_FILE_ATTRIBUTES;
-#else
-		struct stat sb {};
-		return stat(str(path_type::posix_path, handle).c_str(), &sb) == 0;
-#endif
+		return fs::file_exists(*this, handle);
 	}
 
 	bool path::is_directory(bvestl::polyalloc::allocator_handle const handle) const {
-#if defined(_WIN32)
-		DWORD const result = GetFileAttributesW(wstr(handle).c_str());
-		if (result == INVALID_FILE_ATTRIBUTES)
-			return false;
-		return (result & FILE_ATTRIBUTE_DIRECTORY) != 0;
-#else
-		struct stat sb {};
-		if (stat(str(path_type::posix_path, handle).c_str(), &sb))
-			return false;
-		return S_ISDIR(sb.st_mode);
-#endif
+		return fs::is_directory(*this, handle);
 	}
 
 	bool path::is_file(bvestl::polyalloc::allocator_handle const handle) const {
-#if defined(_WIN32)
-		DWORD const attr = GetFileAttributesW(wstr(handle).c_str());
-		return (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) == 0);
-#else
-		struct stat sb {};
-		if (stat(str(path_type::posix_path, handle).c_str(), &sb))
-			return false;
-		return S_ISREG(sb.st_mode);
-#endif
+		return fs::is_file(*this, handle);
 	}
 
 	path path::make_absolute(bvestl::polyalloc::allocator_handle const handle) const {
 #if !defined(_WIN32)
 		char temp[PATH_MAX];
-		if (realpath(str(path_type::posix_path, handle).c_str(), temp) == nullptr)
+		if (realpath(native_c_str(), temp) == nullptr)
 			throw std::runtime_error("Internal error in realpath(): " + std::string(strerror(errno)));
 		return path(temp, handle);
 #else
-		internal::wstring value = wstr(handle), out(MAX_PATH_WINDOWS, '\0', handle);
-		DWORD const length = GetFullPathNameW(value.c_str(), MAX_PATH_WINDOWS, &out[0], nullptr);
+		internal::wstring out(MAX_PATH_WINDOWS, '\0', handle);
+		DWORD const length = GetFullPathNameW(native_c_str(), MAX_PATH_WINDOWS, &out[0], nullptr);
 		if (length == 0)
 			throw std::runtime_error("Internal error in realpath(): " + std::to_string(GetLastError()));
 		return path(internal::substr(out, 0, length, handle), handle);
@@ -189,57 +249,212 @@ namespace bvestl::fs {
 
 	path path::parent_path(bvestl::polyalloc::allocator_handle handle) const {
 		path result(handle);
+		result.m_type = m_type;
 		result.m_absolute = m_absolute;
 
-		if (m_path.empty()) {
+		if (m_components.empty()) {
+			result.m_text.assign(m_text.data(), m_text.size());
 			if (!m_absolute)
-				result.m_path.emplace_back("..", handle);
+				result.push_component("..", 2);
 		}
 		else {
-			size_t const until = m_path.size() - 1;
+			size_t const until = m_components.size() - 1;
+			size_t const end = until == 0 ? prefix_length() : m_components[until - 1].offset + m_components[until - 1].length;
+			result.m_text.reserve(end + 1);
+			result.m_text.assign(m_text.data(), end);
+			result.m_text.push_back('\0');
+			result.m_components.assign(m_components.data(), until);
 			for (size_t i = 0; i < until; ++i)
-				result.m_path.push_back(m_path[i]);
+				result.m_hash = internal::hash_component(result.m_hash, eastl::string_view(component_data(i), m_components[i].length));
 		}
 		return result;
 	}
 
-	path path::operator/(path const& other) const {
-		if (other.m_absolute)
+	path::path(path_literal const& literal, bvestl::polyalloc::allocator_handle const handle) :
+	    m_text(handle), m_components(handle), m_hash(literal.hash), m_type(literal.type), m_absolute(literal.absolute) {
+		m_text.assign(literal.text, literal.text_length + 1);
+		m_components.assign(literal.components, literal.count);
+	}
+
+	path path::join(path_literal const& lhs, path_literal const& rhs, bvestl::polyalloc::allocator_handle const handle) {
+		if (rhs.absolute)
 			throw std::runtime_error("path::operator/(): expected a relative path!");
-		if (m_type != other.m_type)
+		if (lhs.type != rhs.type)
 			throw std::runtime_error("path::operator/(): expected a path of the same type!");
 
-		path result(*this);
-
-		for (const auto& i : other.m_path) {
-			result.m_path.push_back(i);
+		path result(handle);
+		result.m_type = lhs.type;
+		result.m_absolute = lhs.absolute;
+		result.m_hash = lhs.hash;
+
+		// Size both buffers up front so the join costs at most one allocation each
+		result.m_text.reserve(lhs.text_length + rhs.text_length + 2);
+		result.m_components.reserve(lhs.count + rhs.count);
+
+		result.m_text.assign(lhs.text, lhs.text_length);
+		result.m_components.assign(lhs.components, lhs.count);
+
+		if (rhs.count != 0) {
+			if (lhs.count != 0)
+				result.m_text.push_back('/');
+			auto const base = static_cast<std::uint32_t>(result.m_text.size());
+			result.m_text.append(rhs.text, rhs.text_length);
+			for (size_t i = 0; i < rhs.count; ++i) {
+				component const c = rhs.components[i];
+				result.m_components.push_back(component{c.offset + base, c.length});
+				result.m_hash = internal::hash_component(result.m_hash, eastl::string_view(rhs.text + c.offset, c.length));
+			}
 		}
+		result.m_text.push_back('\0');
 
 		return result;
 	}
 
-	std::ostream& operator<<(std::ostream& os, path const& path) {
-		os << path.str(path::path_type::native_path, path.m_path.get_allocator()).c_str();
-		return os;
+	path path::operator/(path const& other) const {
+		return join(literal(), other.literal(), m_text.get_allocator());
+	}
+
+	path path::operator/(path_literal const& other) const {
+		return join(literal(), other, m_text.get_allocator());
+	}
+
+	path operator/(path_literal const& lhs, path const& rhs) {
+		return path::join(lhs, rhs.literal(), rhs.m_text.get_allocator());
 	}
 
-	internal::vector<internal::string> path::tokenize(const internal::string& string,
-	                                                  const internal::string& deliminator,
-	                                                  bvestl::polyalloc::allocator_handle const handle) {
-		internal::string::size_type lastPos = 0, pos = string.find_first_of(deliminator, lastPos);
-		internal::vector<internal::string> tokens(handle);
+	namespace {
+		bool is_dot(eastl::string_view const name) {
+			return name.size() == 1 && name[0] == '.';
+		}
+
+		bool is_dot_dot(eastl::string_view const name) {
+			return name.size() == 2 && name[0] == '.' && name[1] == '.';
+		}
+	} // namespace
+
+	path path::lexically_normal(bvestl::polyalloc::allocator_handle const handle) const {
+		path result(handle);
+		result.m_type = m_type;
+		result.m_absolute = m_absolute;
+		if (m_components.empty()) {
+			result.m_text.assign(m_text.data(), m_text.size());
+			return result;
+		}
 
-		while (lastPos != internal::string::npos) {
-			if (pos != lastPos) {
-				tokens.push_back(internal::substr(string, lastPos, eastl::min(string.size() - lastPos, pos - lastPos), handle));
+		// Folding only ever removes components and text, so sizing both like this path's is all the allocation it needs
+		result.m_components.reserve(m_components.size());
+		result.m_text.reserve(m_text.size());
+
+		// First decide which components survive, still pointing into this path's text
+		auto const name = [this](component const c) { return eastl::string_view(m_text.data() + c.offset, c.length); };
+		// The drive of an absolute Windows path can't be folded away
+		size_t const floor = m_absolute && m_type == path_type::windows_path ? 1 : 0;
+		for (size_t i = 0; i < m_components.size(); ++i) {
+			component const c = m_components[i];
+			if (i >= floor && is_dot(name(c)))
+				continue;
+			if (i >= floor && is_dot_dot(name(c))) {
+				if (result.m_components.size() > floor && !is_dot_dot(name(result.m_components.back()))) {
+					result.m_components.pop_back();
+					continue;
+				}
+				// Nothing is above the root
+				if (m_absolute)
+					continue;
 			}
-			lastPos = pos;
-			if (lastPos == internal::string::npos || lastPos + 1 == string.length())
-				break;
-			pos = string.find_first_of(deliminator, ++lastPos);
+			result.m_components.push_back(c);
 		}
 
-		return tokens;
+		// Then copy their text over, moving them to where it lands
+		result.m_text.clear();
+		if (result.prefix_length() != 0)
+			result.m_text.push_back('/');
+		for (component& c : result.m_components) {
+			if (result.m_text.size() != result.prefix_length())
+				result.m_text.push_back('/');
+			eastl::string_view const text = name(c);
+			c.offset = static_cast<std::uint32_t>(result.m_text.size());
+			result.m_text.append(text.data(), text.size());
+			result.m_hash = internal::hash_component(result.m_hash, text);
+		}
+		result.m_text.push_back('\0');
+		if (result.m_components.empty() && !m_absolute)
+			result.push_component(".", 1);
+		return result;
+	}
+
+	path path::lexically_relative(path const& base, bvestl::polyalloc::allocator_handle const handle) const {
+		path result(handle);
+		result.m_type = m_type;
+		if (m_absolute != base.m_absolute)
+			return result;
+
+		size_t const count = eastl::min(m_components.size(), base.m_components.size());
+		size_t common = 0;
+		while (common < count && component_name(common) == base.component_name(common))
+			++common;
+		// Different drives
+		if (m_absolute && m_type == path_type::windows_path && common == 0)
+			return result;
+
+		// Climbing out of what is left of base takes one ".." per directory it descends into
+		std::ptrdiff_t climb = 0;
+		for (size_t i = common; i < base.m_components.size(); ++i) {
+			eastl::string_view const name = base.component_name(i);
+			if (is_dot_dot(name))
+				--climb;
+			else if (!is_dot(name))
+				++climb;
+		}
+		if (climb < 0)
+			return result;
+		if (climb == 0 && common == m_components.size()) {
+			result.push_component(".", 1);
+			return result;
+		}
+
+		size_t length = static_cast<size_t>(climb) * 3;
+		for (size_t i = common; i < m_components.size(); ++i)
+			length += m_components[i].length + 1;
+		result.m_text.reserve(length + 1);
+		result.m_components.reserve(static_cast<size_t>(climb) + m_components.size() - common);
+		for (std::ptrdiff_t i = 0; i < climb; ++i)
+			result.push_component("..", 2);
+		for (size_t i = common; i < m_components.size(); ++i)
+			result.push_component(component_data(i), m_components[i].length);
+		return result;
+	}
+
+	bool path::operator==(path const& p) const {
+		// Components are joined identically in both buffers, so comparing the text
+		// behind the root compares the component sequences. Differing hashes or
+		// lengths settle most mismatches without looking at it.
+		size_t const length = text_length() - prefix_length();
+		if (m_hash != p.m_hash || length != p.text_length() - p.prefix_length() || m_components.size() != p.m_components.size())
+			return false;
+		return std::memcmp(m_text.data() + prefix_length(), p.m_text.data() + p.prefix_length(), length) == 0;
+	}
+
+	int path::compare(path const& p) const {
+		// Not a comparison of the text, where '/' would sort after the '-' and '.' that can end a component
+		size_t const count = eastl::min(m_components.size(), p.m_components.size());
+		for (size_t i = 0; i < count; ++i) {
+			size_t const lhs_length = m_components[i].length;
+			size_t const rhs_length = p.m_components[i].length;
+			int const result = std::memcmp(component_data(i), p.component_data(i), eastl::min(lhs_length, rhs_length));
+			if (result != 0)
+				return result;
+			if (lhs_length != rhs_length)
+				return lhs_length < rhs_length ? -1 : 1;
+		}
+		if (m_components.size() != p.m_components.size())
+			return m_components.size() < p.m_components.size() ? -1 : 1;
+		return 0;
+	}
+
+	std::ostream& operator<<(std::ostream& os, path const& path) {
+		os << path.str(path::path_type::native_path, path.m_text.get_allocator()).c_str();
+		return os;
 	}
 
 	path cwd(bvestl::polyalloc::allocator_handle const handle) {
@@ -256,80 +471,187 @@ namespace bvestl::fs {
 #endif
 	}
 
-	bool create_directory(path const& p, bvestl::polyalloc::allocator_handle const handle) {
+	size_t file_size(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		std::error_code ec;
+		file_status const sb = status(p, ec, status_mask::type | status_mask::size, handle);
+		if (!sb.exists())
+			throw std::runtime_error(("path::file_size(): cannot stat file \"" + path(p, handle).str(handle) + "\"!").c_str());
+		return static_cast<size_t>(sb.size);
+	}
+
+	bool file_exists(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		std::error_code ec;
+		return status(p, ec, status_mask::type, handle).exists();
+	}
+
+	bool is_directory(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		std::error_code ec;
+		return status(p, ec, status_mask::type, handle).is_directory();
+	}
+
+	bool is_file(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		std::error_code ec;
+		return status(p, ec, status_mask::type, handle).is_regular_file();
+	}
+
+	bool create_directory(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		internal::native_path const native(p, handle);
+		BVESTL_FS_OP_BEGIN(mkdir);
 #if defined(_WIN32)
-		return CreateDirectoryW(p.wstr(handle).c_str(), nullptr) != 0;
+		bool const ok = CreateDirectoryW(native.c_str(), nullptr) != 0;
 #else
-		return mkdir(p.str(path::path_type::posix_path, handle).c_str(), S_IRWXU) == 0;
+		bool const ok = mkdir(native.c_str(), S_IRWXU) == 0;
 #endif
+		BVESTL_FS_OP_END(mkdir, !ok);
+		return ok;
 	}
 
-	bool create_directory_recursive(path const& p, bvestl::polyalloc::allocator_handle const handle) {
-#if defined(_WIN32)
-		return SHCreateDirectory(nullptr, p.make_absolute(handle).wstr(handle).c_str()) == ERROR_SUCCESS;
+	bool remove_directory(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		clear_directory_cache();
+		internal::native_path const native(p, handle);
+		BVESTL_FS_OP_BEGIN(rmdir);
+#if defined(EA_PLATFORM_WINDOWS)
+		bool const ok = RemoveDirectoryW(native.c_str()) != 0;
 #else
-		if (create_directory(path(p.str(path::path_type::posix_path, handle).c_str(), handle), handle))
-			return true;
+		bool const ok = rmdir(native.c_str()) == 0;
+#endif
+		BVESTL_FS_OP_END(rmdir, !ok);
+		return ok;
+	}
 
-		if (p.empty())
-			return false;
+	bool remove_directory_recursive(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		return !remove_directory_recursive(p, remove_options(), handle).error;
+	}
 
-		if (errno == ENOENT) {
-			if (create_directory(p.parent_path(handle), handle))
-				return mkdir(p.str(path::path_type::posix_path, handle).c_str(), S_IRWXU) == 0;
-			else
-				return false;
+	remove_result remove_directory_recursive(path_view const p, remove_options const& options, bvestl::polyalloc::allocator_handle const handle) {
+		remove_result result(handle);
+		clear_directory_cache();
+
+		std::error_code ec;
+		file_status const root_status = symlink_status(p, ec, status_mask::type, handle);
+		if (ec || !root_status.exists()) {
+			result.error = ec ? ec : std::make_error_code(std::errc::no_such_file_or_directory);
+			result.failed_path = path(p, handle);
+			return result;
 		}
-		return false;
-#endif
-	}
 
-	bool remove_directory(path const& p, bvestl::polyalloc::allocator_handle const handle) {
+		std::mutex error_lock;
+		std::atomic<std::uint64_t> removed{0};
+		auto const fail = [&](std::error_code const& error, path_view const where) {
+			std::lock_guard<std::mutex> lg(error_lock);
+			if (!result.error) {
+				result.error = error;
+				result.failed_path = where.empty() ? path(p, handle) : path(p, handle) / path(where, handle);
+			}
+		};
+
 #if defined(EA_PLATFORM_WINDOWS)
-		return RemoveDirectoryW(p.wstr(handle).c_str()) != 0;
+		path const root(p, handle);
+		auto const remove_entry = [&](const directory_entry& entry, bool const directory) -> std::error_code {
+			path const full = root / path(entry.relative_path(), handle);
+			BVESTL_FS_OP_BEGIN(unlink);
+			BOOL const ok = directory ? RemoveDirectoryW(full.native_c_str()) : DeleteFileW(full.native_c_str());
+			BVESTL_FS_OP_END(unlink, !ok);
+			return ok ? std::error_code() : std::error_code(static_cast<int>(GetLastError()), std::system_category());
+		};
 #else
-		if (rmdir(p.str(handle).c_str())) {
-			return false;
-		}
-		return true;
+		auto const remove_entry = [](const directory_entry& entry, bool const directory) -> std::error_code {
+			BVESTL_FS_OP_BEGIN(unlink);
+			int const result = unlinkat(entry.directory_fd(), entry.name().data(), directory ? AT_REMOVEDIR : 0);
+			BVESTL_FS_OP_END(unlink, result != 0);
+			if (result != 0)
+				return std::error_code(errno, std::generic_category());
+			return std::error_code();
+		};
 #endif
-	}
 
-	bool remove_directory_recursive(path const& p, bvestl::polyalloc::allocator_handle const handle) {
-#if defined(EA_PLATFORM_WINDOWS)
-		internal::wstring copy(p.wstr(handle), handle);
-		copy.push_back('\0');
+		struct remover {
+			walk_action operator()(const directory_entry& entry, size_t) {
+				if (entry.type() == file_type::directory)
+					return walk_action::proceed;
+				std::error_code const error = m_remove(entry, false);
+				if (!error) {
+					m_removed.fetch_add(1, std::memory_order_relaxed);
+					return walk_action::proceed;
+				}
+				// Already gone is as good as removed
+				if (error == std::errc::no_such_file_or_directory)
+					return walk_action::proceed;
+				// Listings that don't report types only reveal directories here
+				bool const is_directory = error == std::errc::is_a_directory || error == std::errc::operation_not_permitted
+				                          || error == std::errc::permission_denied;
+				if (entry.type() == file_type::unknown && is_directory) {
+					std::error_code ignored;
+					if (entry.symlink_status(ignored, status_mask::type).is_directory())
+						return walk_action::proceed;
+				}
+				m_fail(error, entry.relative_path());
+				return walk_action::stop;
+			}
 
-		SHFILEOPSTRUCTW file_op{nullptr, FO_DELETE, copy.c_str(), L"", FOF_NOCONFIRMATION | FOF_NOERRORUI | FOF_SILENT,
-		                        false,   nullptr,   L""};
-		int const ret = SHFileOperationW(&file_op);
-		return ret == 0;
-#else
-		auto rem_func = [](const char* f_path, const struct stat* /*stat_buffer*/, int /*typeflag*/, struct FTW * /*ftwbuf*/) -> int {
-			return remove(f_path);
+			void leave(const directory_entry& entry, size_t) {
+				std::error_code const error = m_remove(entry, true);
+				if (error)
+					m_fail(error, entry.relative_path());
+				else
+					m_removed.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			decltype(remove_entry)& m_remove;
+			decltype(fail)& m_fail;
+			std::atomic<std::uint64_t>& m_removed;
 		};
 
-		if (nftw(p.str(handle).c_str(), rem_func, 128, FTW_DEPTH)) {
-			// TODO: Error checking
-			return false;
+		if (root_status.is_directory()) {
+			walk_options walk;
+			walk.threads = options.threads;
+			walk.symlinks = symlink_policy::report;
+			walk_result const walked = parallel_walk(p, remover{remove_entry, fail, removed}, walk, handle);
+			if (walked.error)
+				fail(walked.error, walked.failed_path);
 		}
-		return true;
+
+		if (!result.error) {
+			internal::native_path const native(p, handle);
+			BVESTL_FS_OP_BEGIN(unlink);
+#if defined(EA_PLATFORM_WINDOWS)
+			BOOL const ok = root_status.is_directory() ? RemoveDirectoryW(native.c_str()) : DeleteFileW(native.c_str());
+			BVESTL_FS_OP_END(unlink, !ok);
+			if (!ok)
+				fail(std::error_code(static_cast<int>(GetLastError()), std::system_category()), path_view());
+#else
+			int const unlinked = unlinkat(AT_FDCWD, native.c_str(), root_status.is_directory() ? AT_REMOVEDIR : 0);
+			BVESTL_FS_OP_END(unlink, unlinked != 0);
+			if (unlinked != 0)
+				fail(std::error_code(errno, std::generic_category()), path_view());
 #endif
+			else
+				removed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		result.removed = removed.load();
+		return result;
 	}
 
-	bool remove_file(const path& p, bvestl::polyalloc::allocator_handle const handle) {
+	bool remove_file(path_view const p, bvestl::polyalloc::allocator_handle const handle) {
+		internal::native_path const native(p, handle);
+		BVESTL_FS_OP_BEGIN(unlink);
 #if !defined(_WIN32)
-		return std::remove(p.str(path::path_type::posix_path, handle).c_str()) == 0;
+		// Not std::remove(), which would also take empty directories the directory cache may know about
+		bool const ok = ::unlink(native.c_str()) == 0;
 #else
-		return DeleteFileW(p.wstr(handle).c_str()) != 0;
+		bool const ok = DeleteFileW(native.c_str()) != 0;
 #endif
+		BVESTL_FS_OP_END(unlink, !ok);
+		return ok;
 	}
 
-	bool resize_file(const path& p, size_t const target_length, bvestl::polyalloc::allocator_handle const handle) {
+	bool resize_file(path_view const p, size_t const target_length, bvestl::polyalloc::allocator_handle const handle) {
+		internal::native_path const native(p, handle);
 #if !defined(_WIN32)
-		return ::truncate(p.str(path::path_type::posix_path, handle).c_str(), (off_t) target_length) == 0;
+		return ::truncate(native.c_str(), (off_t) target_length) == 0;
 #else
-		HANDLE const file_handle = CreateFileW(p.wstr(handle).c_str(), GENERIC_WRITE, 0, nullptr, 0, FILE_ATTRIBUTE_NORMAL, nullptr);
+		HANDLE const file_handle = CreateFileW(native.c_str(), GENERIC_WRITE, 0, nullptr, 0, FILE_ATTRIBUTE_NORMAL, nullptr);
 		if (file_handle == INVALID_HANDLE_VALUE)
 			return false;
 		LARGE_INTEGER size;
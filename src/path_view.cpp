@@ -0,0 +1,89 @@
+#include "bvestl/fs/path_view.hpp"
+#include "bvestl/fs/internal/path_hash.hpp"
+
+#include <ostream>
+
+namespace bvestl::fs {
+	size_t path_view::root_length() const {
+		if (m_type == path_type::windows_path && m_text.size() >= 4 && m_text.compare(0, 4, R"(\\?\)") == 0)
+			return 4;
+		return 0;
+	}
+
+	size_t path_view::length() const {
+		size_t count = 0;
+		for (auto it = begin(), last = end(); it != last; ++it)
+			++count;
+		return count;
+	}
+
+	bool path_view::is_absolute() const {
+		if (m_type == path_type::windows_path) {
+			size_t const root = root_length();
+			return m_text.size() >= root + 2 && std::isalpha(static_cast<unsigned char>(m_text[root])) && m_text[root + 1] == ':';
+		}
+		return !m_text.empty() && m_text[0] == '/';
+	}
+
+	eastl::string_view path_view::filename() const {
+		const char* const first = m_text.data() + root_length();
+		const char* last = m_text.data() + m_text.size();
+		while (last != first && is_separator(last[-1], m_type))
+			--last;
+		const char* it = last;
+		while (it != first && !is_separator(it[-1], m_type))
+			--it;
+		return eastl::string_view(it, static_cast<size_t>(last - it));
+	}
+
+	eastl::string_view path_view::extension() const {
+		eastl::string_view const name = filename();
+		size_t const pos = name.find_last_of('.');
+		if (pos == eastl::string_view::npos)
+			return eastl::string_view();
+		return name.substr(pos + 1);
+	}
+
+	path_view path_view::parent() const {
+		if (empty()) {
+			// Mirrors path::parent_path(): the root is its own parent, an empty relative path goes up
+			if (is_absolute())
+				return *this;
+			return path_view(eastl::string_view(".."), m_type);
+		}
+
+		const char* const data = m_text.data();
+		const char* const first = data + root_length();
+		const char* it = data + m_text.size();
+		while (it != first && is_separator(it[-1], m_type))
+			--it;
+		while (it != first && !is_separator(it[-1], m_type))
+			--it;
+		while (it != first && is_separator(it[-1], m_type))
+			--it;
+
+		// The POSIX root keeps its slash
+		if (it == first && m_type == path_type::posix_path && is_absolute())
+			++it;
+		return path_view(eastl::string_view(data, static_cast<size_t>(it - data)), m_type);
+	}
+
+	size_t path_view::hash() const {
+		return static_cast<size_t>(internal::hash_components(*this));
+	}
+
+	bool path_view::operator==(path_view const& p) const {
+		auto lhs = begin(), lhs_end = end();
+		auto rhs = p.begin(), rhs_end = p.end();
+		for (; lhs != lhs_end && rhs != rhs_end; ++lhs, ++rhs) {
+			if (*lhs != *rhs)
+				return false;
+		}
+		return lhs == lhs_end && rhs == rhs_end;
+	}
+
+	std::ostream& operator<<(std::ostream& os, path_view const& path) {
+		os.write(path.text().data(), static_cast<std::streamsize>(path.text().size()));
+		return os;
+	}
+} // namespace bvestl::fs
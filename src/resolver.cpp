@@ -1,15 +1,955 @@
 #include "bvestl/fs/resolver.hpp"
+#include "bvestl/fs/directory_iterator.hpp"
+#include "bvestl/fs/internal/case_fold.hpp"
+#include "bvestl/fs/internal/path_hash.hpp"
+#include "bvestl/fs/internal/string.hpp"
+#include <EASTL/algorithm.h>
 
+#if defined(EA_PLATFORM_LINUX)
+#	include <poll.h>
+#	include <sys/eventfd.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
 #include <ostream>
+#include <thread>
 
 namespace bvestl::fs {
+	namespace {
+		directory_handle open_root(path const& p, bvestl::polyalloc::allocator_handle const handle) {
+			std::error_code ec;
+			return directory_handle(p, ec, handle);
+		}
+
+		// Of the text as spelled, which is what the cache is keyed by
+		std::uint64_t key_hash(path_view const p) {
+			std::uint64_t const seed = (internal::PATH_HASH_OFFSET ^ static_cast<std::uint64_t>(p.type())) * internal::PATH_HASH_PRIME;
+			return internal::hash_component(seed, p.text());
+		}
+
+		// Agrees with path_view equality: separator runs and kinds don't matter
+		std::uint64_t component_hash(path_view const p) {
+			return internal::hash_components(p, (internal::PATH_HASH_OFFSET ^ (p.is_absolute() ? 1u : 0u)) * internal::PATH_HASH_PRIME);
+		}
+
+		// The part of \p full below its first \p skip components, viewing its text
+		path_view below(path const& full, size_t skip) {
+			path_view const view = full;
+			const char* const end = view.text().data() + view.text().size();
+			for (eastl::string_view const component : view) {
+				if (skip-- == 0)
+					return path_view(eastl::string_view(component.data(), static_cast<size_t>(end - component.data())), view.type());
+			}
+			return path_view(eastl::string_view(), view.type());
+		}
+
+		std::uint64_t now_ms() {
+			auto const now = std::chrono::steady_clock::now().time_since_epoch();
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+		}
+	} // namespace
+
+	/**
+	 * Open addressed table from the text of a relative path to what resolve()
+	 * returned for it. Guarded by a mutex; the watcher thread only ever bumps
+	 * the generation, and the next lookup drops everything when it moved.
+	 * Clearing also removes every watch, which the results no longer need.
+	 */
+	struct resolver::cache {
+		struct entry {
+			std::uint64_t hash;
+			internal::string key;
+			path result;
+			// Search path it was found under, resolved::npos if none
+			size_t root;
+			std::uint64_t stamp_ms;
+		};
+
+		cache(resolver_cache_options const& o, bvestl::polyalloc::allocator_handle const h)
+		    : options(o), handle(h), entries(h), slots(h), watches(h) {
+			slots.resize(64, 0);
+#if defined(EA_PLATFORM_LINUX)
+			if (options.watch) {
+				inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+				wake = eventfd(0, EFD_CLOEXEC);
+				if (inotify != -1 && wake != -1) {
+					watcher = std::thread([this] { watch_loop(); });
+				}
+				else {
+					close_descriptors();
+				}
+			}
+#endif
+		}
+
+		~cache() {
+#if defined(EA_PLATFORM_LINUX)
+			if (watcher.joinable()) {
+				std::uint64_t const one = 1;
+				ssize_t const written = ::write(wake, &one, sizeof(one));
+				(void) written;
+				watcher.join();
+			}
+			close_descriptors();
+#endif
+		}
+
+		// Whether results can be kept at all; without invalidation they must at least expire
+		bool usable() const { return watching() || !options.watch || options.ttl_ms != 0; }
+
+		bool watching() const {
+#if defined(EA_PLATFORM_LINUX)
+			return inotify != -1;
+#else
+			return false;
+#endif
+		}
+
+		// Slot holding \p key, or the empty one where it belongs
+		size_t find(std::uint64_t const hash, eastl::string_view const key) const {
+			size_t const mask = slots.size() - 1;
+			for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask) {
+				std::uint32_t const index = slots[i];
+				if (index == 0)
+					return i;
+				entry const& e = entries[index - 1];
+				if (e.hash == hash && eastl::string_view(e.key.data(), e.key.size()) == key)
+					return i;
+			}
+		}
+
+		void store(std::uint64_t const hash, eastl::string_view const key, path const& result, size_t const root, std::uint64_t const stamp) {
+			size_t slot = find(hash, key);
+			if (slots[slot] != 0) {
+				entry& e = entries[slots[slot] - 1];
+				e.result = result;
+				e.root = root;
+				e.stamp_ms = stamp;
+				return;
+			}
+			// Full: start over rather than evict, since the watches can't be told apart by entry
+			if (entries.size() >= options.max_entries) {
+				clear();
+				return;
+			}
+			entries.push_back(entry{hash, internal::string(key.data(), key.data() + key.size(), handle), result, root, stamp});
+			slots[slot] = static_cast<std::uint32_t>(entries.size());
+			if (entries.size() * 2 > slots.size())
+				rehash(slots.size() * 2);
+		}
+
+		void rehash(size_t const size) {
+			slots.assign(size, 0);
+			for (size_t i = 0; i < entries.size(); ++i) {
+				entry const& e = entries[i];
+				slots[find(e.hash, eastl::string_view(e.key.data(), e.key.size()))] = static_cast<std::uint32_t>(i + 1);
+			}
+		}
+
+		/**
+		 * Drops every result and watch. Bumping the generation keeps lookups in
+		 * flight, whose watches may just have been removed, from storing theirs.
+		 */
+		void clear() {
+			entries.clear();
+			slots.assign(slots.size(), 0);
+#if defined(EA_PLATFORM_LINUX)
+			remove_watches();
+#endif
+			cleared_generation = generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+		}
+
+		// Watches \p directory itself. False if it couldn't be.
+		bool watch_directory(internal::string const& directory) {
+#if defined(EA_PLATFORM_LINUX)
+			return inotify != -1 && add_watch(directory);
+#else
+			(void) directory;
+			return false;
+#endif
+		}
+
+		/**
+		 * Watches \p root and each directory below it that \p value goes through, down
+		 * to the deepest one that exists: whatever appears or disappears on the way
+		 * then shows up as an event. False if a watch couldn't be added.
+		 */
+		bool watch(path const& root, path const& value) {
+#if defined(EA_PLATFORM_LINUX)
+			if (inotify == -1)
+				return false;
+			internal::string directory = root.str(handle);
+			if (!add_watch(directory))
+				return false;
+			internal::string const relative = value.str(handle);
+			size_t start = 0;
+			for (size_t end = relative.find('/'); end != internal::string::npos; start = end + 1, end = relative.find('/', start)) {
+				if (end == start)
+					continue;
+				directory.push_back('/');
+				directory.append(relative.data() + start, relative.data() + end);
+				if (add_watch(directory.c_str()) == -1)
+					return errno == ENOENT || errno == ENOTDIR;
+			}
+			return true;
+#else
+			(void) root;
+			(void) value;
+			return false;
+#endif
+		}
+
+		resolver_cache_options options;
+		bvestl::polyalloc::allocator_handle handle;
+		std::mutex lock;
+		internal::vector<entry> entries;
+		// entries index + 1, 0 when empty; the size is a power of two
+		internal::vector<std::uint32_t> slots;
+		std::atomic<std::uint64_t> generation{0};
+		std::uint64_t cleared_generation = 0;
+		// Guards watches, which lookups add to without holding the lock above
+		std::mutex watch_lock;
+		// inotify watch descriptors, sorted
+		internal::vector<int> watches;
+
+#if defined(EA_PLATFORM_LINUX)
+		static const std::uint32_t WATCH_MASK =
+		    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+		bool add_watch(internal::string const& directory) { return add_watch(directory.c_str()) != -1; }
+
+		// Watches \p directory and records it. -1 with errno set if it couldn't be watched or the table is full.
+		int add_watch(const char* const directory) {
+			int const descriptor = inotify_add_watch(inotify, directory, WATCH_MASK);
+			if (descriptor == -1)
+				return -1;
+			std::lock_guard<std::mutex> lg(watch_lock);
+			auto const it = eastl::lower_bound(watches.begin(), watches.end(), descriptor);
+			if (it != watches.end() && *it == descriptor)
+				return descriptor;
+			if (watches.size() >= options.max_watches) {
+				// Give it back, and have the next lookup start over as if something changed
+				inotify_rm_watch(inotify, descriptor);
+				generation.fetch_add(1, std::memory_order_release);
+				errno = ENOSPC;
+				return -1;
+			}
+			watches.insert(it, descriptor);
+			return descriptor;
+		}
+
+		void remove_watches() {
+			std::lock_guard<std::mutex> lg(watch_lock);
+			for (int const descriptor : watches)
+				inotify_rm_watch(inotify, descriptor);
+			watches.clear();
+		}
+
+		void watch_loop() {
+			alignas(inotify_event) char buffer[4096];
+			pollfd fds[2] = {{inotify, POLLIN, 0}, {wake, POLLIN, 0}};
+			for (;;) {
+				if (poll(fds, 2, -1) < 0) {
+					if (errno == EINTR)
+						continue;
+					return;
+				}
+				if (fds[1].revents != 0)
+					return;
+				bool changed = false;
+				ssize_t length;
+				while ((length = ::read(inotify, buffer, sizeof(buffer))) > 0) {
+					for (ssize_t at = 0; at < length;) {
+						auto const* const event = reinterpret_cast<inotify_event const*>(buffer + at);
+						// Removing a watch reports IN_IGNORED, which isn't a change
+						if ((event->mask & IN_IGNORED) == 0)
+							changed = true;
+						at += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+					}
+				}
+				if (changed)
+					generation.fetch_add(1, std::memory_order_release);
+			}
+		}
+
+		void close_descriptors() {
+			if (inotify != -1)
+				::close(inotify);
+			if (wake != -1)
+				::close(wake);
+			inotify = -1;
+			wake = -1;
+		}
+
+		int inotify = -1;
+		int wake = -1;
+		std::thread watcher;
+#endif
+	};
+
+	/**
+	 * Listings of the directories case-insensitive lookups went through, keyed
+	 * by search path and the directory's spelling on disk below it. Each one is
+	 * an open addressed table from the folded hash of a name to its entry.
+	 * Guarded by a mutex, which isn't held while a directory is being listed.
+	 */
+	struct resolver::folded {
+		struct name {
+			std::uint64_t hash;
+			std::uint32_t offset;
+			std::uint32_t length;
+			file_type type;
+		};
+
+		struct listing {
+			explicit listing(bvestl::polyalloc::allocator_handle const h) : key(h), text(h), names(h), slots(h) {}
+
+			eastl::string_view spelling(name const& n) const { return eastl::string_view(text.data() + n.offset, n.length); }
+
+			// Entry named \p component ignoring case. One spelled exactly the same wins, then the lowest spelling.
+			const name* find(eastl::string_view const component) const {
+				if (names.empty())
+					return nullptr;
+				std::uint64_t const h = internal::folded_hash(component);
+				size_t const mask = slots.size() - 1;
+				const name* match = nullptr;
+				for (size_t i = static_cast<size_t>(h) & mask; slots[i] != 0; i = (i + 1) & mask) {
+					name const& n = names[slots[i] - 1];
+					if (n.hash != h)
+						continue;
+					eastl::string_view const spelled = spelling(n);
+					if (spelled == component)
+						return &n;
+					if (match == nullptr && internal::folded_equal(spelled, component))
+						match = &n;
+				}
+				return match;
+			}
+
+			void add(eastl::string_view const spelled, file_type const type) {
+				names.push_back(name{internal::folded_hash(spelled), static_cast<std::uint32_t>(text.size()), static_cast<std::uint32_t>(spelled.size()), type});
+				text.append(spelled.data(), spelled.data() + spelled.size());
+			}
+
+			// Names are inserted in order, so among equal hashes the probe meets the lowest spelling first
+			void build() {
+				eastl::sort(names.begin(), names.end(), [this](name const& a, name const& b) { return spelling(a) < spelling(b); });
+				size_t size = 16;
+				while (size < names.size() * 2)
+					size *= 2;
+				slots.assign(size, 0);
+				for (size_t n = 0; n < names.size(); ++n) {
+					size_t i = static_cast<size_t>(names[n].hash) & (size - 1);
+					while (slots[i] != 0)
+						i = (i + 1) & (size - 1);
+					slots[i] = static_cast<std::uint32_t>(n + 1);
+				}
+			}
+
+			std::uint64_t hash = 0;
+			size_t root = 0;
+			// Directory relative to the search path as spelled on disk, empty for the search path itself
+			internal::string key;
+			// Names back to back
+			internal::string text;
+			internal::vector<name> names;
+			// names index + 1, 0 when empty; the size is a power of two
+			internal::vector<std::uint32_t> slots;
+		};
+
+		explicit folded(bvestl::polyalloc::allocator_handle const h) : listings(h), slots(h) { slots.resize(64, 0); }
+
+		static std::uint64_t key_hash(size_t const root, eastl::string_view const key) {
+			return internal::hash_component((internal::PATH_HASH_OFFSET ^ root) * internal::PATH_HASH_PRIME, key);
+		}
+
+		// Slot holding the listing of \p key, or the empty one where it belongs
+		size_t find(std::uint64_t const hash, size_t const root, eastl::string_view const key) const {
+			size_t const mask = slots.size() - 1;
+			for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask) {
+				std::uint32_t const index = slots[i];
+				if (index == 0)
+					return i;
+				listing const& l = listings[index - 1];
+				if (l.hash == hash && l.root == root && eastl::string_view(l.key.data(), l.key.size()) == key)
+					return i;
+			}
+		}
+
+		void store(listing&& l) {
+			size_t const slot = find(l.hash, l.root, eastl::string_view(l.key.data(), l.key.size()));
+			if (slots[slot] != 0)
+				return;
+			listings.push_back(std::move(l));
+			slots[slot] = static_cast<std::uint32_t>(listings.size());
+			if (listings.size() * 2 > slots.size()) {
+				slots.assign(slots.size() * 2, 0);
+				for (size_t i = 0; i < listings.size(); ++i) {
+					listing const& e = listings[i];
+					slots[find(e.hash, e.root, eastl::string_view(e.key.data(), e.key.size()))] = static_cast<std::uint32_t>(i + 1);
+				}
+			}
+		}
+
+		void clear() {
+			listings.clear();
+			slots.assign(slots.size(), 0);
+			++generation;
+		}
+
+		std::mutex lock;
+		internal::vector<listing> listings;
+		// listings index + 1, 0 when empty; the size is a power of two
+		internal::vector<std::uint32_t> slots;
+		// Bumped by clear(), so a listing made meanwhile isn't stored
+		std::uint64_t generation = 0;
+		// Last generation of the cache's watcher that was seen; listings are dropped when it moves
+		std::uint64_t watched_generation = 0;
+	};
+
+	resolver::resolver(bvestl::polyalloc::allocator_handle const handle) : m_paths(handle), m_roots(handle), m_index(handle) {
+		append(cwd(handle));
+	}
+
+	resolver::resolver(resolver const& other)
+	    : m_paths(other.m_paths), m_roots(other.m_paths.get_allocator()), m_index(other.m_paths.get_allocator()) {
+		open_roots(other.m_roots);
+		if (other.m_cache != nullptr)
+			enable_cache(other.m_cache->options);
+		set_case_sensitivity(other.sensitivity());
+	}
+
+	resolver::resolver(resolver&& other) noexcept
+	    : m_paths(std::move(other.m_paths)),
+	      m_roots(std::move(other.m_roots)),
+	      m_cache(other.m_cache),
+	      m_folded(other.m_folded),
+	      m_index(std::move(other.m_index)) {
+		other.m_cache = nullptr;
+		other.m_folded = nullptr;
+	}
+
+	resolver& resolver::operator=(resolver const& other) {
+		if (this != &other) {
+			m_paths = other.m_paths;
+			m_index = directory_index(m_paths.get_allocator());
+			open_roots(other.m_roots);
+			invalidate();
+			if (other.m_cache != nullptr)
+				enable_cache(other.m_cache->options);
+			else
+				disable_cache();
+			set_case_sensitivity(other.sensitivity());
+		}
+		return *this;
+	}
+
+	resolver& resolver::operator=(resolver&& other) noexcept {
+		if (this != &other) {
+			disable_cache();
+			set_case_sensitivity(case_sensitivity::sensitive);
+			m_paths = std::move(other.m_paths);
+			m_roots = std::move(other.m_roots);
+			m_cache = other.m_cache;
+			other.m_cache = nullptr;
+			m_folded = other.m_folded;
+			other.m_folded = nullptr;
+			m_index = std::move(other.m_index);
+		}
+		return *this;
+	}
+
+	resolver::~resolver() {
+		set_case_sensitivity(case_sensitivity::sensitive);
+		disable_cache();
+	}
+
+	void resolver::erase(iterator const it) {
+		m_roots.erase(m_roots.begin() + (it - m_paths.begin()));
+		m_paths.erase(it);
+		drop_index();
+		invalidate();
+	}
+
+	void resolver::prepend(path const& p) {
+		auto const handle = m_paths.get_allocator();
+		m_paths.insert(m_paths.begin(), p);
+		m_roots.insert(m_roots.begin(), root{p, open_root(p, handle)});
+		drop_index();
+		invalidate();
+	}
+
+	void resolver::append(path const& p) {
+		auto const handle = m_paths.get_allocator();
+		m_paths.push_back(p);
+		m_roots.push_back(root{p, open_root(p, handle)});
+		drop_index();
+		invalidate();
+	}
+
+	void resolver::prepend(mapped_pack const& pack) {
+		auto const handle = m_paths.get_allocator();
+		m_paths.insert(m_paths.begin(), pack.file());
+		m_roots.insert(m_roots.begin(), root{pack.file(), directory_handle(handle), &pack});
+		drop_index();
+		invalidate();
+	}
+
+	void resolver::append(mapped_pack const& pack) {
+		auto const handle = m_paths.get_allocator();
+		m_paths.push_back(pack.file());
+		m_roots.push_back(root{pack.file(), directory_handle(handle), &pack});
+		drop_index();
+		invalidate();
+	}
+
+	void resolver::open_roots(internal::vector<root> const& previous) {
+		auto const handle = m_paths.get_allocator();
+		internal::vector<root> roots(handle);
+		roots.reserve(m_paths.size());
+		for (size_t i = 0; i < m_paths.size(); ++i) {
+			const mapped_pack* const pack = i < previous.size() ? previous[i].pack : nullptr;
+			if (pack != nullptr)
+				roots.push_back(root{m_paths[i], directory_handle(handle), pack});
+			else
+				roots.push_back(root{m_paths[i], open_root(m_paths[i], handle)});
+		}
+		m_roots = std::move(roots);
+	}
+
+	void resolver::reopen_roots() {
+		open_roots(m_roots);
+		invalidate();
+	}
+
+	void resolver::enable_cache(resolver_cache_options const& options) {
+		disable_cache();
+		auto handle = m_paths.get_allocator();
+		m_cache = new (handle.allocate(sizeof(cache), alignof(cache), 0)) cache(options, handle);
+		// Listings made so far weren't watched
+		invalidate();
+	}
+
+	void resolver::disable_cache() {
+		if (m_cache == nullptr)
+			return;
+		auto handle = m_paths.get_allocator();
+		m_cache->~cache();
+		handle.deallocate(m_cache, sizeof(cache));
+		m_cache = nullptr;
+	}
+
+	void resolver::invalidate() const {
+		if (m_folded != nullptr) {
+			std::lock_guard<std::mutex> lg(m_folded->lock);
+			m_folded->clear();
+		}
+		if (m_cache == nullptr)
+			return;
+		std::lock_guard<std::mutex> lg(m_cache->lock);
+		m_cache->clear();
+	}
+
+	void resolver::set_case_sensitivity(case_sensitivity const mode) {
+		if (mode == sensitivity())
+			return;
+		auto handle = m_paths.get_allocator();
+		if (mode == case_sensitivity::insensitive) {
+			m_folded = new (handle.allocate(sizeof(folded), alignof(folded), 0)) folded(handle);
+		}
+		else {
+			m_folded->~folded();
+			handle.deallocate(m_folded, sizeof(folded));
+			m_folded = nullptr;
+		}
+		// Cached results were found under the other mode
+		invalidate();
+	}
+
+	bool resolver::build_index(std::error_code& ec, index_options const& options) {
+		directory_index index = build_directory_index(m_paths.data(), m_paths.size(), ec, options, m_paths.get_allocator());
+		if (ec)
+			return false;
+		m_index = std::move(index);
+		return true;
+	}
+
+	bool resolver::use_index(directory_index&& index) {
+		if (index.root_count() != m_paths.size())
+			return false;
+		for (size_t i = 0; i < m_paths.size(); ++i) {
+			if (index.root(i) != path_view(m_paths[i]).text())
+				return false;
+		}
+		m_index = std::move(index);
+		return true;
+	}
+
+	void resolver::drop_index() {
+		if (!m_index.empty())
+			m_index = directory_index(m_paths.get_allocator());
+	}
+
+	bool resolver::exists_in(size_t const index, path const& value) const {
+		root const& r = m_roots[index];
+		if (r.pack != nullptr)
+			return !value.is_absolute() && r.pack->exists(value);
+		// Only the components of value are looked up, below the already open root
+		if (r.directory.is_open() && r.opened == m_paths[index] && !value.is_absolute())
+			return r.directory.exists(value);
+		return (m_paths[index] / value).file_exists();
+	}
+
+	bool resolver::correct_in(size_t const index, path const& value, path& corrected) const {
+		path_view const view = value;
+		if (view.empty())
+			return false;
+		auto const handle = m_paths.get_allocator();
+		// The spelling found is joined onto the search path, so it is given that path's type
+		path_type const type = path_view(m_paths[index]).type();
+		folded& f = *m_folded;
+		bool const watching = m_cache != nullptr && m_cache->watching();
+		if (watching) {
+			std::uint64_t const generation = m_cache->generation.load(std::memory_order_acquire);
+			std::lock_guard<std::mutex> lg(f.lock);
+			if (generation != f.watched_generation) {
+				f.clear();
+				f.watched_generation = generation;
+			}
+		}
+
+		// Spelling on disk so far, components separated by '/'
+		internal::string key(handle);
+		// Moves key into the entry of listing that matches component; false if there is none or it can't be gone through
+		auto const descend = [&key](folded::listing const& l, eastl::string_view const component, bool const last) {
+			const folded::name* const match = l.find(component);
+			if (match == nullptr)
+				return false;
+			if (!last && match->type != file_type::directory && match->type != file_type::symlink && match->type != file_type::unknown)
+				return false;
+			eastl::string_view const spelled = l.spelling(*match);
+			if (!key.empty())
+				key.push_back('/');
+			key.append(spelled.data(), spelled.data() + spelled.size());
+			return true;
+		};
+
+		for (auto it = view.begin(); it != view.end();) {
+			eastl::string_view const component = *it;
+			bool const last = ++it == view.end();
+			if (component == ".")
+				continue;
+			if (component == "..") {
+				if (key.empty())
+					return false;
+				size_t const slash = key.rfind('/');
+				key.resize(slash == internal::string::npos ? 0 : slash);
+				continue;
+			}
+
+			eastl::string_view const directory_key(key.data(), key.size());
+			std::uint64_t const hash = folded::key_hash(index, directory_key);
+			std::uint64_t generation;
+			{
+				std::lock_guard<std::mutex> lg(f.lock);
+				std::uint32_t const slot = f.slots[f.find(hash, index, directory_key)];
+				if (slot != 0) {
+					if (!descend(f.listings[slot - 1], component, last))
+						return false;
+					continue;
+				}
+				generation = f.generation;
+			}
+
+			// First visit of this directory: watch it before listing, so a change racing the listing still drops it
+			root const& r = m_roots[index];
+			bool keep = true;
+			if (watching && r.pack == nullptr) {
+				internal::string directory = m_paths[index].str(handle);
+				if (!key.empty()) {
+					directory.push_back('/');
+					directory.append(key.data(), key.data() + key.size());
+				}
+				keep = m_cache->watch_directory(directory);
+			}
+
+			// Listed below the open search path when there is one; a directory that can't be listed is empty
+			folded::listing fresh(handle);
+			fresh.hash = hash;
+			fresh.root = index;
+			fresh.key = key;
+			if (r.pack != nullptr) {
+				path_view const relative(directory_key, path_type::posix_path);
+				// Entries below a pack directory come in name order, so those below the same child are next to each other
+				eastl::pair<size_t, size_t> const range = r.pack->entries_below(relative);
+				eastl::string_view previous;
+				for (size_t e = range.first; e < range.second; ++e) {
+					eastl::string_view name = r.pack->entry(e).name;
+					name.remove_prefix(key.empty() ? 0 : key.size() + 1);
+					size_t const slash = name.find('/');
+					name = name.substr(0, slash);
+					if (e != range.first && name == previous)
+						continue;
+					previous = name;
+					fresh.add(name, slash == eastl::string_view::npos ? file_type::regular : file_type::directory);
+				}
+			}
+			else {
+				path_view const relative(directory_key, type);
+				std::error_code ec;
+				directory_handle subdirectory(handle);
+				const directory_handle* directory = &r.directory;
+				if (!r.directory.is_open() || r.opened != m_paths[index])
+					subdirectory = directory_handle(key.empty() ? m_paths[index] : m_paths[index] / path(relative, handle), ec, handle);
+				else if (!key.empty())
+					subdirectory = r.directory.open_directory(relative, ec);
+				if (subdirectory.is_open())
+					directory = &subdirectory;
+				if (!ec) {
+					for (directory_iterator entries(*directory, ec, directory_options(), handle); entries.next();)
+						fresh.add(entries.entry().name(), entries.entry().type());
+				}
+			}
+			fresh.build();
+
+			bool const found = descend(fresh, component, last);
+			if (keep) {
+				std::lock_guard<std::mutex> lg(f.lock);
+				if (f.generation == generation)
+					f.store(std::move(fresh));
+			}
+			if (!found)
+				return false;
+		}
+		// Nothing left but the search path itself, which the exact search already covers
+		if (key.empty())
+			return false;
+		corrected.set(key, type, handle);
+		return true;
+	}
+
+	size_t resolver::lookup_folded(path const& value, path& found) const {
+		if (value.is_absolute())
+			return resolved::npos;
+		path corrected(m_paths.get_allocator());
+		for (size_t i = 0; i < m_paths.size(); ++i) {
+			if (correct_in(i, value, corrected)) {
+				found = m_paths[i] / corrected;
+				return i;
+			}
+		}
+		return resolved::npos;
+	}
+
+	size_t resolver::lookup(path const& value, path& found) const {
+		for (size_t i = 0; i < m_paths.size(); ++i) {
+			if (exists_in(i, value)) {
+				found = m_paths[i] / value;
+				return i;
+			}
+		}
+		// Names that exist as spelled never pay for the case-insensitive search
+		return m_folded != nullptr ? lookup_folded(value, found) : resolved::npos;
+	}
+
+	size_t resolver::find_indexed(path const& value) const {
+		size_t const indexed = m_index.find(value);
+		// Packs provide nothing to the index, but answer without a system call themselves
+		size_t const end = indexed != directory_index::npos ? indexed : m_paths.size();
+		for (size_t i = 0; i < end; ++i) {
+			if (m_roots[i].pack != nullptr && m_roots[i].pack->exists(value))
+				return i;
+		}
+		return indexed;
+	}
+
 	path resolver::resolve(path const& value) const {
-		for (const auto& m_path : m_paths) {
-			path combined = m_path / value;
-			if (combined.file_exists())
-				return combined;
+		path found(m_paths.get_allocator());
+		return locate(value, found) != resolved::npos ? found : value;
+	}
+
+	size_t resolver::locate(path const& value, path& found) const {
+		if (!m_index.empty() && directory_index::indexable(value)) {
+			size_t const index = find_indexed(value);
+			if (index != directory_index::npos) {
+				found = m_paths[index] / value;
+				return index;
+			}
+			return m_folded != nullptr ? lookup_folded(value, found) : resolved::npos;
+		}
+		if (m_cache == nullptr || value.is_absolute() || !m_cache->usable())
+			return lookup(value, found);
+
+		cache& c = *m_cache;
+		path_view const view = value;
+		std::uint64_t const hash = key_hash(view);
+		std::uint64_t const now = c.options.ttl_ms != 0 ? now_ms() : 0;
+		std::uint64_t generation;
+		{
+			std::lock_guard<std::mutex> lg(c.lock);
+			if (c.generation.load(std::memory_order_acquire) != c.cleared_generation)
+				c.clear();
+			generation = c.cleared_generation;
+			std::uint32_t const index = c.slots[c.find(hash, view.text())];
+			if (index != 0) {
+				cache::entry const& e = c.entries[index - 1];
+				if (c.options.ttl_ms == 0 || now - e.stamp_ms < c.options.ttl_ms) {
+					if (e.root != resolved::npos)
+						found = e.result;
+					return e.root;
+				}
+			}
+		}
+
+		// Watch before looking, so a change racing the lookup still drops what gets stored. Packs don't change.
+		bool cacheable = true;
+		if (c.watching()) {
+			for (size_t i = 0; i < m_paths.size(); ++i) {
+				if (m_roots[i].pack == nullptr)
+					cacheable = c.watch(m_paths[i], value) && cacheable;
+			}
+		}
+
+		size_t const index = lookup(value, found);
+		if (cacheable) {
+			std::lock_guard<std::mutex> lg(c.lock);
+			if (c.generation.load(std::memory_order_acquire) == generation)
+				c.store(hash, view.text(), index != resolved::npos ? found : path(m_paths.get_allocator()), index, now);
+		}
+		return index;
+	}
+
+	file_contents resolver::open(path const& value, std::error_code& ec) const {
+		ec.clear();
+		auto const handle = m_paths.get_allocator();
+		if (value.is_absolute()) {
+			mapped_file file(value, ec, map_options(), handle);
+			return ec ? file_contents(handle) : file_contents(std::move(file), handle);
+		}
+
+		path found(handle);
+		size_t const index = locate(value, found);
+		if (index == resolved::npos) {
+			ec = std::make_error_code(std::errc::no_such_file_or_directory);
+			return file_contents(handle);
+		}
+		mapped_pack const* const pack = m_roots[index].pack;
+		if (pack == nullptr) {
+			mapped_file file(found, ec, map_options(), handle);
+			return ec ? file_contents(handle) : file_contents(std::move(file), handle);
+		}
+
+		// The name as found, case corrected, below the pack
+		size_t const entry = pack->find(below(found, m_paths[index].length()));
+		if (entry == mapped_pack::npos) {
+			ec = std::make_error_code(std::errc::is_a_directory);
+			return file_contents(handle);
+		}
+		return pack->open(entry, ec);
+	}
+
+	bool resolver::resolve_many(eastl::span<const path> const values, eastl::span<resolved> const out, resolve_options const& options) const {
+		if (values.size() != out.size())
+			return false;
+		auto const handle = m_paths.get_allocator();
+		size_t const count = values.size();
+
+		// Each distinct name once: unique[i] is the first occurrence of values[i]
+		internal::vector<size_t> unique(count, 0, handle);
+		internal::vector<size_t> names(handle);
+		{
+			size_t slot_count = 16;
+			while (slot_count < count * 2)
+				slot_count *= 2;
+			internal::vector<size_t> slots(slot_count, 0, handle);
+			for (size_t i = 0; i < count; ++i) {
+				path_view const view = values[i];
+				size_t slot = static_cast<size_t>(component_hash(view)) & (slot_count - 1);
+				for (; slots[slot] != 0; slot = (slot + 1) & (slot_count - 1)) {
+					path_view const other = values[slots[slot] - 1];
+					if (other == view && other.is_absolute() == view.is_absolute())
+						break;
+				}
+				if (slots[slot] == 0) {
+					slots[slot] = i + 1;
+					names.push_back(i);
+				}
+				unique[i] = slots[slot] - 1;
+			}
+		}
+
+		// Root each first occurrence was found under
+		internal::vector<size_t> found(count, resolved::npos, handle);
+		internal::vector<size_t> pending(handle);
+		pending.reserve(names.size());
+		for (size_t const i : names) {
+			// No search path can be joined with an absolute name
+			if (values[i].is_absolute())
+				continue;
+			if (!m_index.empty() && directory_index::indexable(values[i])) {
+				found[i] = find_indexed(values[i]);
+				if (found[i] == resolved::npos && m_folded != nullptr)
+					pending.push_back(i);
+			}
+			else {
+				pending.push_back(i);
+			}
+		}
+		// Spelling on disk of the names found ignoring case
+		internal::vector<path> corrected(m_folded != nullptr ? count : 0, path(handle), handle);
+
+		// Chunks of names go to the workers, and within a chunk one search path is tried for all names before the next
+		size_t const CHUNK = 32;
+		size_t const chunks = (pending.size() + CHUNK - 1) / CHUNK;
+		std::atomic<size_t> next{0};
+		auto const work = [&] {
+			for (size_t c = next.fetch_add(1, std::memory_order_relaxed); c < chunks; c = next.fetch_add(1, std::memory_order_relaxed)) {
+				size_t const first = c * CHUNK;
+				size_t const last = eastl::min(first + CHUNK, pending.size());
+				size_t remaining = last - first;
+				for (size_t r = 0; r < m_paths.size() && remaining != 0; ++r) {
+					for (size_t p = first; p < last; ++p) {
+						size_t const i = pending[p];
+						if (found[i] == resolved::npos && exists_in(r, values[i])) {
+							found[i] = r;
+							--remaining;
+						}
+					}
+				}
+				// What no search path has as spelled, ignoring case, again one search path at a time
+				for (size_t r = 0; m_folded != nullptr && r < m_paths.size() && remaining != 0; ++r) {
+					for (size_t p = first; p < last; ++p) {
+						size_t const i = pending[p];
+						if (found[i] == resolved::npos && correct_in(r, values[i], corrected[i])) {
+							found[i] = r;
+							--remaining;
+						}
+					}
+				}
+			}
+		};
+		size_t workers = options.threads != 0 ? options.threads : eastl::max<size_t>(1, std::thread::hardware_concurrency());
+		workers = eastl::min(workers, eastl::max<size_t>(chunks, 1));
+		internal::vector<std::thread> threads(handle);
+		for (size_t t = 1; t < workers; ++t)
+			threads.push_back(std::thread(work));
+		work();
+		for (std::thread& t : threads)
+			t.join();
+
+		for (size_t i = 0; i < count; ++i) {
+			size_t const root = found[unique[i]];
+			bool const was_corrected = !corrected.empty() && !corrected[unique[i]].empty();
+			out[i].root = root;
+			out[i].result = root != resolved::npos ? m_paths[root] / (was_corrected ? corrected[unique[i]] : values[i]) : values[i];
 		}
-		return value;
+		return true;
 	}
 
 	std::ostream& operator<<(std::ostream& os, resolver const& r) {
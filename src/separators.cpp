@@ -0,0 +1,61 @@
+#include "bvestl/fs/internal/separators.hpp"
+#include <EABase/config/eaplatform.h>
+#include <cstdint>
+
+#if defined(EA_PROCESSOR_X86_64)
+#	include <emmintrin.h>
+#elif defined(EA_PROCESSOR_ARM64)
+#	include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+namespace bvestl::fs::internal {
+#if defined(EA_PROCESSOR_X86_64) || defined(EA_PROCESSOR_ARM64)
+	namespace {
+		unsigned lowest_bit(std::uint64_t const mask) {
+#	if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, mask);
+			return static_cast<unsigned>(index);
+#	else
+			return static_cast<unsigned>(__builtin_ctzll(mask));
+#	endif
+		}
+	} // namespace
+#endif
+
+	const char* find_separator(const char* first, const char* const last, bool const windows) {
+#if defined(EA_PROCESSOR_X86_64)
+		__m128i const slash = _mm_set1_epi8('/');
+		// Without windows, looking for '/' twice keeps the loop free of branches
+		__m128i const other = _mm_set1_epi8(windows ? '\\' : '/');
+		for (; last - first >= 16; first += 16) {
+			__m128i const chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+			__m128i const hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, slash), _mm_cmpeq_epi8(chunk, other));
+			auto const mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+			if (mask != 0)
+				return first + lowest_bit(mask);
+		}
+#elif defined(EA_PROCESSOR_ARM64)
+		uint8x16_t const slash = vdupq_n_u8('/');
+		uint8x16_t const other = vdupq_n_u8(windows ? '\\' : '/');
+		for (; last - first >= 16; first += 16) {
+			uint8x16_t const chunk = vld1q_u8(reinterpret_cast<const std::uint8_t*>(first));
+			uint8x16_t const hits = vorrq_u8(vceqq_u8(chunk, slash), vceqq_u8(chunk, other));
+			// NEON has no movemask; narrowing each 16 bit lane by 4 leaves 4 bits per byte
+			uint8x8_t const narrowed = vshrn_n_u16(vreinterpretq_u16_u8(hits), 4);
+			std::uint64_t const mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+			if (mask != 0)
+				return first + lowest_bit(mask) / 4;
+		}
+#endif
+		for (; first != last; ++first) {
+			if (*first == '/' || (windows && *first == '\\'))
+				return first;
+		}
+		return last;
+	}
+} // namespace bvestl::fs::internal
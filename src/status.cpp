@@ -0,0 +1,230 @@
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/status_at.hpp"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <cerrno>
+#	if defined(STATX_BASIC_STATS)
+#		include <sys/sysmacros.h>
+#	endif
+#endif
+
+#include <atomic>
+
+namespace bvestl::fs {
+	namespace {
+#if !defined(EA_PLATFORM_WINDOWS)
+		file_status failure(int const error, std::error_code& ec) {
+			file_status result;
+			if (error == ENOENT || error == ENOTDIR) {
+				result.type = file_type::not_found;
+				result.valid = status_mask::type;
+			}
+			else {
+				ec = std::error_code(error, std::generic_category());
+			}
+			return result;
+		}
+
+		file_type type_from_mode(mode_t const mode) {
+			switch (mode & S_IFMT) {
+				case S_IFREG:
+					return file_type::regular;
+				case S_IFDIR:
+					return file_type::directory;
+				case S_IFLNK:
+					return file_type::symlink;
+				case S_IFBLK:
+					return file_type::block;
+				case S_IFCHR:
+					return file_type::character;
+				case S_IFIFO:
+					return file_type::fifo;
+				case S_IFSOCK:
+					return file_type::socket;
+				default:
+					return file_type::unknown;
+			}
+		}
+
+		file_status from_stat(struct stat const& sb) {
+			file_status result;
+			result.type = type_from_mode(sb.st_mode);
+			result.permissions = static_cast<std::uint32_t>(sb.st_mode & 07777);
+			result.size = static_cast<std::uint64_t>(sb.st_size);
+#	if defined(EA_PLATFORM_APPLE)
+			result.mtime_ns = static_cast<std::int64_t>(sb.st_mtimespec.tv_sec) * 1000000000 + sb.st_mtimespec.tv_nsec;
+#	else
+			result.mtime_ns = static_cast<std::int64_t>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
+#	endif
+			result.inode = static_cast<std::uint64_t>(sb.st_ino);
+			result.device = static_cast<std::uint64_t>(sb.st_dev);
+			result.valid = status_mask::all;
+			return result;
+		}
+
+#	if defined(STATX_BASIC_STATS)
+		// Cleared the first time the kernel (or a seccomp filter) rejects statx
+		std::atomic<bool> statx_supported{true};
+
+		unsigned int to_statx_mask(status_mask const mask) {
+			unsigned int result = 0;
+			if (any(mask & status_mask::type))
+				result |= STATX_TYPE;
+			if (any(mask & status_mask::permissions))
+				result |= STATX_MODE;
+			if (any(mask & status_mask::size))
+				result |= STATX_SIZE;
+			if (any(mask & status_mask::mtime))
+				result |= STATX_MTIME;
+			if (any(mask & status_mask::inode))
+				result |= STATX_INO;
+			return result;
+		}
+
+		file_status from_statx(struct statx const& sx, status_mask const mask) {
+			file_status result;
+			if (any(mask & status_mask::type) && (sx.stx_mask & STATX_TYPE)) {
+				result.type = type_from_mode(sx.stx_mode);
+				result.valid = result.valid | status_mask::type;
+			}
+			if (any(mask & status_mask::permissions) && (sx.stx_mask & STATX_MODE)) {
+				result.permissions = sx.stx_mode & 07777u;
+				result.valid = result.valid | status_mask::permissions;
+			}
+			if (any(mask & status_mask::size) && (sx.stx_mask & STATX_SIZE)) {
+				result.size = sx.stx_size;
+				result.valid = result.valid | status_mask::size;
+			}
+			if (any(mask & status_mask::mtime) && (sx.stx_mask & STATX_MTIME)) {
+				result.mtime_ns = static_cast<std::int64_t>(sx.stx_mtime.tv_sec) * 1000000000 + sx.stx_mtime.tv_nsec;
+				result.valid = result.valid | status_mask::mtime;
+			}
+			if (any(mask & status_mask::inode) && (sx.stx_mask & STATX_INO)) {
+				result.inode = sx.stx_ino;
+				// Encoded as stat() would, so both can be compared with st_dev
+				result.device = static_cast<std::uint64_t>(makedev(sx.stx_dev_major, sx.stx_dev_minor));
+				result.valid = result.valid | status_mask::inode;
+			}
+			return result;
+		}
+#	endif
+#else
+		const std::int64_t WINDOWS_TO_UNIX_EPOCH = 116444736000000000LL;
+
+		std::int64_t to_unix_ns(FILETIME const& time) {
+			std::int64_t const ticks = (static_cast<std::int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+			return (ticks - WINDOWS_TO_UNIX_EPOCH) * 100;
+		}
+
+		file_status query(const wchar_t* const native, bool const follow, status_mask const mask, std::error_code& ec) {
+			ec.clear();
+			file_status result;
+
+			WIN32_FILE_ATTRIBUTE_DATA data;
+			BVESTL_FS_OP_BEGIN(stat);
+			BOOL const found = GetFileAttributesExW(native, GetFileExInfoStandard, &data);
+			BVESTL_FS_OP_END(stat, !found);
+			if (!found) {
+				DWORD const error = GetLastError();
+				if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) {
+					result.type = file_type::not_found;
+					result.valid = status_mask::type;
+				}
+				else {
+					ec = std::error_code(static_cast<int>(error), std::system_category());
+				}
+				return result;
+			}
+
+			bool const reparse = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+			// The attributes describe the link itself; going through a handle resolves it
+			if ((follow && reparse) || any(mask & status_mask::inode)) {
+				DWORD const flags = FILE_FLAG_BACKUP_SEMANTICS | (follow ? 0 : FILE_FLAG_OPEN_REPARSE_POINT);
+				HANDLE const file = CreateFileW(native, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, flags,
+				                                nullptr);
+				if (file == INVALID_HANDLE_VALUE) {
+					ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+					return result;
+				}
+				BY_HANDLE_FILE_INFORMATION info;
+				BOOL const ok = GetFileInformationByHandle(file, &info);
+				CloseHandle(file);
+				if (!ok) {
+					ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+					return result;
+				}
+				data.dwFileAttributes = info.dwFileAttributes;
+				data.ftLastWriteTime = info.ftLastWriteTime;
+				data.nFileSizeHigh = info.nFileSizeHigh;
+				data.nFileSizeLow = info.nFileSizeLow;
+				result.inode = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+				result.device = info.dwVolumeSerialNumber;
+			}
+
+			if (!follow && reparse)
+				result.type = file_type::symlink;
+			else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				result.type = file_type::directory;
+			else
+				result.type = file_type::regular;
+			result.permissions = (data.dwFileAttributes & FILE_ATTRIBUTE_READONLY) ? 0555 : 0777;
+			result.size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+			result.mtime_ns = to_unix_ns(data.ftLastWriteTime);
+			result.valid = mask;
+			return result;
+		}
+#endif
+	} // namespace
+
+#if !defined(EA_PLATFORM_WINDOWS)
+	file_status internal::status_at(int const dirfd, const char* const name, bool const follow, status_mask const mask, std::error_code& ec) {
+		ec.clear();
+		int const flags = follow ? 0 : AT_SYMLINK_NOFOLLOW;
+#	if defined(STATX_BASIC_STATS)
+		if (statx_supported.load(std::memory_order_relaxed)) {
+			struct statx sx {};
+			BVESTL_FS_OP_BEGIN(stat);
+			int const result = statx(dirfd, name, flags | AT_STATX_SYNC_AS_STAT, to_statx_mask(mask), &sx);
+			BVESTL_FS_OP_END(stat, result != 0);
+			if (result == 0)
+				return from_statx(sx, mask);
+			if (errno != ENOSYS && errno != EPERM)
+				return failure(errno, ec);
+			statx_supported.store(false, std::memory_order_relaxed);
+		}
+#	endif
+		struct stat sb {};
+		BVESTL_FS_OP_BEGIN(stat);
+		int const result = fstatat(dirfd, name, &sb, flags);
+		BVESTL_FS_OP_END(stat, result != 0);
+		if (result != 0)
+			return failure(errno, ec);
+		return from_stat(sb);
+	}
+#endif
+
+	file_status status(path_view const p, std::error_code& ec, status_mask const mask, bvestl::polyalloc::allocator_handle const handle) {
+		internal::native_path const native(p, handle);
+#if defined(EA_PLATFORM_WINDOWS)
+		return query(native.c_str(), true, mask, ec);
+#else
+		return internal::status_at(AT_FDCWD, native.c_str(), true, mask, ec);
+#endif
+	}
+
+	file_status symlink_status(path_view const p, std::error_code& ec, status_mask const mask, bvestl::polyalloc::allocator_handle const handle) {
+		internal::native_path const native(p, handle);
+#if defined(EA_PLATFORM_WINDOWS)
+		return query(native.c_str(), false, mask, ec);
+#else
+		return internal::status_at(AT_FDCWD, native.c_str(), false, mask, ec);
+#endif
+	}
+} // namespace bvestl::fs
@@ -0,0 +1,435 @@
+#include "bvestl/fs/walk.hpp"
+#include "bvestl/fs/internal/directory_stream.hpp"
+#include "bvestl/fs/internal/instrument.hpp"
+#include "bvestl/fs/internal/native_path.hpp"
+#include "bvestl/fs/internal/small_vector.hpp"
+#include "bvestl/fs/internal/status_at.hpp"
+#include "bvestl/fs/internal/vector.hpp"
+
+#if !defined(EA_PLATFORM_WINDOWS)
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace bvestl::fs {
+	namespace internal {
+		struct entry_access {
+			static void fill(directory_entry& entry,
+			                 eastl::string_view const name,
+			                 path_view const relative_path,
+			                 file_type const type,
+			                 std::uint64_t const inode,
+			                 size_t const depth) {
+				entry.m_name = name;
+				entry.m_relative_path = relative_path;
+				entry.m_type = type;
+				entry.m_inode = inode;
+				entry.m_depth = depth;
+			}
+
+#if defined(EA_PLATFORM_WINDOWS)
+			static void set_directory(directory_entry& entry, const path* const root) { entry.m_root = root; }
+#else
+			static void set_directory(directory_entry& entry, int const fd) { entry.m_directory_fd = fd; }
+#endif
+		};
+	} // namespace internal
+
+	namespace {
+		/**
+		 * A directory to list. Its relative path (null-terminated) is stored right behind it.
+		 * It stays alive, and on POSIX open, until everything below it has been visited.
+		 */
+		struct node {
+			node* parent;
+			bvestl::polyalloc::allocator_handle allocator;
+			// One for the node's own listing plus one per unfinished child directory
+			std::atomic<size_t> pending;
+			// Depth of the node's entries
+			size_t depth;
+			size_t path_length;
+			size_t name_offset;
+			file_type type;
+			std::uint64_t inode;
+			// Identity of the open directory, known when following symlinks
+			std::uint64_t device = 0;
+			std::uint64_t file_id = 0;
+			internal::directory_stream stream;
+
+			char* relative_path() { return reinterpret_cast<char*>(this + 1); }
+			size_t allocation_size() const { return sizeof(node) + path_length + 1; }
+		};
+
+		struct worker {
+			worker(bvestl::polyalloc::allocator_handle const handle, size_t const buffer_size) :
+			    allocator(handle), tasks(handle), relative(handle), buffer_size(buffer_size) {
+				buffer = static_cast<char*>(allocator.allocate(buffer_size, alignof(std::uint64_t), 0));
+			}
+			~worker() { allocator.deallocate(buffer, buffer_size); }
+
+			bvestl::polyalloc::allocator_handle allocator;
+			// The owner pushes and pops at the back, thieves take from the front
+			std::mutex lock;
+			internal::vector<node*> tasks;
+			size_t head = 0;
+			// Relative path of the entry being visited
+			internal::small_vector<char, 256> relative;
+			char* buffer;
+			size_t buffer_size;
+			std::uint64_t entries = 0;
+			std::uint64_t directories = 0;
+			std::uint64_t symlink_loops = 0;
+		};
+
+		class walker {
+		  public:
+			walker(path_view const root,
+			       walk_callbacks const& callbacks,
+			       walk_options const& options,
+			       size_t const thread_count,
+			       bvestl::polyalloc::allocator_handle const handle,
+			       walk_result& result) :
+			    m_callbacks(callbacks),
+			    m_options(options),
+			    m_handle(handle),
+			    m_thread_count(thread_count),
+			    m_result(result),
+			    m_root(root, handle) {
+				if (m_options.buffer_size < internal::directory_stream::MIN_BUFFER_SIZE)
+					m_options.buffer_size = internal::directory_stream::MIN_BUFFER_SIZE;
+
+				m_workers = static_cast<worker*>(m_handle.allocate(sizeof(worker) * m_thread_count, alignof(worker), 0));
+				for (size_t i = 0; i < m_thread_count; ++i) {
+					bvestl::polyalloc::allocator_handle const allocator = m_options.thread_allocators != nullptr ? m_options.thread_allocators[i] : m_handle;
+					new (m_workers + i) worker(allocator, m_options.buffer_size);
+				}
+			}
+
+			~walker() {
+				for (size_t i = 0; i < m_thread_count; ++i) {
+					m_result.entries += m_workers[i].entries;
+					m_result.directories += m_workers[i].directories;
+					m_result.symlink_loops += m_workers[i].symlink_loops;
+					m_workers[i].~worker();
+				}
+				m_handle.deallocate(m_workers, sizeof(worker) * m_thread_count);
+			}
+
+			void run() {
+				node* const root = make_node(m_workers[0], nullptr, eastl::string_view(), file_type::directory, 0);
+				push(m_workers[0], root);
+
+				internal::vector<std::thread> threads(m_handle);
+				threads.reserve(m_thread_count - 1);
+				for (size_t i = 1; i < m_thread_count; ++i)
+					threads.emplace_back([this, i] { work(i); });
+				work(0);
+				for (auto& thread : threads)
+					thread.join();
+			}
+
+		  private:
+			node* make_node(worker& w, node* const parent, eastl::string_view const name, file_type const type, std::uint64_t const inode) {
+				size_t const parent_length = parent != nullptr ? parent->path_length : 0;
+				size_t const separator = parent_length != 0 ? 1 : 0;
+				size_t const path_length = parent_length + separator + name.size();
+
+				void* const memory = w.allocator.allocate(sizeof(node) + path_length + 1, alignof(node), 0);
+				node* const n = new (memory) node();
+				n->parent = parent;
+				n->allocator = w.allocator;
+				n->pending.store(1, std::memory_order_relaxed);
+				n->depth = parent != nullptr ? parent->depth + 1 : 0;
+				n->path_length = path_length;
+				n->name_offset = parent_length + separator;
+				n->type = type;
+				n->inode = inode;
+
+				char* const text = n->relative_path();
+				if (parent_length != 0) {
+					std::memcpy(text, parent->relative_path(), parent_length);
+					text[parent_length] = '/';
+				}
+				if (!name.empty())
+					std::memcpy(text + n->name_offset, name.data(), name.size());
+				text[path_length] = '\0';
+				return n;
+			}
+
+			void push(worker& w, node* const n) {
+				{
+					std::lock_guard<std::mutex> lg(w.lock);
+					w.tasks.push_back(n);
+				}
+				m_queued.fetch_add(1);
+				if (m_sleepers.load() != 0) {
+					std::lock_guard<std::mutex> lg(m_idle_lock);
+					m_idle.notify_one();
+				}
+			}
+
+			bool pop(worker& w, node*& out) {
+				std::lock_guard<std::mutex> lg(w.lock);
+				if (w.head == w.tasks.size())
+					return false;
+				out = w.tasks.back();
+				w.tasks.pop_back();
+				if (w.head == w.tasks.size()) {
+					w.tasks.clear();
+					w.head = 0;
+				}
+				return true;
+			}
+
+			bool steal(worker& w, node*& out) {
+				std::lock_guard<std::mutex> lg(w.lock);
+				if (w.head == w.tasks.size())
+					return false;
+				out = w.tasks[w.head++];
+				if (w.head == w.tasks.size()) {
+					w.tasks.clear();
+					w.head = 0;
+				}
+				return true;
+			}
+
+			bool find_task(size_t const index, node*& out) {
+				if (pop(m_workers[index], out))
+					return true;
+				for (size_t i = 1; i < m_thread_count; ++i) {
+					if (steal(m_workers[(index + i) % m_thread_count], out))
+						return true;
+				}
+				return false;
+			}
+
+			void work(size_t const index) {
+				worker& w = m_workers[index];
+				while (true) {
+					node* task = nullptr;
+					if (find_task(index, task)) {
+						m_queued.fetch_sub(1);
+						if (!m_stop.load(std::memory_order_relaxed))
+							list(w, index, task);
+						finish(index, task);
+						continue;
+					}
+
+					std::unique_lock<std::mutex> lock(m_idle_lock);
+					m_sleepers.fetch_add(1);
+					m_idle.wait(lock, [this] { return m_queued.load() != 0 || m_done.load(); });
+					m_sleepers.fetch_sub(1);
+					if (m_done.load() && m_queued.load() == 0)
+						return;
+				}
+			}
+
+			void list(worker& w, size_t const index, node* const n) {
+				std::error_code ec;
+				bool const is_root = n->parent == nullptr;
+#if defined(EA_PLATFORM_WINDOWS)
+				// FindFirstFileExW wants a pattern: <root>/<relative>/*
+				eastl::string_view const root_text = static_cast<path_view>(m_root).text();
+				w.relative.clear();
+				w.relative.append(root_text.data(), root_text.size());
+				w.relative.push_back('/');
+				w.relative.append(n->relative_path(), n->path_length);
+				w.relative.push_back('/');
+				w.relative.push_back('*');
+				internal::native_path const native(path_view(eastl::string_view(w.relative.data(), w.relative.size()), path_type::windows_path), w.allocator);
+				n->stream.open(native.c_str(), w.buffer, w.buffer_size, ec);
+#else
+				bool const follow = is_root || m_options.symlinks == symlink_policy::follow;
+				if (is_root) {
+					internal::native_path const native(m_root, w.allocator);
+					n->stream.open(AT_FDCWD, native.c_str(), follow, w.buffer, w.buffer_size, ec);
+				}
+				else {
+					n->stream.open(n->parent->stream.fd(), n->relative_path() + n->name_offset, follow, w.buffer, w.buffer_size, ec);
+				}
+#endif
+				if (ec) {
+					bool const skip = internal::is_permission_error(ec) ? m_options.skip_permission_denied : internal::is_vanished_error(ec);
+					// The root's relative path is empty, so it is reported as such
+					if (is_root || !skip)
+						fail(ec, path_view(eastl::string_view(n->relative_path(), n->path_length)));
+					return;
+				}
+#if !defined(EA_PLATFORM_WINDOWS)
+				if (m_options.symlinks == symlink_policy::follow && is_loop(n)) {
+					++w.symlink_loops;
+					return;
+				}
+#endif
+
+				directory_entry entry;
+				internal::raw_directory_entry raw{};
+				size_t const prefix = n->path_length != 0 ? n->path_length + 1 : 0;
+				while (!m_stop.load(std::memory_order_relaxed)) {
+					if (!n->stream.read(raw, ec)) {
+						if (ec)
+							fail(ec, path_view(eastl::string_view(n->relative_path(), n->path_length)));
+						break;
+					}
+					if (internal::is_dot_or_dot_dot(raw.name))
+						continue;
+					if (raw.type == file_type::symlink && m_options.symlinks == symlink_policy::skip)
+						continue;
+
+					w.relative.clear();
+					w.relative.append(n->relative_path(), n->path_length);
+					if (prefix != 0)
+						w.relative.push_back('/');
+					w.relative.append(raw.name, raw.length);
+					w.relative.push_back('\0');
+
+					internal::entry_access::fill(entry, eastl::string_view(w.relative.data() + prefix, raw.length),
+					                             path_view(eastl::string_view(w.relative.data(), w.relative.size() - 1)), raw.type, raw.inode, n->depth);
+#if defined(EA_PLATFORM_WINDOWS)
+					internal::entry_access::set_directory(entry, &m_root);
+#else
+					internal::entry_access::set_directory(entry, n->stream.fd());
+#endif
+					++w.entries;
+
+					walk_action const action = m_callbacks.enter(m_callbacks.context, entry, index);
+					if (action == walk_action::stop) {
+						m_stop.store(true);
+						break;
+					}
+					if (action == walk_action::skip_subtree || n->depth >= m_options.max_depth)
+						continue;
+
+					file_type type = raw.type;
+					// Only ask the filesystem when the listing couldn't tell
+					if (type == file_type::unknown || (type == file_type::symlink && m_options.symlinks == symlink_policy::follow)) {
+						std::error_code ignored;
+						type = entry.symlink_status(ignored, status_mask::type).type;
+						if (type == file_type::symlink && m_options.symlinks == symlink_policy::follow)
+							type = entry.status(ignored, status_mask::type).type;
+					}
+					if (type != file_type::directory)
+						continue;
+
+					++w.directories;
+					n->pending.fetch_add(1);
+					push(w, make_node(w, n, eastl::string_view(raw.name, raw.length), raw.type, raw.inode));
+				}
+
+#if defined(EA_PLATFORM_WINDOWS)
+				// Children are opened by path, nothing needs the search handle any more
+				n->stream.close();
+#endif
+			}
+
+			void finish(size_t const index, node* n) {
+				while (n->pending.fetch_sub(1) == 1) {
+					node* const parent = n->parent;
+					if (parent != nullptr && m_callbacks.leave != nullptr && !m_stop.load(std::memory_order_relaxed)) {
+						directory_entry entry;
+						internal::entry_access::fill(entry, eastl::string_view(n->relative_path() + n->name_offset, n->path_length - n->name_offset),
+						                             path_view(eastl::string_view(n->relative_path(), n->path_length)), n->type, n->inode,
+						                             parent->depth);
+#if defined(EA_PLATFORM_WINDOWS)
+						internal::entry_access::set_directory(entry, &m_root);
+#else
+						internal::entry_access::set_directory(entry, parent->stream.fd());
+#endif
+						m_callbacks.leave(m_callbacks.context, entry, index);
+					}
+
+					n->stream.close();
+					bvestl::polyalloc::allocator_handle allocator = n->allocator;
+					size_t const size = n->allocation_size();
+					n->~node();
+					allocator.deallocate(n, size);
+
+					if (parent == nullptr) {
+						std::lock_guard<std::mutex> lg(m_idle_lock);
+						m_done.store(true);
+						m_idle.notify_all();
+						return;
+					}
+					n = parent;
+				}
+			}
+
+#if !defined(EA_PLATFORM_WINDOWS)
+			/**
+			 * Records the identity of \p n, just opened, and tells whether it is also one of
+			 * its ancestors, reached again through a symlink. Ancestors stay alive until
+			 * everything below them is done, so the chain can be read without locking.
+			 */
+			bool is_loop(node* const n) {
+				struct stat st;
+				BVESTL_FS_OP_BEGIN(stat);
+				int const result = fstat(n->stream.fd(), &st);
+				BVESTL_FS_OP_END(stat, result != 0);
+				if (result != 0)
+					return false;
+				n->device = static_cast<std::uint64_t>(st.st_dev);
+				n->file_id = static_cast<std::uint64_t>(st.st_ino);
+				for (const node* ancestor = n->parent; ancestor != nullptr; ancestor = ancestor->parent) {
+					if (ancestor->device == n->device && ancestor->file_id == n->file_id)
+						return true;
+				}
+				return false;
+			}
+#endif
+
+			void fail(std::error_code const& ec, path_view const where) {
+				{
+					std::lock_guard<std::mutex> lg(m_error_lock);
+					if (!m_result.error) {
+						m_result.error = ec;
+						m_result.failed_path = path(where, m_handle);
+					}
+				}
+				m_stop.store(true);
+			}
+
+			walk_callbacks m_callbacks;
+			walk_options m_options;
+			bvestl::polyalloc::allocator_handle m_handle;
+			size_t m_thread_count;
+			walk_result& m_result;
+			path m_root;
+			worker* m_workers = nullptr;
+
+			std::atomic<size_t> m_queued{0};
+			std::atomic<size_t> m_sleepers{0};
+			std::atomic<bool> m_done{false};
+			std::atomic<bool> m_stop{false};
+			std::mutex m_idle_lock;
+			std::condition_variable m_idle;
+			std::mutex m_error_lock;
+		};
+	} // namespace
+
+	walk_result parallel_walk(path_view const root,
+	                          walk_callbacks const& callbacks,
+	                          walk_options const& options,
+	                          bvestl::polyalloc::allocator_handle const handle) {
+		walk_result result(handle);
+
+		size_t thread_count = options.threads;
+		walk_options adjusted = options;
+		if (thread_count == 0) {
+			thread_count = eastl::max<size_t>(std::thread::hardware_concurrency(), 1);
+			// Without an explicit count there is no telling how long the array is
+			adjusted.thread_allocators = nullptr;
+		}
+
+		{
+			walker w(root, callbacks, adjusted, thread_count, handle, result);
+			w.run();
+		}
+		return result;
+	}
+} // namespace bvestl::fs
@@ -0,0 +1,100 @@
+#include "bvestl/fs/allocators.hpp"
+#include <doctest/doctest.h>
+#include <cstdint>
+#include <cstring>
+
+using namespace bvestl::fs;
+
+namespace {
+	bool aligned(void const* const p, size_t const alignment) {
+		return (reinterpret_cast<std::uintptr_t>(p) & (alignment - 1)) == 0;
+	}
+} // namespace
+
+TEST_CASE("monotonic_arena reuses its blocks after reset") {
+	monotonic_arena arena(1024);
+	void* const first = arena.allocate(100);
+	void* const second = arena.allocate(100);
+	CHECK(first != second);
+	CHECK(arena.used() == 200);
+
+	// Only the latest allocation is given back
+	arena.deallocate(first, 100);
+	CHECK(arena.used() == 200);
+	arena.deallocate(second, 100);
+	CHECK(arena.used() == 100);
+	CHECK(arena.allocate(100) == second);
+
+	// Spill into a second block, then rewind to the start of the first
+	void* const big = arena.allocate(4096);
+	CHECK(big != nullptr);
+	arena.reset();
+	CHECK(arena.used() == 0);
+	CHECK(arena.allocate(100) == first);
+	CHECK(arena.allocate(4096) == big);
+
+	void* const offset = arena.allocate(24, 64, 8);
+	CHECK(aligned(static_cast<char*>(offset) + 8, 64));
+}
+
+TEST_CASE("monotonic_arena serves from its initial buffer first") {
+	alignas(16) char buffer[256];
+	monotonic_arena arena(buffer, sizeof(buffer), 1024);
+	CHECK(arena.allocate(64) == buffer);
+	char* const spilled = static_cast<char*>(arena.allocate(512));
+	CHECK((spilled < buffer || spilled >= buffer + sizeof(buffer)));
+	arena.reset();
+	CHECK(arena.allocate(64) == buffer);
+}
+
+TEST_CASE("pool_allocator reuses freed blocks of the same class") {
+	pool_allocator pool;
+	void* const a = pool.allocate(20);
+	void* const b = pool.allocate(32);
+	CHECK(a != b);
+	pool.deallocate(a, 20);
+	// 20 and 32 bytes share the 32 byte class
+	CHECK(pool.allocate(32) == a);
+
+	void* const over_aligned = pool.allocate(16, 128, 0);
+	CHECK(aligned(over_aligned, 128));
+	pool.deallocate(over_aligned, 16);
+	pool.deallocate(b, 32);
+}
+
+TEST_CASE("pool_allocator hands small offset requests back upstream") {
+	pool_allocator pool;
+	// p + 8 can't be 32 byte aligned inside a 32 byte aligned block
+	void* const odd = pool.allocate(20, 32, 8);
+	REQUIRE(odd != nullptr);
+	pool.deallocate(odd, 20);
+
+	// Were that block filed under its class, this would run past its end
+	auto* const full = static_cast<char*>(pool.allocate(32));
+	std::memset(full, 0xab, 32);
+	pool.deallocate(full, 32);
+
+	auto* const page = static_cast<char*>(pool.allocate(64, 4096, 0));
+	CHECK(aligned(page, 4096));
+	pool.deallocate(page, 64);
+}
+
+TEST_CASE("thread_cache_allocator caches full class blocks only") {
+	thread_cache_allocator cache(4);
+	void* const a = cache.allocate(40);
+	cache.deallocate(a, 40);
+	CHECK(cache.allocate(64) == a);
+	cache.deallocate(a, 64);
+
+	void* const odd = cache.allocate(20, 16, 8);
+	REQUIRE(odd != nullptr);
+	cache.deallocate(odd, 20);
+	auto* const over_aligned = static_cast<char*>(cache.allocate(20, 256, 0));
+	CHECK(aligned(over_aligned, 256));
+	cache.deallocate(over_aligned, 20);
+
+	// Any block now cached for the 32 byte class must hold all of it
+	auto* const full = static_cast<char*>(cache.allocate(32));
+	std::memset(full, 0xab, 32);
+	cache.deallocate(full, 32);
+}
@@ -0,0 +1,115 @@
+#include "bvestl/fs/copy.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/status.hpp"
+#include <doctest/doctest.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#if !defined(EA_PLATFORM_WINDOWS)
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+using namespace bvestl::fs;
+
+extern internal::string* root;
+
+namespace {
+	void write_text(path const& file, std::string const& text) {
+		std::ofstream(file.native_c_str(), std::ios::binary) << text;
+	}
+
+	std::string read_text(path const& file) {
+		std::ifstream in(file.native_c_str(), std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+} // namespace
+
+TEST_CASE("copy_file applies the existing-destination policy") {
+	path const base = path(*root) / path("copy_policy");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base, ec));
+	path const from = base / path("from");
+	path const to = base / path("to");
+	write_text(from, "new contents");
+	write_text(to, "old");
+
+	CHECK_FALSE(copy_file(from, to, ec));
+	CHECK(ec == std::errc::file_exists);
+
+	copy_options options;
+	options.existing = copy_existing::skip;
+	ec.clear();
+	CHECK(copy_file(from, to, ec, options));
+	CHECK(read_text(to) == "old");
+
+	options.existing = copy_existing::overwrite;
+	CHECK(copy_file(from, to, ec, options));
+	CHECK_FALSE(ec);
+	CHECK(read_text(to) == "new contents");
+
+	remove_directory_recursive(base);
+}
+
+#if !defined(EA_PLATFORM_WINDOWS)
+TEST_CASE("copy_file never writes through a symlinked destination") {
+	path const base = path(*root) / path("copy_symlinks");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base, ec));
+	path const from = base / path("from");
+	path const other = base / path("other");
+	path const to = base / path("to");
+	write_text(from, "source");
+	write_text(other, "other");
+
+	copy_options options;
+	options.existing = copy_existing::overwrite;
+
+	// A link to the source is the source: refuse rather than truncate it
+	REQUIRE(::symlink("from", to.native_c_str()) == 0);
+	CHECK_FALSE(copy_file(from, to, ec, options));
+	CHECK(ec == std::errc::invalid_argument);
+	CHECK(read_text(from) == "source");
+
+	// A link elsewhere is replaced by the copy, leaving its target alone
+	REQUIRE(::unlink(to.native_c_str()) == 0);
+	REQUIRE(::symlink("other", to.native_c_str()) == 0);
+	ec.clear();
+	CHECK(copy_file(from, to, ec, options));
+	CHECK_FALSE(ec);
+	CHECK(symlink_status(to, ec).type == file_type::regular);
+	CHECK(read_text(to) == "source");
+	CHECK(read_text(other) == "other");
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("copy_directory_recursive reports where it failed") {
+	// Permission bits don't stop root
+	if (::geteuid() == 0)
+		return;
+	path const base = path(*root) / path("copy_failures");
+	path const from = base / path("from");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(from / path("sealed"), ec));
+	write_text(from / path("file"), "file");
+	write_text(from / path("sealed/inner"), "inner");
+
+	// A directory inside the tree that can't be listed
+	REQUIRE(::chmod((from / path("sealed")).native_c_str(), 0300) == 0);
+	copy_result const inside = copy_directory_recursive(from, base / path("inside"));
+	CHECK(inside.error == std::errc::permission_denied);
+	CHECK(inside.failed_path == from / path("sealed"));
+	REQUIRE(::chmod((from / path("sealed")).native_c_str(), 0700) == 0);
+
+	// The root itself, which status() alone doesn't catch
+	REQUIRE(::chmod(from.native_c_str(), 0300) == 0);
+	copy_result const top = copy_directory_recursive(from, base / path("top"));
+	CHECK(top.error == std::errc::permission_denied);
+	CHECK(top.failed_path == from);
+	REQUIRE(::chmod(from.native_c_str(), 0700) == 0);
+
+	remove_directory_recursive(base);
+}
+#endif
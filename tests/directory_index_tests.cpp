@@ -0,0 +1,127 @@
+#include "bvestl/fs/directory_index.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/resolver.hpp"
+#include <doctest/doctest.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace bvestl::fs;
+
+extern internal::string* root;
+
+namespace {
+	void touch(path const& file) {
+		std::error_code ec;
+		open_file(file, open_flags::write | open_flags::create, ec);
+		REQUIRE_FALSE(ec);
+	}
+
+	std::string read_bytes(path const& file) {
+		std::ifstream in(file.native_c_str(), std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	void write_bytes(path const& file, std::string const& bytes) {
+		std::ofstream(file.native_c_str(), std::ios::binary | std::ios::trunc) << bytes;
+	}
+
+	// Two roots sharing "a", so which one provides it shows their priority
+	void make_roots(path const& base) {
+		std::error_code ec;
+		REQUIRE(create_directory_recursive(base / path("first/d"), ec));
+		REQUIRE(create_directory_recursive(base / path("second"), ec));
+		for (const char* const name : {"first/a", "first/d/x", "second/a", "second/b"})
+			touch(base / path(name));
+	}
+} // namespace
+
+TEST_CASE("directory_index answers the same once saved and loaded") {
+	path const base = path(*root) / path("index_round_trip");
+	make_roots(base);
+	path const roots[] = {base / path("first"), base / path("second")};
+	std::error_code ec;
+	directory_index const built = build_directory_index(roots, 2, ec);
+	REQUIRE_FALSE(ec);
+	path const file = base / path("index.bin");
+	REQUIRE(built.save(file, ec));
+
+	directory_index loaded = load_directory_index(file, ec);
+	REQUIRE_FALSE(ec);
+	auto const check = [&](directory_index const& index) {
+		CHECK(index.root_count() == 2);
+		CHECK(index.root(1) == static_cast<path_view>(roots[1]).text());
+		// a, b, d and d/x
+		CHECK(index.size() == 4);
+		file_type type = file_type::none;
+		CHECK(index.find(path_view("a")) == 0);
+		CHECK(index.find(path_view("b")) == 1);
+		CHECK(index.find(path_view("d//x"), &type) == 0);
+		CHECK(type == file_type::regular);
+		CHECK(index.find(path_view("d"), &type) == 0);
+		CHECK(type == file_type::directory);
+		CHECK(index.find(path_view("missing")) == directory_index::npos);
+	};
+	check(built);
+	check(loaded);
+
+	resolver r;
+	r.erase(r.begin());
+	// Only an index of the resolver's own search paths is taken
+	CHECK_FALSE(r.use_index(load_directory_index(file, ec)));
+	for (path const& p : roots)
+		r.append(p);
+	REQUIRE(r.use_index(std::move(loaded)));
+	CHECK(r.has_index());
+	// Answered from the index, which doesn't see the file go
+	REQUIRE(remove_file(roots[1] / path("b")));
+	CHECK(r.resolve(path("b")) == roots[1] / path("b"));
+	CHECK(r.resolve(path("a")) == roots[0] / path("a"));
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("load_directory_index rejects corrupt files") {
+	path const base = path(*root) / path("index_corrupt");
+	make_roots(base);
+	path const roots[] = {base / path("first")};
+	std::error_code ec;
+	path const file = base / path("index.bin");
+	REQUIRE(build_directory_index(roots, 1, ec).save(file, ec));
+	std::string const good = read_bytes(file);
+	REQUIRE(good.size() > 80);
+
+	auto const rejected = [&](std::string const& bytes) {
+		write_bytes(file, bytes);
+		directory_index const index = load_directory_index(file, ec);
+		return ec == std::errc::bad_message && index.empty();
+	};
+	CHECK(rejected(good.substr(0, 40)));
+	CHECK(rejected(good.substr(0, good.size() - 1)));
+	std::string bad_magic = good;
+	bad_magic[0] ^= 1;
+	CHECK(rejected(bad_magic));
+
+	// Every slot taken: a probe for a missing name would never end
+	std::string full = good;
+	std::uint64_t slot_count = 0;
+	std::uint64_t slots_offset = 0;
+	std::memcpy(&slot_count, full.data() + 24, sizeof(slot_count));
+	std::memcpy(&slots_offset, full.data() + 40, sizeof(slots_offset));
+	for (std::uint64_t i = 0; i < slot_count; ++i) {
+		std::uint32_t const first = 1;
+		std::memcpy(&full[static_cast<size_t>(slots_offset + i * sizeof(first))], &first, sizeof(first));
+	}
+	CHECK(rejected(full));
+
+	write_bytes(file, good);
+	CHECK_FALSE(load_directory_index(file, ec).empty());
+	CHECK_FALSE(ec);
+	load_directory_index(base / path("missing.bin"), ec);
+	CHECK(ec == std::errc::no_such_file_or_directory);
+
+	remove_directory_recursive(base);
+}
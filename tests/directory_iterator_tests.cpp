@@ -0,0 +1,103 @@
+#include "bvestl/fs/directory_iterator.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path.hpp"
+#include <doctest/doctest.h>
+#include <set>
+#include <string>
+
+#if !defined(EA_PLATFORM_WINDOWS)
+#	include <unistd.h>
+#endif
+
+using namespace bvestl::fs;
+
+extern internal::string* root;
+
+namespace {
+	std::string relative_text(directory_entry const& entry) {
+		eastl::string_view const text = entry.relative_path().text();
+		return std::string(text.data(), text.size());
+	}
+} // namespace
+
+TEST_CASE("recursive_directory_iterator descends into directories whose paths fill its buffer") {
+	path const base = path(*root) / path("iterator_descent");
+	// Names of the longest length allowed: two levels fill the relative path buffer
+	// exactly after its first reallocation, so descending into the second moves it
+	std::string const long_name(254, 'd');
+	std::set<std::string> expected;
+	std::string relative;
+	std::error_code ec;
+	for (int level = 0; level < 3; ++level) {
+		relative += (level == 0 ? "" : "/") + long_name + std::to_string(level);
+		expected.insert(relative);
+		expected.insert(relative + "/file");
+		path const directory = base / path(relative.c_str());
+		REQUIRE(create_directory_recursive(directory, ec));
+		open_file(directory / path("file"), open_flags::write | open_flags::create, ec);
+		REQUIRE_FALSE(ec);
+	}
+
+	std::set<std::string> seen;
+	size_t deepest = 0;
+	recursive_directory_iterator it(base, ec);
+	REQUIRE_FALSE(ec);
+	for (directory_entry const& entry : it) {
+		seen.insert(relative_text(entry));
+		// The name must still view the current relative path after descending moved it
+		eastl::string_view const text = entry.relative_path().text();
+		REQUIRE(text.size() >= entry.name().size());
+		CHECK(text.substr(text.size() - entry.name().size()) == entry.name());
+		deepest = entry.depth() > deepest ? entry.depth() : deepest;
+	}
+	CHECK_FALSE(it.error());
+	CHECK(seen == expected);
+	CHECK(deepest == 3);
+
+	remove_directory_recursive(base);
+}
+
+#if !defined(EA_PLATFORM_WINDOWS)
+TEST_CASE("recursive_directory_iterator only descends into symlinks when asked to") {
+	path const base = path(*root) / path("iterator_symlinks");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("real"), ec));
+	open_file(base / path("real/file"), open_flags::write | open_flags::create, ec);
+	REQUIRE(::symlink("real", (base / path("link")).native_c_str()) == 0);
+
+	auto const collect = [&](bool const follow) {
+		directory_options options;
+		options.follow_symlinks = follow;
+		std::set<std::string> seen;
+		recursive_directory_iterator it(base, ec, options);
+		for (directory_entry const& entry : it)
+			seen.insert(relative_text(entry));
+		return seen;
+	};
+	CHECK(collect(false) == std::set<std::string>{"link", "real", "real/file"});
+	CHECK(collect(true) == std::set<std::string>{"link", "link/file", "real", "real/file"});
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("recursive_directory_iterator doesn't follow a symlink back up the tree") {
+	path const base = path(*root) / path("iterator_loop");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("a/b"), ec));
+	open_file(base / path("a/b/file"), open_flags::write | open_flags::create, ec);
+	REQUIRE(::symlink("../..", (base / path("a/b/up")).native_c_str()) == 0);
+
+	directory_options options;
+	options.follow_symlinks = true;
+	std::set<std::string> seen;
+	recursive_directory_iterator it(base, ec, options);
+	REQUIRE_FALSE(ec);
+	for (directory_entry const& entry : it)
+		seen.insert(relative_text(entry));
+	CHECK_FALSE(it.error());
+	// a/b/up is listed but not descended into
+	CHECK(seen == std::set<std::string>{"a", "a/b", "a/b/file", "a/b/up"});
+
+	remove_directory_recursive(base);
+}
+#endif
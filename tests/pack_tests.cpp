@@ -0,0 +1,114 @@
+#include "bvestl/fs/pack.hpp"
+#include "bvestl/fs/path.hpp"
+#include <doctest/doctest.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace bvestl::fs;
+
+extern internal::string* root;
+
+namespace {
+	std::vector<std::byte> bytes(const char* const text) {
+		std::vector<std::byte> out(std::strlen(text));
+		std::memcpy(out.data(), text, out.size());
+		return out;
+	}
+
+	eastl::span<const std::byte> view(std::vector<std::byte> const& data) {
+		return eastl::span<const std::byte>(data.data(), data.size());
+	}
+
+	bool round_trips(mapped_pack const& pack, const char* const name, std::vector<std::byte> const& expected) {
+		size_t const index = pack.find(path_view(name));
+		if (index == mapped_pack::npos)
+			return false;
+		std::error_code ec;
+		file_contents const contents = pack.open(index, ec);
+		return !ec && contents.size() == expected.size() &&
+		       (expected.empty() || std::memcmp(contents.data(), expected.data(), expected.size()) == 0);
+	}
+} // namespace
+
+TEST_CASE("pack entries compressed with lz come back intact") {
+	path const base = path(*root) / path("pack_lz");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base, ec));
+
+	std::vector<std::byte> const one = bytes("x");
+	// xorshift output doesn't shrink, so its blocks are stored as is
+	std::vector<std::byte> noise(10000);
+	std::uint32_t state = 2463534242u;
+	for (std::byte& b : noise) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		b = static_cast<std::byte>(state);
+	}
+	// Matches longer than their offset copy bytes they are still producing
+	std::vector<std::byte> runs(bytes("ab"));
+	runs.resize(9000, std::byte{'a'});
+	for (size_t i = 0; i < 3000; ++i)
+		runs.push_back(static_cast<std::byte>("xyz"[i % 3]));
+
+	pack_options options;
+	options.block_size = 4096;
+	pack_builder builder(options);
+	REQUIRE(builder.add(path_view("one"), view(one), ec, pack_compression::lz));
+	REQUIRE(builder.add(path_view("noise"), view(noise), ec, pack_compression::lz));
+	REQUIRE(builder.add(path_view("runs"), view(runs), ec, pack_compression::lz));
+	REQUIRE(builder.add(path_view("empty"), eastl::span<const std::byte>(), ec, pack_compression::lz));
+	path const file = base / path("lz.pack");
+	REQUIRE(builder.write(file, ec));
+
+	mapped_pack const pack{file, ec};
+	REQUIRE_FALSE(ec);
+	CHECK(round_trips(pack, "one", one));
+	CHECK(round_trips(pack, "noise", noise));
+	CHECK(round_trips(pack, "runs", runs));
+	CHECK(round_trips(pack, "empty", std::vector<std::byte>()));
+	CHECK(pack.entry(pack.find(path_view("runs"))).stored_size < runs.size());
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("mapped_pack finds what pack_builder wrote") {
+	path const base = path(*root) / path("pack_lookup");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base, ec));
+
+	pack_builder builder;
+	for (const char* const name : {"dir/sub/b.txt", "dir/sub/a.txt", "dir/c.txt", "dir.txt", "dirx", "top"})
+		REQUIRE(builder.add(path_view(name), view(bytes(name)), ec));
+	path const file = base / path("lookup.pack");
+	REQUIRE(builder.write(file, ec));
+
+	mapped_pack const pack{file, ec};
+	REQUIRE_FALSE(ec);
+	CHECK(pack.size() == 6);
+	CHECK(pack.find(path_view("dir//sub/a.txt")) != mapped_pack::npos);
+	CHECK(pack.find(path_view("dir/sub")) == mapped_pack::npos);
+	CHECK(pack.find(path_view("missing")) == mapped_pack::npos);
+	CHECK(pack.find(path_view("dir/../top")) == mapped_pack::npos);
+	CHECK(pack.is_directory(path_view("dir/sub")));
+	CHECK_FALSE(pack.is_directory(path_view("dir/c.txt")));
+
+	// Below "dir" but neither "dir.txt" nor "dirx", which sort around it
+	eastl::pair<size_t, size_t> const below = pack.entries_below(path_view("dir"));
+	REQUIRE(below.second - below.first == 3);
+	CHECK(pack.entry(below.first).name == "dir/c.txt");
+	CHECK(pack.entry(below.first + 1).name == "dir/sub/a.txt");
+	CHECK(pack.entry(below.first + 2).name == "dir/sub/b.txt");
+	eastl::pair<size_t, size_t> const all = pack.entries_below(path_view());
+	CHECK(all.second - all.first == 6);
+
+	for (const char* const name : {"dir/sub/b.txt", "dir.txt", "top"}) {
+		CHECK(round_trips(pack, name, bytes(name)));
+		file_contents const contents = pack.open(pack.find(path_view(name)), ec);
+		CHECK(contents.is_mapped());
+		CHECK(pack.data(pack.find(path_view(name))).size() == std::strlen(name));
+	}
+
+	remove_directory_recursive(base);
+}
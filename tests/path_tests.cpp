@@ -0,0 +1,96 @@
+#include "bvestl/fs/path.hpp"
+#include <doctest/doctest.h>
+#include <string>
+
+using namespace bvestl::fs;
+
+namespace {
+	path posix(const char* const text) {
+		return path(path_view(eastl::string_view(text), path_type::posix_path));
+	}
+
+	path windows(const char* const text) {
+		return path(path_view(eastl::string_view(text), path_type::windows_path));
+	}
+
+	std::string text(path const& p, path_type const type = path_type::posix_path) {
+		internal::string const s = p.str(type);
+		return std::string(s.data(), s.size());
+	}
+} // namespace
+
+TEST_CASE("lexically_normal folds dots") {
+	CHECK(text(posix("..").lexically_normal()) == "..");
+	CHECK(text(posix("a/..").lexically_normal()) == ".");
+	CHECK(text(posix("a/../..").lexically_normal()) == "..");
+	CHECK(text(posix("../a/./b/../c").lexically_normal()) == "../a/c");
+	CHECK(text(posix("a//b/.").lexically_normal()) == "a/b");
+
+	// Nothing is above the root
+	CHECK(text(posix("/..").lexically_normal()) == "/");
+	CHECK(posix("/..").lexically_normal().is_absolute());
+	CHECK(text(posix("/a/../../b").lexically_normal()) == "/b");
+
+	// Nor above the drive
+	CHECK(text(windows("C:\\a\\..\\..\\b").lexically_normal(), path_type::windows_path) == "C:\\b");
+	CHECK(text(windows("C:\\..").lexically_normal(), path_type::windows_path) == "C:");
+	CHECK(text(windows("C:/a/./b").lexically_normal(), path_type::windows_path) == "C:\\a\\b");
+}
+
+TEST_CASE("lexically_relative climbs out of the base") {
+	CHECK(text(posix("/a/b/c").lexically_relative(posix("/a/d"))) == "../b/c");
+	CHECK(text(posix("/a").lexically_relative(posix("/"))) == "a");
+	CHECK(text(posix("/").lexically_relative(posix("/a"))) == "..");
+	CHECK(text(posix("a").lexically_relative(posix("a"))) == ".");
+
+	// ".." in the base past the common prefix would have to climb above it
+	CHECK(posix("a").lexically_relative(posix("a/..")).empty());
+	CHECK(posix("a").lexically_relative(posix("..")).empty());
+	CHECK(posix("a").lexically_relative(posix("b/../..")).empty());
+	CHECK(posix("/a").lexically_relative(posix("b")).empty());
+
+	CHECK(windows("C:\\a").lexically_relative(windows("D:\\a")).empty());
+	CHECK(text(windows("C:\\a\\b").lexically_relative(windows("C:\\c")), path_type::windows_path) == "..\\a\\b");
+}
+
+TEST_CASE("path splits components around the 16 byte scan boundary") {
+	for (size_t const length : {15, 16, 17, 31, 32, 33}) {
+		std::string const name(length, 'n');
+		for (char const separator : {'/', '\\'}) {
+			std::string const joined = name + separator + "tail";
+			path const p = windows(joined.c_str());
+			REQUIRE(p.length() == 2);
+			CHECK(text(p) == name + "/tail");
+
+			// Only Windows paths split at backslashes
+			path const q = posix(joined.c_str());
+			CHECK(q.length() == (separator == '/' ? 2 : 1));
+		}
+		// No separator at all, and one right at the end
+		CHECK(posix(name.c_str()).length() == 1);
+		CHECK(posix((name + "/").c_str()).length() == 1);
+	}
+}
+
+TEST_CASE("a moved-from path is empty") {
+	// Long enough that the text lives on the heap and the buffer itself moves
+	std::string const long_name(200, 'n');
+	for (std::string const& name : {std::string("short/name"), long_name + "/tail"}) {
+		path source = posix(name.c_str());
+		path const moved(std::move(source));
+		CHECK(text(moved) == name);
+		CHECK(source.empty());
+		CHECK(source.length() == 0);
+		CHECK(source == path());
+		CHECK(text(source).empty());
+
+		path target = posix("other");
+		source = posix(name.c_str());
+		target = std::move(source);
+		CHECK(target == moved);
+		CHECK(source == path());
+		// And it is still usable
+		source = target / posix("more");
+		CHECK(text(source) == name + "/more");
+	}
+}
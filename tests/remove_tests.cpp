@@ -0,0 +1,96 @@
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path.hpp"
+#include <doctest/doctest.h>
+
+#if !defined(EA_PLATFORM_WINDOWS)
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+using namespace bvestl::fs;
+
+extern internal::string* root;
+
+TEST_CASE("remove_directory_recursive removes a whole tree") {
+	path const base = path(*root) / path("remove_tree");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("a/b"), ec));
+	REQUIRE(create_directory_recursive(base / path("c"), ec));
+	for (const char* const name : {"a/b/one", "a/two", "three"}) {
+		open_file(base / path(name), open_flags::write | open_flags::create, ec);
+		REQUIRE_FALSE(ec);
+	}
+
+	remove_options options;
+	options.threads = 2;
+	remove_result const result = remove_directory_recursive(base, options);
+	CHECK_FALSE(result.error);
+	CHECK(result.failed_path.empty());
+	// Three files, a, a/b, c and the root
+	CHECK(result.removed == 7);
+	CHECK_FALSE(file_exists(base));
+
+	remove_result const missing = remove_directory_recursive(base, remove_options());
+	CHECK(missing.error == std::errc::no_such_file_or_directory);
+	CHECK(missing.failed_path == base);
+}
+
+TEST_CASE("remove_file leaves directories alone") {
+	path const base = path(*root) / path("remove_file");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("empty"), ec));
+	open_file(base / path("file"), open_flags::write | open_flags::create, ec);
+	REQUIRE_FALSE(ec);
+
+	CHECK(remove_file(base / path("file")));
+	CHECK_FALSE(file_exists(base / path("file")));
+	CHECK_FALSE(remove_file(base / path("empty")));
+	CHECK(file_exists(base / path("empty")));
+
+	remove_directory_recursive(base);
+}
+
+#if !defined(EA_PLATFORM_WINDOWS)
+TEST_CASE("remove_directory_recursive stops at an entry it can't remove") {
+	if (::geteuid() == 0)
+		return;
+	path const base = path(*root) / path("remove_locked");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("locked"), ec));
+	open_file(base / path("locked/file"), open_flags::write | open_flags::create, ec);
+	REQUIRE_FALSE(ec);
+	// Listable, but nothing in it can be unlinked
+	REQUIRE(::chmod((base / path("locked")).native_c_str(), 0500) == 0);
+
+	remove_result const result = remove_directory_recursive(base, remove_options());
+	CHECK(result.error == std::errc::permission_denied);
+	CHECK(result.failed_path == base / path("locked/file"));
+	CHECK(file_exists(base / path("locked/file")));
+
+	REQUIRE(::chmod((base / path("locked")).native_c_str(), 0700) == 0);
+	CHECK(remove_directory_recursive(base));
+}
+
+TEST_CASE("remove_directory_recursive reports a root it can't list") {
+	// Permission bits don't stop root
+	if (::geteuid() == 0)
+		return;
+	path const base = path(*root) / path("remove_noread");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("sub"), ec));
+	REQUIRE(::chmod(base.native_c_str(), 0300) == 0);
+
+	remove_result const result = remove_directory_recursive(base, remove_options());
+	CHECK(result.error == std::errc::permission_denied);
+	CHECK(result.failed_path == base);
+	CHECK(result.removed == 0);
+	CHECK_FALSE(remove_directory_recursive(base));
+	// Relative roots are reported as given too
+	path const relative = base.lexically_relative(cwd());
+	REQUIRE_FALSE(relative.empty());
+	CHECK(remove_directory_recursive(relative, remove_options()).failed_path == relative);
+
+	REQUIRE(::chmod(base.native_c_str(), 0700) == 0);
+	CHECK(remove_directory_recursive(base));
+}
+#endif
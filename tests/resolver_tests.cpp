@@ -0,0 +1,202 @@
+#include "bvestl/fs/directory_iterator.hpp"
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/resolver.hpp"
+#include <doctest/doctest.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace bvestl::fs;
+
+extern internal::string* root;
+
+namespace {
+	void touch(path const& file) {
+		std::error_code ec;
+		open_file(file, open_flags::write | open_flags::create, ec);
+		REQUIRE_FALSE(ec);
+	}
+
+	// A resolver with \p base as its only search path, instead of the working directory
+	resolver searching(path const& base) {
+		resolver r;
+		r.erase(r.begin());
+		r.append(base);
+		return r;
+	}
+
+#if defined(EA_PLATFORM_LINUX)
+	// inotify watches held by this process, as listed in the fdinfo of its descriptors
+	size_t inotify_watches() {
+		size_t count = 0;
+		std::error_code ec;
+		for (directory_iterator fds(path("/proc/self/fdinfo"), ec); fds.next();) {
+			std::ifstream info(std::string("/proc/self/fdinfo/") + std::string(fds.entry().name().data(), fds.entry().name().size()));
+			for (std::string line; std::getline(info, line);)
+				count += line.compare(0, 11, "inotify wd:") == 0 ? 1 : 0;
+		}
+		return count;
+	}
+#endif
+} // namespace
+
+TEST_CASE("resolver corrects the case of names in insensitive mode") {
+	path const base = path(*root) / path("resolver_case");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("Data/Sub"), ec));
+	touch(base / path("Data/Sub/File.txt"));
+
+	resolver r = searching(base);
+	path const wrong_case("data/SUB/file.TXT");
+	CHECK(r.resolve(wrong_case) == wrong_case);
+
+	r.set_case_sensitivity(case_sensitivity::insensitive);
+	// Joined onto the search path, whatever that path's type
+	CHECK(r.resolve(wrong_case) == base / path("Data/Sub/File.txt"));
+	CHECK(r.resolve(path("DATA/./sub/../Sub")) == base / path("Data/Sub"));
+	CHECK(r.resolve(path("data/missing")) == path("data/missing"));
+	// Names spelled as on disk don't go through the folded listings
+	CHECK(r.resolve(path("Data/Sub/File.txt")) == base / path("Data/Sub/File.txt"));
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("resolver cache answers until invalidated") {
+	path const base = path(*root) / path("resolver_cache");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base, ec));
+	touch(base / path("a"));
+
+	resolver r = searching(base);
+	resolver_cache_options options;
+	options.watch = false;
+	r.enable_cache(options);
+	CHECK(r.resolve(path("a")) == base / path("a"));
+
+	// Gone from the disk, but still in the cache
+	REQUIRE(remove_file(base / path("a")));
+	CHECK(r.resolve(path("a")) == base / path("a"));
+	r.invalidate();
+	CHECK(r.resolve(path("a")) == path("a"));
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("resolver cache starts over at max_entries") {
+	path const base = path(*root) / path("resolver_entries");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base, ec));
+	for (const char* const name : {"a", "b", "c"})
+		touch(base / path(name));
+
+	resolver r = searching(base);
+	resolver_cache_options options;
+	options.watch = false;
+	options.max_entries = 2;
+	r.enable_cache(options);
+	CHECK(r.resolve(path("a")) == base / path("a"));
+	CHECK(r.resolve(path("b")) == base / path("b"));
+	REQUIRE(remove_file(base / path("a")));
+	CHECK(r.resolve(path("a")) == base / path("a"));
+
+	// A third result doesn't fit, and takes the first two with it
+	CHECK(r.resolve(path("c")) == base / path("c"));
+	CHECK(r.resolve(path("a")) == path("a"));
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("resolve_many agrees with resolve") {
+	path const base = path(*root) / path("resolver_many");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("first/d"), ec));
+	REQUIRE(create_directory_recursive(base / path("second/d"), ec));
+	std::vector<path> values;
+	for (int i = 0; i < 64; ++i) {
+		std::string const name = "f" + std::to_string(i);
+		// Spread over both search paths and their subdirectories, some in neither
+		if (i % 4 != 3)
+			touch(base / path(i % 2 == 0 ? "first" : "second") / path(i % 3 == 0 ? "d" : ".") / path(name.c_str()));
+		values.push_back(path((i % 3 == 0 ? "d/" + name : name).c_str()));
+	}
+	// Duplicates, the search paths' own subdirectory and an absolute name
+	values.push_back(values[0]);
+	values.push_back(values[5]);
+	values.push_back(path("d"));
+	values.push_back(base / path("first"));
+
+	resolver r = searching(base / path("first"));
+	r.append(base / path("second"));
+	auto const agrees = [&](size_t const threads) {
+		std::vector<resolved> out(values.size(), resolved());
+		resolve_options options;
+		options.threads = threads;
+		REQUIRE(r.resolve_many(eastl::span<const path>(values.data(), values.size()), eastl::span<resolved>(out.data(), out.size()), options));
+		bool same = true;
+		for (size_t i = 0; i < values.size(); ++i) {
+			// resolve() has no answer for absolute names, which come back as they are
+			path const expected = values[i].is_absolute() ? values[i] : r.resolve(values[i]);
+			same = same && out[i].result == expected && out[i].found() == (expected != values[i]);
+			if (out[i].found())
+				same = same && out[i].result == r[out[i].root] / values[i];
+		}
+		return same;
+	};
+	REQUIRE(r.resolve(values[0]) == base / path("first/d/f0"));
+	REQUIRE(r.resolve(values[3]) == values[3]);
+	CHECK(agrees(1));
+	CHECK(agrees(4));
+	REQUIRE(r.build_index(ec));
+	CHECK(agrees(4));
+
+	remove_directory_recursive(base);
+}
+
+#if defined(EA_PLATFORM_LINUX)
+TEST_CASE("resolver cache drops results when the disk changes") {
+	path const base = path(*root) / path("resolver_watch");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base, ec));
+
+	resolver r = searching(base);
+	r.enable_cache();
+	CHECK(r.resolve(path("late")) == path("late"));
+	touch(base / path("late"));
+
+	// The watcher thread sees the change shortly after
+	bool seen = false;
+	for (int i = 0; i < 200 && !seen; ++i) {
+		seen = r.resolve(path("late")) == base / path("late");
+		if (!seen)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	CHECK(seen);
+
+	remove_directory_recursive(base);
+}
+
+TEST_CASE("resolver cache holds at most max_watches watches") {
+	path const base = path(*root) / path("resolver_watches");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("sub/deeper"), ec));
+	touch(base / path("sub/deeper/file"));
+
+	resolver r = searching(base);
+	resolver_cache_options options;
+	options.max_watches = 2;
+	r.enable_cache(options);
+	// base, sub and sub/deeper: one too many, so the result isn't kept either
+	CHECK(r.resolve(path("sub/deeper/file")) == base / path("sub/deeper/file"));
+	CHECK(inotify_watches() <= 2);
+	r.disable_cache();
+
+	r.enable_cache();
+	CHECK(r.resolve(path("sub/deeper/file")) == base / path("sub/deeper/file"));
+	CHECK(inotify_watches() == 3);
+
+	remove_directory_recursive(base);
+}
+#endif
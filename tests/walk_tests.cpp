@@ -0,0 +1,42 @@
+#include "bvestl/fs/file_handle.hpp"
+#include "bvestl/fs/path.hpp"
+#include "bvestl/fs/walk.hpp"
+#include <doctest/doctest.h>
+#include <atomic>
+
+#if !defined(EA_PLATFORM_WINDOWS)
+#	include <unistd.h>
+#endif
+
+using namespace bvestl::fs;
+
+extern internal::string* root;
+
+#if !defined(EA_PLATFORM_WINDOWS)
+TEST_CASE("parallel_walk following symlinks stops at links back to an ancestor") {
+	path const base = path(*root) / path("walk_loop");
+	std::error_code ec;
+	REQUIRE(create_directory_recursive(base / path("a/b"), ec));
+	open_file(base / path("a/b/file"), open_flags::write | open_flags::create, ec);
+	REQUIRE(::symlink("../..", (base / path("a/b/up")).native_c_str()) == 0);
+
+	walk_options options;
+	options.threads = 2;
+	options.symlinks = symlink_policy::follow;
+	std::atomic<size_t> entries{0};
+	walk_result const result = parallel_walk(base, [&](directory_entry const&, size_t) { entries.fetch_add(1); }, options);
+	CHECK_FALSE(result.error);
+	// a, a/b, a/b/file and a/b/up, which is visited but not descended into
+	CHECK(entries.load() == 4);
+	CHECK(result.symlink_loops == 1);
+
+	remove_directory_recursive(base);
+}
+#endif
+
+TEST_CASE("parallel_walk reports the root when it can't be opened") {
+	path const missing = path(*root) / path("walk_missing");
+	walk_result const result = parallel_walk(missing, [](directory_entry const&, size_t) {});
+	CHECK(result.error == std::errc::no_such_file_or_directory);
+	CHECK(result.failed_path.empty());
+}
@@ -0,0 +1,125 @@
+/**
+ * Builds and inspects the pack archives read by mapped_pack.
+ *
+ * Usage:
+ *   bvestl-fs-pack create <output.pack> <directory>... [--compress] [--block-size <bytes>] [--prefix <path>]
+ *   bvestl-fs-pack list <file.pack>
+ *   bvestl-fs-pack extract <file.pack> <name> [<output>]
+ *
+ * create packs every file below each directory, named by its path relative to
+ * it (below --prefix if given); directories given later must not repeat names.
+ * extract writes one entry to <output>, or to stdout.
+ */
+
+#include "bvestl/fs/file_stream.hpp"
+#include "bvestl/fs/pack.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+using namespace bvestl::fs;
+
+namespace {
+	int usage() {
+		std::fprintf(stderr,
+		             "usage: bvestl-fs-pack create <output.pack> <directory>... [--compress] [--block-size <bytes>] [--prefix <path>]\n"
+		             "       bvestl-fs-pack list <file.pack>\n"
+		             "       bvestl-fs-pack extract <file.pack> <name> [<output>]\n");
+		return 2;
+	}
+
+	int fail(const char* const what, const char* const subject, std::error_code const& ec) {
+		std::fprintf(stderr, "bvestl-fs-pack: %s %s: %s\n", what, subject, ec.message().c_str());
+		return 1;
+	}
+
+	int create(int const argc, char** const argv) {
+		pack_options options;
+		pack_compression compression = pack_compression::none;
+		const char* prefix = "";
+		const char* output = nullptr;
+		std::vector<const char*> directories;
+		for (int i = 0; i < argc; ++i) {
+			if (std::strcmp(argv[i], "--compress") == 0)
+				compression = pack_compression::lz;
+			else if (std::strcmp(argv[i], "--block-size") == 0 && i + 1 < argc)
+				options.block_size = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			else if (std::strcmp(argv[i], "--prefix") == 0 && i + 1 < argc)
+				prefix = argv[++i];
+			else if (output == nullptr)
+				output = argv[i];
+			else
+				directories.push_back(argv[i]);
+		}
+		if (output == nullptr || directories.empty())
+			return usage();
+
+		std::error_code ec;
+		pack_builder builder(options);
+		for (const char* const directory : directories) {
+			if (!builder.add_directory(path_view(directory), ec, compression, path_view(prefix)))
+				return fail("can't add", directory, ec);
+		}
+		if (!builder.write(path_view(output), ec))
+			return fail("can't write", output, ec);
+		std::printf("%zu files packed into %s\n", builder.size(), output);
+		return 0;
+	}
+
+	int list(int const argc, char** const argv) {
+		if (argc != 1)
+			return usage();
+		std::error_code ec;
+		mapped_pack const pack{path_view(argv[0]), ec};
+		if (ec)
+			return fail("can't open", argv[0], ec);
+		for (size_t i = 0; i < pack.size(); ++i) {
+			pack_entry const entry = pack.entry(i);
+			std::printf("%12llu %12llu %-4s %.*s\n",
+			            static_cast<unsigned long long>(entry.size),
+			            static_cast<unsigned long long>(entry.stored_size),
+			            entry.compression == pack_compression::lz ? "lz" : "-",
+			            static_cast<int>(entry.name.size()),
+			            entry.name.data());
+		}
+		return 0;
+	}
+
+	int extract(int const argc, char** const argv) {
+		if (argc != 2 && argc != 3)
+			return usage();
+		std::error_code ec;
+		mapped_pack const pack{path_view(argv[0]), ec};
+		if (ec)
+			return fail("can't open", argv[0], ec);
+		size_t const index = pack.find(path_view(argv[1]));
+		if (index == mapped_pack::npos)
+			return fail("can't find", argv[1], std::make_error_code(std::errc::no_such_file_or_directory));
+		file_contents const contents = pack.open(index, ec);
+		if (ec)
+			return fail("can't read", argv[1], ec);
+
+		if (argc == 2) {
+			std::fwrite(contents.data(), 1, contents.size(), stdout);
+			return 0;
+		}
+		file_writer writer(path_view(argv[2]), ec);
+		if (ec || !writer.write(contents.data(), contents.size(), ec) || !writer.close(ec))
+			return fail("can't write", argv[2], ec);
+		return 0;
+	}
+} // namespace
+
+int main(int const argc, char** const argv) {
+	if (argc < 2)
+		return usage();
+	if (std::strcmp(argv[1], "create") == 0)
+		return create(argc - 2, argv + 2);
+	if (std::strcmp(argv[1], "list") == 0)
+		return list(argc - 2, argv + 2);
+	if (std::strcmp(argv[1], "extract") == 0)
+		return extract(argc - 2, argv + 2);
+	return usage();
+}